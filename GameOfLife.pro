@@ -9,6 +9,9 @@ QMAKE_CXXFLAGS += -std=c++17
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# The update thread hands its callbacks to the GUI thread with QMetaObject::invokeMethod on a functor
+lessThan(QT_MAJOR_VERSION, 5)|equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 10): error("Qt 5.10 or newer is needed")
+
 TARGET = GameOfLife
 TEMPLATE = app
 
@@ -28,15 +31,41 @@ CONFIG += c++17
 SOURCES += \
     src/main.cpp \
     src/cellkernel.cpp \
+    src/liferule.cpp \
     src/lifegridscene.cpp \
     src/lifegrid.cpp \
+    src/wordkernel.cpp \
+    src/rowkernel.cpp \
+    src/lookupkernel.cpp \
+    src/workerpool.cpp \
+    src/hashlife.cpp \
+    src/sparseplane.cpp \
+    src/largerthanlife.cpp \
+    src/patternio.cpp \
+    src/snapshot.cpp \
+    src/recorder.cpp \
+    src/densitypyramid.cpp \
+    src/gridframe.cpp \
     src/ui/mainwindow.cpp \
     src/ui/resizedialog.cpp
 
 HEADERS += \
     src/cellkernel.h \
+    src/liferule.h \
     src/lifegridscene.h \
     src/lifegrid.h \
+    src/wordkernel.h \
+    src/rowkernel.h \
+    src/lookupkernel.h \
+    src/workerpool.h \
+    src/hashlife.h \
+    src/sparseplane.h \
+    src/largerthanlife.h \
+    src/patternio.h \
+    src/snapshot.h \
+    src/recorder.h \
+    src/densitypyramid.h \
+    src/gridframe.h \
     src/ui/mainwindow.h \
     src/ui/resizedialog.h
 
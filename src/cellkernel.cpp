@@ -1,5 +1,6 @@
 #include "cellkernel.h"
 
+#include <algorithm>
 #include <numeric>
 
 CellKernel::CellKernel(CELL state_for_all) : cells{state_for_all}
@@ -66,3 +67,26 @@ CELL CellKernel::compute_state()
         return DEAD;
     }
 }
+
+CELL CellKernel::compute_state(const LifeRule &rule)
+{
+    const CELL current_state = cells[4];
+
+    // Only the live cells count, the dying ones of the Generations rules don't
+    const auto neighbours = std::count(cells.begin(), cells.end(), ALIVE) - (current_state == ALIVE ? 1 : 0);
+    const int neighbour_count = static_cast<int>(neighbours);
+
+    if(current_state == DEAD)
+    {
+        return rule.is_alive_next(false, neighbour_count) ? ALIVE : DEAD;
+    }
+
+    if(current_state == ALIVE && rule.is_alive_next(true, neighbour_count))
+    {
+        return ALIVE;
+    }
+
+    // Start dying, or keep on dying, until past the last state
+    const int next_state = current_state + 1;
+    return next_state < rule.states ? static_cast<CELL>(next_state) : DEAD;
+}
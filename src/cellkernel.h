@@ -1,10 +1,13 @@
 #ifndef CELLKERNEL_H
 #define CELLKERNEL_H
 
+#include "liferule.h"
+
 #include <array>
 
 /*!
  * @brief The state of a cell, either DEAD or ALIVE
+ * @details The Generations rules have dying states too, those are the values 2 and up.
  */
 enum CELL : unsigned char
 {
@@ -50,6 +53,14 @@ struct CellKernel
      * \return The new cell state, based on the state of the kernel.
      */
     CELL compute_state();
+
+    /*!
+     * \brief Computes the new state for a cell with any Life-like or Generations rule.
+     * \details Only the ALIVE cells are counted as neighbours.
+     * \param rule The rule to follow.
+     * \return The new cell state, based on the state of the kernel.
+     */
+    CELL compute_state(const LifeRule &rule);
 };
 
 #endif // CELLKERNEL_H
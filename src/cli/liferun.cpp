@@ -0,0 +1,311 @@
+/*
+ * life-run: steps a pattern without a display
+ *
+ * Usage: life-run [options] <input> <output>
+ */
+
+#include "../lifegrid.h"
+#include "../patternio.h"
+#include "../recorder.h"
+#include "../snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+/*
+ * Snapshots are told apart from the patterns by the extension
+ */
+bool is_snapshot_path(const std::string &path)
+{
+    const std::string extension{".snap"};
+    return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/*
+ * The options given on the command line
+ */
+struct Options
+{
+    std::string input_path;
+    std::string output_path;
+    std::string rulestring;
+    std::string recording_path;
+    GridEngine engine{PACKED_ENGINE};
+    int generations{1};
+    int thread_count{0};
+    int max_period{0};
+    int width{0};
+    int height{0};
+    bool wrap{false};
+    bool quiet{false};
+};
+
+void print_usage(std::ostream &stream)
+{
+    stream << "Usage: life-run [options] <input> <output>\n"
+              "\n"
+              "The patterns can be RLE (.rle), Life 1.06 (.lif, .life) or plaintext (.cells).\n"
+              "Snapshots (.snap) keep the rule, generation count and wrapping as well, for\n"
+              "resuming a run later.\n"
+              "\n"
+              "Options:\n"
+              "  -g <count>      Generations to advance (default 1)\n"
+              "  -r <rule>       Rulestring, such as B3/S23 or B2/S/C3 (default: the rule of the pattern)\n"
+              "  -s <W>x<H>      Grid size (default: the size of the pattern, ignored for snapshots)\n"
+              "  -e <engine>     packed, kernel or lookup (default packed)\n"
+              "  -t <threads>    Thread count, 0 for all the cores (default 0)\n"
+              "  -R <file>       Record every generation into the file\n"
+              "  -c <period>     Look for cycles up to the period and skip the repeats (default 0, off)\n"
+              "  -w              Wrap the grid around the edges\n"
+              "  -q              Don't print the timing\n"
+              "  -h              Show this help\n";
+}
+
+int parse_int(const std::string &text, const std::string &option)
+{
+    size_t end = 0;
+    int value = 0;
+    try
+    {
+        value = std::stoi(text, &end);
+    }
+    catch(const std::exception &)
+    {
+        end = 0;
+    }
+
+    if(end == 0 || end != text.size() || value < 0)
+    {
+        throw std::invalid_argument("Invalid value for " + option + ": " + text);
+    }
+    return value;
+}
+
+GridEngine parse_engine(const std::string &name)
+{
+    if(name == "packed")
+    {
+        return PACKED_ENGINE;
+    }
+    if(name == "kernel")
+    {
+        return KERNEL_ENGINE;
+    }
+    if(name == "lookup")
+    {
+        return LOOKUP_ENGINE;
+    }
+    throw std::invalid_argument("Unknown engine: " + name);
+}
+
+Options parse_options(int argc, char *argv[])
+{
+    Options options;
+    std::string paths[2];
+    int path_count = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string argument{argv[i]};
+        if(argument.size() < 2 || argument[0] != '-')
+        {
+            if(path_count == 2)
+            {
+                throw std::invalid_argument("Expected an input and an output file");
+            }
+            paths[path_count++] = argument;
+            continue;
+        }
+
+        if(argument == "-w")
+        {
+            options.wrap = true;
+            continue;
+        }
+        if(argument == "-q")
+        {
+            options.quiet = true;
+            continue;
+        }
+        if(argument == "-h")
+        {
+            print_usage(std::cout);
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if(argument != "-g" && argument != "-r" && argument != "-s" && argument != "-e" && argument != "-t" && argument != "-R" && argument != "-c")
+        {
+            throw std::invalid_argument("Unknown option: " + argument);
+        }
+        if(i + 1 >= argc)
+        {
+            throw std::invalid_argument("Missing value for " + argument);
+        }
+        const std::string value{argv[++i]};
+
+        if(argument == "-g")
+        {
+            options.generations = parse_int(value, argument);
+        }
+        else if(argument == "-r")
+        {
+            options.rulestring = value;
+        }
+        else if(argument == "-s")
+        {
+            const size_t separator = value.find('x');
+            if(separator == std::string::npos)
+            {
+                throw std::invalid_argument("Expected the size as <W>x<H>: " + value);
+            }
+            options.width = parse_int(value.substr(0, separator), argument);
+            options.height = parse_int(value.substr(separator + 1), argument);
+        }
+        else if(argument == "-e")
+        {
+            options.engine = parse_engine(value);
+        }
+        else if(argument == "-t")
+        {
+            options.thread_count = parse_int(value, argument);
+        }
+        else if(argument == "-c")
+        {
+            options.max_period = parse_int(value, argument);
+        }
+        else
+        {
+            options.recording_path = value;
+        }
+    }
+
+    if(path_count != 2)
+    {
+        throw std::invalid_argument("Expected an input and an output file");
+    }
+    options.input_path = paths[0];
+    options.output_path = paths[1];
+    return options;
+}
+
+int run(const Options &options)
+{
+    LifeGrid grid{3};
+    grid.set_engine(options.engine);
+    grid.set_thread_count(options.thread_count);
+
+    if(is_snapshot_path(options.input_path))
+    {
+        // The snapshot has its own size and wrapping
+        load_snapshot(options.input_path, grid);
+        if(options.wrap)
+        {
+            grid.set_wrap_grid(true);
+        }
+    }
+    else
+    {
+        grid.set_wrap_grid(options.wrap);
+
+        // Without a size, the grid is made to fit the pattern
+        const bool resize_to_fit = options.width == 0 || options.height == 0;
+        if(!resize_to_fit)
+        {
+            grid.resize_grid(std::max(3, options.width), std::max(3, options.height));
+        }
+
+        // The rule from the command line is set before loading as well, so that
+        // a pattern without a rule header can use its states
+        if(!options.rulestring.empty())
+        {
+            grid.set_rule(options.rulestring);
+        }
+        load_pattern(options.input_path, grid, resize_to_fit);
+    }
+
+    if(!options.rulestring.empty())
+    {
+        grid.set_rule(options.rulestring);
+    }
+
+    grid.set_cycle_detection(options.max_period);
+
+    const int width = grid.get_grid_width();
+    const int height = grid.get_grid_height();
+
+    const auto start = std::chrono::steady_clock::now();
+    if(options.recording_path.empty())
+    {
+        grid.advance(options.generations);
+    }
+    else
+    {
+        // Every generation is needed, so there's no skipping ahead with advance()
+        Recorder recorder{options.recording_path, grid};
+        recorder.record(grid);
+        for(int generation = 0; generation < options.generations; generation++)
+        {
+            grid.next_generation();
+            recorder.record(grid);
+        }
+        recorder.finish();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if(is_snapshot_path(options.output_path))
+    {
+        save_snapshot(options.output_path, grid);
+    }
+    else
+    {
+        save_pattern(options.output_path, grid);
+    }
+
+    if(!options.quiet)
+    {
+        const double cells = static_cast<double>(width) * height * options.generations;
+        std::cerr << options.generations << " generations of " << width << "x" << height
+                  << " in " << elapsed.count() << " s, now at generation " << grid.get_generation();
+        if(elapsed.count() > 0.0)
+        {
+            std::cerr << " (" << cells / elapsed.count() / 1e9 << " Gcells/s)";
+        }
+        std::cerr << "\n";
+
+        std::cerr << "Population " << grid.get_population() << ", " << grid.get_births() << " born and "
+                  << grid.get_deaths() << " died during the last generation\n";
+
+        if(grid.get_cycle_period() == 1)
+        {
+            std::cerr << "Settled into a still life\n";
+        }
+        else if(grid.get_cycle_period() > 1)
+        {
+            std::cerr << "Settled into a period " << grid.get_cycle_period() << " cycle\n";
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        return run(parse_options(argc, argv));
+    }
+    catch(const std::exception &error)
+    {
+        std::cerr << "life-run: " << error.what() << "\n\n";
+        print_usage(std::cerr);
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,231 @@
+#include "densitypyramid.h"
+#include "gridframe.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * The live cells of a 2x2 block, indexed by its upper two cells in the low bits and the lower two above them
+ */
+static const uint16_t block_counts[16] = {
+    0, 1, 1, 2,
+    1, 2, 2, 3,
+    1, 2, 2, 3,
+    2, 3, 3, 4
+};
+
+/*
+ * Sums the blocks of a level into the blocks of the level above, the blocks past its edges being empty
+ */
+template<typename BELOW, typename CURRENT>
+static void sum_blocks(
+    const BELOW *below,
+    int below_width,
+    int below_height,
+    CURRENT *current,
+    int width,
+    int first_x,
+    int first_y,
+    int last_x,
+    int last_y
+)
+{
+    for(int block_y = first_y; block_y < last_y; block_y++)
+    {
+        CURRENT *row = current + static_cast<size_t>(block_y) * static_cast<size_t>(width);
+        const BELOW *upper = below + static_cast<size_t>(2 * block_y) * static_cast<size_t>(below_width);
+        const BELOW *lower = 2 * block_y + 1 < below_height ? upper + below_width : nullptr;
+
+        for(int block_x = first_x; block_x < last_x; block_x++)
+        {
+            const int x = 2 * block_x;
+            const bool has_right = x + 1 < below_width;
+            uint64_t sum = uint64_t{upper[x]} + (has_right ? uint64_t{upper[x + 1]} : 0);
+            if(lower)
+            {
+                sum += uint64_t{lower[x]} + (has_right ? uint64_t{lower[x + 1]} : 0);
+            }
+            row[block_x] = static_cast<CURRENT>(sum);
+        }
+    }
+}
+
+DensityPyramid::DensityPyramid() :
+    grid_width{0},
+    grid_height{0}
+{
+}
+
+void DensityPyramid::update(const GridFrame &frame, const std::vector<unsigned char> &changed_tiles)
+{
+    const int tile_width = frame.get_tile_width();
+    const int tile_height = frame.get_tile_height();
+    const int tiles_x = (frame.get_grid_width() + tile_width - 1) / tile_width;
+    const int tiles_y = (frame.get_grid_height() + tile_height - 1) / tile_height;
+
+    // The flags of a resized grid don't match the old levels
+    const size_t tile_count = static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y);
+    if(frame.get_grid_width() != grid_width || frame.get_grid_height() != grid_height || changed_tiles.size() != tile_count)
+    {
+        resize(frame.get_grid_width(), frame.get_grid_height());
+        update_area(frame, 0, 0, grid_width, grid_height);
+        return;
+    }
+
+    for(int tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            if(!changed_tiles[static_cast<size_t>(tile_y * tiles_x + tile_x)])
+            {
+                continue;
+            }
+            update_area(
+                frame,
+                tile_x * tile_width,
+                tile_y * tile_height,
+                std::min(grid_width, (tile_x + 1) * tile_width),
+                std::min(grid_height, (tile_y + 1) * tile_height)
+            );
+        }
+    }
+}
+
+int DensityPyramid::get_level_count() const
+{
+    return static_cast<int>(levels.size());
+}
+
+int DensityPyramid::get_level_width(int level) const
+{
+    return levels[static_cast<size_t>(level - 1)].width;
+}
+
+int DensityPyramid::get_level_height(int level) const
+{
+    return levels[static_cast<size_t>(level - 1)].height;
+}
+
+uint64_t DensityPyramid::get_block_count(int level, int x, int y) const
+{
+    const Level &blocks = levels[static_cast<size_t>(level - 1)];
+    const size_t index = static_cast<size_t>(y) * static_cast<size_t>(blocks.width) + static_cast<size_t>(x);
+    return level <= narrow_levels ? blocks.narrow_counts[index] : blocks.wide_counts[index];
+}
+
+void DensityPyramid::get_level_shades(int level, int y, int first_x, int last_x, uint8_t *shades) const
+{
+    // A block holds 4^level cells
+    const double scale = 255.0 / std::ldexp(1.0, 2 * level);
+    for(int x = first_x; x < last_x; x++)
+    {
+        const uint64_t count = get_block_count(level, x, y);
+        const long shade = std::lround(static_cast<double>(count) * scale);
+        shades[x - first_x] = static_cast<uint8_t>(count ? std::max<long>(minimum_shade, shade) : 0);
+    }
+}
+
+void DensityPyramid::resize(int width, int height)
+{
+    grid_width = width;
+    grid_height = height;
+
+    levels.clear();
+    do
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        const size_t block_count = static_cast<size_t>(width) * static_cast<size_t>(height);
+        if(static_cast<int>(levels.size()) < narrow_levels)
+        {
+            levels.push_back(Level{width, height, std::vector<uint16_t>(block_count, 0), {}});
+        }
+        else
+        {
+            levels.push_back(Level{width, height, {}, std::vector<uint64_t>(block_count, 0)});
+        }
+    }
+    while(width > 1 || height > 1);
+}
+
+void DensityPyramid::update_area(const GridFrame &frame, int first_x, int first_y, int last_x, int last_y)
+{
+    const int state_bits = frame.get_state_bits();
+    const int first_word = first_x / 64;
+    const int last_word = (last_x + 63) / 64;
+    const size_t word_count = static_cast<size_t>(last_word - first_word);
+    upper_words.resize(word_count);
+    lower_words.resize(word_count);
+    plane_words.resize(word_count);
+
+    // A live cell has only the lowest bit of its state set, and past the last row everything is dead
+    const auto read_live_cells = [&](int y, std::vector<uint64_t> &words)
+    {
+        if(y >= grid_height)
+        {
+            std::fill(words.begin(), words.end(), 0);
+            return;
+        }
+
+        frame.get_row_bits(y, 0, first_word, last_word, words.data());
+        for(int plane = 1; plane < state_bits; plane++)
+        {
+            frame.get_row_bits(y, plane, first_word, last_word, plane_words.data());
+            for(size_t word = 0; word < word_count; word++)
+            {
+                words[word] &= ~plane_words[word];
+            }
+        }
+    };
+
+    // The first level is counted from the cells, a block row at a time
+    int level_first_x = first_x / 2;
+    int level_first_y = first_y / 2;
+    int level_last_x = (last_x + 1) / 2;
+    int level_last_y = (last_y + 1) / 2;
+
+    Level &bottom = levels.front();
+    for(int block_y = level_first_y; block_y < level_last_y; block_y++)
+    {
+        read_live_cells(2 * block_y, upper_words);
+        read_live_cells(2 * block_y + 1, lower_words);
+
+        uint16_t *row = bottom.narrow_counts.data() + static_cast<size_t>(block_y) * static_cast<size_t>(bottom.width);
+        for(int block_x = level_first_x; block_x < level_last_x; block_x++)
+        {
+            // The blocks start on an even column, so they never straddle two words
+            const int x = 2 * block_x - first_word * 64;
+            const size_t word = static_cast<size_t>(x / 64);
+            const int shift = x % 64;
+            const uint64_t quad = ((upper_words[word] >> shift) & 3) | (((lower_words[word] >> shift) & 3) << 2);
+            row[block_x] = block_counts[quad];
+        }
+    }
+
+    // The rest are summed from the level below
+    for(size_t level = 1; level < levels.size(); level++)
+    {
+        const Level &below = levels[level - 1];
+        Level &current = levels[level];
+
+        level_first_x /= 2;
+        level_first_y /= 2;
+        level_last_x = (level_last_x + 1) / 2;
+        level_last_y = (level_last_y + 1) / 2;
+
+        // The levels are numbered from 1, the first wide one is summed from the last narrow one
+        const int number = static_cast<int>(level) + 1;
+        if(number <= narrow_levels)
+        {
+            sum_blocks(below.narrow_counts.data(), below.width, below.height, current.narrow_counts.data(), current.width, level_first_x, level_first_y, level_last_x, level_last_y);
+        }
+        else if(number == narrow_levels + 1)
+        {
+            sum_blocks(below.narrow_counts.data(), below.width, below.height, current.wide_counts.data(), current.width, level_first_x, level_first_y, level_last_x, level_last_y);
+        }
+        else
+        {
+            sum_blocks(below.wide_counts.data(), below.width, below.height, current.wide_counts.data(), current.width, level_first_x, level_first_y, level_last_x, level_last_y);
+        }
+    }
+}
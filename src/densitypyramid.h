@@ -0,0 +1,138 @@
+#ifndef DENSITYPYRAMID_H
+#define DENSITYPYRAMID_H
+
+#include <cstdint>
+#include <vector>
+
+class GridFrame;
+
+/*!
+ * \brief The live cells counted at halving resolutions, for drawing a zoomed out grid
+ * \details Level 1 holds the live cells of every 2x2 block of cells, level 2 of every 4x4
+ *          block and so on, until a single block covers the whole grid. The counts are only
+ *          turned into shades when drawn, so a lone cell still shows on the highest level.
+ *          The levels are kept up to date a tile at a time, following the changed tiles of the frames.
+ */
+class DensityPyramid
+{
+  public:
+    /*!
+     * \brief The lightest shade of a block with any live cell in it
+     */
+    static constexpr uint8_t minimum_shade = 48;
+
+    DensityPyramid();
+
+    /*!
+     * \brief Brings the levels up to date with a frame of the grid
+     * \details Only the blocks over the changed tiles are counted again. Everything
+     *          is counted when the size of the grid has changed.
+     * \param frame The frame to follow
+     * \param changed_tiles The tiles changed since the last update, like GridFrame::get_changed_tiles()
+     */
+    void update(const GridFrame &frame, const std::vector<unsigned char> &changed_tiles);
+
+    /*!
+     * \brief Grab the level count
+     * \return The highest level, or 0 before the first update
+     */
+    int get_level_count() const;
+
+    /*!
+     * \brief Grab the width of a level
+     * \param level The level, from 1 to get_level_count()
+     * \return The amount of block columns
+     */
+    int get_level_width(int level) const;
+
+    /*!
+     * \brief Grab the height of a level
+     * \param level The level, from 1 to get_level_count()
+     * \return The amount of block rows
+     */
+    int get_level_height(int level) const;
+
+    /*!
+     * \brief Grab the live cells of a block
+     * \param level The level, from 1 to get_level_count()
+     * \param x The block column
+     * \param y The block row
+     * \return The amount of live cells in the block
+     */
+    uint64_t get_block_count(int level, int x, int y) const;
+
+    /*!
+     * \brief Shades a part of a block row
+     * \details The shades go from 0 for an empty block to 255 for a full one, a block
+     *          with any live cell being at least minimum_shade.
+     * \param level The level, from 1 to get_level_count()
+     * \param y The block row
+     * \param first_x The first block column
+     * \param last_x One past the last block column
+     * \param shades The output, a byte per block
+     */
+    void get_level_shades(int level, int y, int first_x, int last_x, uint8_t *shades) const;
+
+  private:
+    /*!
+     * \brief The blocks of a single level
+     */
+    struct Level
+    {
+        int width;
+        int height;
+
+        /*!
+         * The live cells of every block. The levels up to narrow_levels fit in
+         * 16 bits, the higher ones are kept in the wide counts.
+         */
+        std::vector<uint16_t> narrow_counts;
+        std::vector<uint64_t> wide_counts;
+    };
+
+    /*!
+     * \brief The highest level whose blocks, 4^level cells, can be counted in 16 bits
+     */
+    static constexpr int narrow_levels = 7;
+
+    /*!
+     * \brief Lays out the levels for a grid size, all of them empty
+     * \param width The grid width
+     * \param height The grid height
+     */
+    void resize(int width, int height);
+
+    /*!
+     * \brief Counts the blocks over an area of the grid again, on every level
+     * \param frame The frame to count
+     * \param first_x The first column, a multiple of 64
+     * \param first_y The first row, an even one
+     * \param last_x One past the last column
+     * \param last_y One past the last row
+     */
+    void update_area(const GridFrame &frame, int first_x, int first_y, int last_x, int last_y);
+
+    /*!
+     * \brief The size of the followed grid
+     */
+    int grid_width;
+    int grid_height;
+
+    /*!
+     * \brief The levels from 1 up
+     */
+    std::vector<Level> levels;
+
+    /*!
+     * \brief The live cells of the two rows of a block row, as packed words
+     */
+    std::vector<uint64_t> upper_words;
+    std::vector<uint64_t> lower_words;
+
+    /*!
+     * \brief A plane of a row, for finding the live cells of the Generations rules
+     */
+    std::vector<uint64_t> plane_words;
+};
+
+#endif // DENSITYPYRAMID_H
@@ -0,0 +1,223 @@
+#include "gridframe.h"
+#include "lifegrid.h"
+
+#include <algorithm>
+
+GridFrame::GridFrame() :
+    grid_width{0},
+    grid_height{0},
+    words_per_row{0},
+    tile_width{1},
+    tile_height{1},
+    states{2},
+    state_bits{1},
+    sequence{0},
+    generation{0},
+    population{0},
+    births{0},
+    deaths{0},
+    has_bounding_box{false},
+    box_min_x{0},
+    box_min_y{0},
+    box_max_x{0},
+    box_max_y{0}
+{
+}
+
+void GridFrame::capture(const LifeGrid &grid, std::vector<unsigned char> &new_changed_tiles, uint64_t new_sequence)
+{
+    const LifeRule rule = grid.get_rule();
+    const int old_words_per_row = words_per_row;
+    const int old_grid_height = grid_height;
+    const int old_state_bits = state_bits;
+    const bool had_bounding_box = has_bounding_box;
+    const int old_min_x = box_min_x;
+    const int old_min_y = box_min_y;
+    const int old_max_x = box_max_x;
+    const int old_max_y = box_max_y;
+
+    grid_width = grid.get_grid_width();
+    grid_height = grid.get_grid_height();
+    words_per_row = (grid_width + 63) / 64;
+    tile_width = grid.get_tile_width();
+    tile_height = grid.get_tile_height();
+    states = rule.states;
+    state_bits = rule.get_state_bits();
+    sequence = new_sequence;
+    generation = grid.get_generation();
+    population = grid.get_population();
+    births = grid.get_births();
+    deaths = grid.get_deaths();
+    has_bounding_box = grid.get_bounding_box(box_min_x, box_min_y, box_max_x, box_max_y);
+
+    /*
+     * The words outside the bounding box are all zero, only the ones within are copied.
+     * A frame of the same layout only has the words of its previous bounding box to clear.
+     */
+    const size_t row_words = static_cast<size_t>(words_per_row);
+    const size_t plane_size = row_words * static_cast<size_t>(grid_height);
+    if(words_per_row != old_words_per_row || grid_height != old_grid_height || state_bits != old_state_bits)
+    {
+        words.assign(plane_size * static_cast<size_t>(state_bits), 0);
+    }
+    else if(had_bounding_box)
+    {
+        const int first_word = old_min_x / 64;
+        const int last_word = old_max_x / 64 + 1;
+        for(int plane = 0; plane < state_bits; plane++)
+        {
+            for(int y = old_min_y; y <= old_max_y; y++)
+            {
+                uint64_t *row = words.data() + plane_size * static_cast<size_t>(plane) + row_words * static_cast<size_t>(y);
+                std::fill(row + first_word, row + last_word, 0);
+            }
+        }
+    }
+
+    if(has_bounding_box)
+    {
+        const int first_word = box_min_x / 64;
+        const int last_word = box_max_x / 64 + 1;
+        for(int plane = 0; plane < state_bits; plane++)
+        {
+            for(int y = box_min_y; y <= box_max_y; y++)
+            {
+                uint64_t *row = words.data() + plane_size * static_cast<size_t>(plane) + row_words * static_cast<size_t>(y);
+                grid.get_row_bits(y, plane, first_word, last_word, row + first_word);
+            }
+        }
+    }
+
+    changed_tiles.swap(new_changed_tiles);
+}
+
+CELL GridFrame::get_cell(int x, int y) const
+{
+    const size_t plane_size = static_cast<size_t>(words_per_row) * static_cast<size_t>(grid_height);
+    const size_t index = static_cast<size_t>(y) * static_cast<size_t>(words_per_row) + static_cast<size_t>(x / 64);
+
+    unsigned state = 0;
+    for(int plane = 0; plane < state_bits; plane++)
+    {
+        state |= static_cast<unsigned>((words[plane_size * static_cast<size_t>(plane) + index] >> (x % 64)) & 1) << plane;
+    }
+    return static_cast<CELL>(state);
+}
+
+void GridFrame::get_row_bits(int y, int plane, int first_word, int last_word, uint64_t *row_words) const
+{
+    const size_t plane_size = static_cast<size_t>(words_per_row) * static_cast<size_t>(grid_height);
+    const uint64_t *row = words.data() + plane_size * static_cast<size_t>(plane) + static_cast<size_t>(y) * static_cast<size_t>(words_per_row);
+    std::copy(row + first_word, row + last_word, row_words);
+}
+
+bool GridFrame::get_bounding_box(int &min_x, int &min_y, int &max_x, int &max_y) const
+{
+    if(!has_bounding_box)
+    {
+        return false;
+    }
+    min_x = box_min_x;
+    min_y = box_min_y;
+    max_x = box_max_x;
+    max_y = box_max_y;
+    return true;
+}
+
+const std::vector<unsigned char> &GridFrame::get_changed_tiles() const
+{
+    return changed_tiles;
+}
+
+int GridFrame::get_grid_width() const
+{
+    return grid_width;
+}
+
+int GridFrame::get_grid_height() const
+{
+    return grid_height;
+}
+
+int GridFrame::get_tile_width() const
+{
+    return tile_width;
+}
+
+int GridFrame::get_tile_height() const
+{
+    return tile_height;
+}
+
+int GridFrame::get_states() const
+{
+    return states;
+}
+
+int GridFrame::get_state_bits() const
+{
+    return state_bits;
+}
+
+uint64_t GridFrame::get_sequence() const
+{
+    return sequence;
+}
+
+uint64_t GridFrame::get_generation() const
+{
+    return generation;
+}
+
+uint64_t GridFrame::get_population() const
+{
+    return population;
+}
+
+uint64_t GridFrame::get_births() const
+{
+    return births;
+}
+
+uint64_t GridFrame::get_deaths() const
+{
+    return deaths;
+}
+
+FrameExchange::FrameExchange() :
+    middle{1},
+    back{0},
+    front{2}
+{
+}
+
+GridFrame &FrameExchange::get_back_frame()
+{
+    return frames[back];
+}
+
+void FrameExchange::publish()
+{
+    // The release makes the back frame visible to the reader, the acquire gets back a frame the reader is done with
+    back = middle.exchange(back | fresh_flag, std::memory_order_acq_rel) & ~fresh_flag;
+}
+
+bool FrameExchange::is_published_frame_taken() const
+{
+    return (middle.load(std::memory_order_acquire) & fresh_flag) == 0;
+}
+
+bool FrameExchange::acquire()
+{
+    if(is_published_frame_taken())
+    {
+        return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh_flag;
+    return true;
+}
+
+const GridFrame &FrameExchange::get_front_frame() const
+{
+    return frames[front];
+}
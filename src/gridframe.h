@@ -0,0 +1,234 @@
+#ifndef GRIDFRAME_H
+#define GRIDFRAME_H
+
+#include "cellkernel.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class LifeGrid;
+
+/*!
+ * \brief A copy of a generation of the grid, for drawing it while the next ones are stepped
+ * \details Holds the cells as packed bits like LifeGrid::get_row_bits() gives them: every bit
+ *          plane in turn, and in a plane every row as (width+63)/64 words. The statistics and
+ *          the tiles changed since the previous frame come along.
+ */
+class GridFrame
+{
+  public:
+    GridFrame();
+
+    /*!
+     * \brief Copies the grid into the frame
+     * \param grid The grid to copy
+     * \param changed_tiles The tiles changed since the previous frame, from
+     *        LifeGrid::collect_changed_tiles(). Swapped into the frame.
+     * \param sequence The number of the frame, one up from the previous one
+     */
+    void capture(const LifeGrid &grid, std::vector<unsigned char> &changed_tiles, uint64_t sequence);
+
+    /*!
+     * \brief Fetch the state of a certain cell
+     * \param x The column, within the grid
+     * \param y The row, within the grid
+     * \return The state of the cell
+     */
+    CELL get_cell(int x, int y) const;
+
+    /*!
+     * \brief Copies a part of a row out as bits, like LifeGrid::get_row_bits()
+     * \param y The row to copy
+     * \param plane The bit of the cell states to copy, below get_state_bits()
+     * \param first_word The first word of the row to copy
+     * \param last_word One past the last word to copy, at most (width+63)/64
+     * \param words Room for last_word-first_word words
+     */
+    void get_row_bits(int y, int plane, int first_word, int last_word, uint64_t *words) const;
+
+    /*!
+     * \brief Grab the smallest rectangle holding every cell that isn't dead
+     * \param min_x Set to the leftmost column
+     * \param min_y Set to the topmost row
+     * \param max_x Set to the rightmost column
+     * \param max_y Set to the bottom row
+     * \return False if every cell is dead, leaving the parameters alone
+     */
+    bool get_bounding_box(int &min_x, int &min_y, int &max_x, int &max_y) const;
+
+    /*!
+     * \brief Grab the tiles changed since the previous frame
+     * \return A flag for every tile, a tile row after another
+     */
+    const std::vector<unsigned char> &get_changed_tiles() const;
+
+    /*!
+     * \brief Grab grid width
+     * \return The width of the copied grid
+     */
+    int get_grid_width() const;
+
+    /*!
+     * \brief Grab grid height
+     * \return The height of the copied grid
+     */
+    int get_grid_height() const;
+
+    /*!
+     * \brief Grab the tile width
+     * \return The width of the grid's tiles in cells
+     */
+    int get_tile_width() const;
+
+    /*!
+     * \brief Grab the tile height
+     * \return The height of the grid's tiles in cells
+     */
+    int get_tile_height() const;
+
+    /*!
+     * \brief Grab the state count
+     * \return The amount of states of the grid's rule
+     */
+    int get_states() const;
+
+    /*!
+     * \brief Grab the bit plane count
+     * \return The amount of bits the states take
+     */
+    int get_state_bits() const;
+
+    /*!
+     * \brief Grab the frame number
+     * \return The sequence given to capture()
+     */
+    uint64_t get_sequence() const;
+
+    /*!
+     * \brief Grab the generation counter
+     * \return The generation of the grid when copied
+     */
+    uint64_t get_generation() const;
+
+    /*!
+     * \brief Grab the population
+     * \return The amount of live cells
+     */
+    uint64_t get_population() const;
+
+    /*!
+     * \brief Grab the births
+     * \return The births of the generation before the copy
+     */
+    uint64_t get_births() const;
+
+    /*!
+     * \brief Grab the deaths
+     * \return The deaths of the generation before the copy
+     */
+    uint64_t get_deaths() const;
+
+  private:
+    int grid_width;
+    int grid_height;
+    int words_per_row;
+    int tile_width;
+    int tile_height;
+    int states;
+    int state_bits;
+    uint64_t sequence;
+    uint64_t generation;
+    uint64_t population;
+    uint64_t births;
+    uint64_t deaths;
+
+    /*!
+     * \brief Is there a bounding box, or is every cell dead?
+     */
+    bool has_bounding_box;
+    int box_min_x;
+    int box_min_y;
+    int box_max_x;
+    int box_max_y;
+
+    /*!
+     * \brief The bit planes of the cells
+     */
+    std::vector<uint64_t> words;
+
+    /*!
+     * \brief The tiles changed since the previous frame
+     */
+    std::vector<unsigned char> changed_tiles;
+};
+
+/*!
+ * \brief Hands the frames over from the thread stepping the grid to the thread drawing it
+ * \details A triple buffer: the writer fills the back frame and publishes it, swapping
+ *          it with the frame in the middle. The reader swaps the middle frame with its
+ *          front frame whenever there's a new one. Neither side ever waits on the other,
+ *          and the reader always gets the latest complete frame. There may be a single
+ *          writer and a single reader at a time.
+ */
+class FrameExchange
+{
+  public:
+    FrameExchange();
+
+    /*!
+     * \brief Grab the frame to fill, for the writer
+     * \return The back frame
+     */
+    GridFrame &get_back_frame();
+
+    /*!
+     * \brief Hands the back frame over to the reader, for the writer
+     * \details A published frame the reader hasn't taken yet is replaced
+     */
+    void publish();
+
+    /*!
+     * \brief Has the reader taken the last published frame?
+     * \return True if there's no frame waiting for the reader
+     */
+    bool is_published_frame_taken() const;
+
+    /*!
+     * \brief Takes the latest published frame as the front frame, for the reader
+     * \return False if nothing was published since the last call, keeping the front frame
+     */
+    bool acquire();
+
+    /*!
+     * \brief Grab the frame taken by acquire(), for the reader
+     * \return The front frame, empty before the first one is taken
+     */
+    const GridFrame &get_front_frame() const;
+
+  private:
+    /*!
+     * \brief Set in middle when the frame there hasn't been taken yet
+     */
+    static constexpr unsigned fresh_flag = 4;
+
+    std::array<GridFrame, 3> frames;
+
+    /*!
+     * \brief The index of the frame between the writer and the reader, and fresh_flag
+     */
+    std::atomic<unsigned> middle;
+
+    /*!
+     * \brief The index of the writer's frame
+     */
+    unsigned back;
+
+    /*!
+     * \brief The index of the reader's frame
+     */
+    unsigned front;
+};
+
+#endif // GRIDFRAME_H
@@ -0,0 +1,665 @@
+#include "hashlife.h"
+#include "lifegrid.h"
+#include "wordkernel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+/*
+ * Mixes the bits of a 64 bit value, used for hashing the nodes
+ */
+static inline uint64_t mix_bits(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+HashLife::HashLife() :
+    root{no_node},
+    free_list{no_node},
+    nodes_in_use{0},
+    node_limit{0},
+    step_log2{-1},
+    generation{0}
+{
+    set_memory_limit(512 * 1024 * 1024);
+    clear();
+}
+
+void HashLife::clear()
+{
+    nodes.clear();
+    table.assign(1024, no_node);
+    empty_nodes.clear();
+    gc_stack.clear();
+    free_list = no_node;
+    nodes_in_use = 0;
+    step_log2 = -1;
+    generation = 0;
+
+    root = empty_node(leaf_level + 1);
+}
+
+void HashLife::set_memory_limit(size_t bytes)
+{
+    // Every node takes a table slot as well
+    node_limit = std::max<size_t>(bytes / (sizeof(Node) + sizeof(uint32_t)), 1024);
+}
+
+size_t HashLife::get_memory_usage() const
+{
+    return nodes.capacity() * sizeof(Node) + table.capacity() * sizeof(uint32_t);
+}
+
+size_t HashLife::get_node_count() const
+{
+    return nodes_in_use;
+}
+
+uint64_t HashLife::get_generation() const
+{
+    return generation;
+}
+
+uint64_t HashLife::get_population() const
+{
+    return nodes[root].population;
+}
+
+uint64_t HashLife::leaf_bits(uint32_t node) const
+{
+    const Node &leaf = nodes[node];
+    return static_cast<uint64_t>(leaf.children[0]) | (static_cast<uint64_t>(leaf.children[1]) << 32);
+}
+
+size_t HashLife::hash_node(const Node &node) const
+{
+    uint64_t hash = node.level;
+    for(uint32_t child : node.children)
+    {
+        hash = mix_bits(hash ^ child);
+    }
+    return static_cast<size_t>(hash);
+}
+
+void HashLife::insert_into_table(uint32_t node)
+{
+    const size_t bucket = hash_node(nodes[node]) & (table.size() - 1);
+    nodes[node].next = table[bucket];
+    table[bucket] = node;
+}
+
+void HashLife::grow_table()
+{
+    table.assign(table.size() * 2, no_node);
+    for(uint32_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i].level != 0)
+        {
+            insert_into_table(i);
+        }
+    }
+}
+
+uint32_t HashLife::allocate_node()
+{
+    nodes_in_use++;
+
+    if(free_list != no_node)
+    {
+        const uint32_t node = free_list;
+        free_list = nodes[node].next;
+        return node;
+    }
+
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+uint32_t HashLife::make_leaf(uint64_t bits)
+{
+    Node wanted{};
+    wanted.children[0] = static_cast<uint32_t>(bits);
+    wanted.children[1] = static_cast<uint32_t>(bits >> 32);
+    wanted.level = leaf_level;
+
+    // Look for an identical leaf first
+    const size_t bucket = hash_node(wanted) & (table.size() - 1);
+    for(uint32_t node = table[bucket]; node != no_node; node = nodes[node].next)
+    {
+        const Node &existing = nodes[node];
+        if(existing.level == leaf_level &&
+           existing.children[0] == wanted.children[0] &&
+           existing.children[1] == wanted.children[1])
+        {
+            return node;
+        }
+    }
+
+    collect_garbage_if_needed();
+
+    const uint32_t node = allocate_node();
+    wanted.result = no_node;
+    wanted.population = static_cast<uint64_t>(__builtin_popcountll(bits));
+    nodes[node] = wanted;
+    insert_into_table(node);
+
+    if(nodes_in_use > table.size())
+    {
+        grow_table();
+    }
+    return node;
+}
+
+uint32_t HashLife::make_node(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+    Node wanted{};
+    wanted.children[0] = nw;
+    wanted.children[1] = ne;
+    wanted.children[2] = sw;
+    wanted.children[3] = se;
+    wanted.level = static_cast<uint8_t>(nodes[nw].level + 1);
+
+    // Look for an identical node first
+    const size_t bucket = hash_node(wanted) & (table.size() - 1);
+    for(uint32_t node = table[bucket]; node != no_node; node = nodes[node].next)
+    {
+        const Node &existing = nodes[node];
+        if(existing.level == wanted.level &&
+           existing.children[0] == nw && existing.children[1] == ne &&
+           existing.children[2] == sw && existing.children[3] == se)
+        {
+            return node;
+        }
+    }
+
+    collect_garbage_if_needed();
+
+    wanted.result = no_node;
+    wanted.population = nodes[nw].population + nodes[ne].population +
+                        nodes[sw].population + nodes[se].population;
+
+    const uint32_t node = allocate_node();
+    nodes[node] = wanted;
+    insert_into_table(node);
+
+    if(nodes_in_use > table.size())
+    {
+        grow_table();
+    }
+    return node;
+}
+
+uint32_t HashLife::empty_node(int level)
+{
+    if(empty_nodes.size() <= static_cast<size_t>(leaf_level))
+    {
+        empty_nodes.assign(leaf_level, no_node);
+        empty_nodes.push_back(make_leaf(0));
+    }
+
+    while(empty_nodes.size() <= static_cast<size_t>(level))
+    {
+        const uint32_t empty = empty_nodes.back();
+        empty_nodes.push_back(make_node(empty, empty, empty, empty));
+    }
+    return empty_nodes[static_cast<size_t>(level)];
+}
+
+/*
+ * Unpacks a 16x16 node into rows, bit x of row y being the cell at (x, y)
+ */
+static void unpack_rows(uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se, uint32_t rows[16])
+{
+    for(int y = 0; y < 8; y++)
+    {
+        rows[y]     = static_cast<uint32_t>(((nw >> (8 * y)) & 0xff) | (((ne >> (8 * y)) & 0xff) << 8));
+        rows[y + 8] = static_cast<uint32_t>(((sw >> (8 * y)) & 0xff) | (((se >> (8 * y)) & 0xff) << 8));
+    }
+}
+
+/*
+ * Packs the centre 8x8 cells of the rows into a leaf
+ */
+static uint64_t pack_centre(const uint32_t rows[16])
+{
+    uint64_t bits = 0;
+    for(int y = 0; y < 8; y++)
+    {
+        bits |= static_cast<uint64_t>((rows[y + 4] >> 4) & 0xff) << (8 * y);
+    }
+    return bits;
+}
+
+uint32_t HashLife::centre(uint32_t node)
+{
+    const Node copy = nodes[node];
+
+    if(copy.level == leaf_level + 1)
+    {
+        uint32_t rows[16];
+        unpack_rows(leaf_bits(copy.children[0]), leaf_bits(copy.children[1]),
+                    leaf_bits(copy.children[2]), leaf_bits(copy.children[3]), rows);
+        return make_leaf(pack_centre(rows));
+    }
+
+    return make_node(
+        nodes[copy.children[0]].children[3],
+        nodes[copy.children[1]].children[2],
+        nodes[copy.children[2]].children[1],
+        nodes[copy.children[3]].children[0]
+    );
+}
+
+uint32_t HashLife::leaf_result(uint32_t node)
+{
+    const Node copy = nodes[node];
+
+    uint32_t rows[16];
+    unpack_rows(leaf_bits(copy.children[0]), leaf_bits(copy.children[1]),
+                leaf_bits(copy.children[2]), leaf_bits(copy.children[3]), rows);
+
+    /*
+     * Every generation the valid area shrinks by a cell from each side,
+     * so the centre 8x8 is still correct after 4 generations.
+     */
+    const int generations = 1 << std::min(2, step_log2);
+    for(int i = 0; i < generations; i++)
+    {
+        uint32_t next_rows[16];
+        for(int y = 0; y < 16; y++)
+        {
+            const uint32_t above = y > 0  ? rows[y - 1] : 0;
+            const uint32_t row   = rows[y];
+            const uint32_t below = y < 15 ? rows[y + 1] : 0;
+
+            next_rows[y] = compute_words<uint32_t>(
+                above << 1, above, above >> 1,
+                row   << 1, row,   row   >> 1,
+                below << 1, below, below >> 1
+            ) & 0xffff;
+        }
+        std::copy(next_rows, next_rows + 16, rows);
+    }
+
+    return make_leaf(pack_centre(rows));
+}
+
+uint32_t HashLife::result(uint32_t node)
+{
+    if(nodes[node].result != no_node)
+    {
+        return nodes[node].result;
+    }
+
+    // Everything made below is kept on the stack, so garbage collection can't free it
+    const size_t stack_mark = gc_stack.size();
+    gc_stack.push_back(node);
+
+    const Node copy = nodes[node];
+    uint32_t answer;
+
+    if(copy.population == 0)
+    {
+        // Nothing is ever born from nothing
+        answer = empty_node(copy.level - 1);
+    }
+    else if(copy.level == leaf_level + 1)
+    {
+        answer = leaf_result(node);
+    }
+    else
+    {
+        /*
+         * The grandchildren form a 4x4 grid:
+         *  nw.nw nw.ne ne.nw ne.ne
+         *  nw.sw nw.se ne.sw ne.se
+         *  sw.nw sw.ne se.nw se.ne
+         *  sw.sw sw.se se.sw se.se
+         */
+        uint32_t grandchildren[4][4];
+        for(int quadrant = 0; quadrant < 4; quadrant++)
+        {
+            const Node &child = nodes[copy.children[quadrant]];
+            const int row    = (quadrant / 2) * 2;
+            const int column = (quadrant % 2) * 2;
+            grandchildren[row][column]         = child.children[0];
+            grandchildren[row][column + 1]     = child.children[1];
+            grandchildren[row + 1][column]     = child.children[2];
+            grandchildren[row + 1][column + 1] = child.children[3];
+        }
+
+        // At full speed both halves advance, otherwise only the second one
+        const bool is_full_speed = step_log2 >= copy.level - 2;
+
+        // The nine overlapping nodes one level lower, advanced or centered
+        uint32_t first_stage[3][3];
+        for(int y = 0; y < 3; y++)
+        {
+            for(int x = 0; x < 3; x++)
+            {
+                const uint32_t sub_node = make_node(
+                    grandchildren[y][x],     grandchildren[y][x + 1],
+                    grandchildren[y + 1][x], grandchildren[y + 1][x + 1]
+                );
+                gc_stack.push_back(sub_node);
+
+                first_stage[y][x] = is_full_speed ? result(sub_node) : centre(sub_node);
+                gc_stack.push_back(first_stage[y][x]);
+            }
+        }
+
+        // The four overlapping nodes of those, advanced again
+        uint32_t second_stage[2][2];
+        for(int y = 0; y < 2; y++)
+        {
+            for(int x = 0; x < 2; x++)
+            {
+                const uint32_t sub_node = make_node(
+                    first_stage[y][x],     first_stage[y][x + 1],
+                    first_stage[y + 1][x], first_stage[y + 1][x + 1]
+                );
+                gc_stack.push_back(sub_node);
+
+                second_stage[y][x] = result(sub_node);
+                gc_stack.push_back(second_stage[y][x]);
+            }
+        }
+
+        answer = make_node(second_stage[0][0], second_stage[0][1], second_stage[1][0], second_stage[1][1]);
+    }
+
+    gc_stack.resize(stack_mark);
+    nodes[node].result = answer;
+    return answer;
+}
+
+void HashLife::expand_root()
+{
+    const Node copy = nodes[root];
+    const uint32_t empty = empty_node(copy.level - 1);
+
+    // The old quadrants end up in the middle of the new root
+    const uint32_t nw = make_node(empty, empty, empty, copy.children[0]);
+    const uint32_t ne = make_node(empty, empty, copy.children[1], empty);
+    const uint32_t sw = make_node(empty, copy.children[2], empty, empty);
+    const uint32_t se = make_node(copy.children[3], empty, empty, empty);
+    root = make_node(nw, ne, sw, se);
+}
+
+void HashLife::advance_pow2(int log2_generations)
+{
+    if(log2_generations < 0 || log2_generations > 62)
+    {
+        throw std::out_of_range("The step must be between 2^0 and 2^62 generations");
+    }
+
+    /*
+     * A node advances by min(2^(level-2), 2^step_log2) generations, so the results of the
+     * nodes at full speed under both step sizes stay valid. Only the higher ones are dropped.
+     */
+    if(log2_generations != step_log2)
+    {
+        const int full_speed_level = std::min(log2_generations, step_log2) + 2;
+        for(Node &node : nodes)
+        {
+            if(node.level > full_speed_level)
+            {
+                node.result = no_node;
+            }
+        }
+        step_log2 = log2_generations;
+    }
+
+    /*
+     * The result is the centre half of the root. A pattern within the centre
+     * quarter can grow at most 2^(level-3) cells to each side before leaving it.
+     */
+    while(nodes[root].level < std::max(log2_generations + 3, leaf_level + 2) ||
+          nodes[root].population != nodes[centre(centre(root))].population)
+    {
+        expand_root();
+    }
+
+    root = result(root);
+    generation += uint64_t{1} << log2_generations;
+}
+
+void HashLife::advance(uint64_t generations)
+{
+    for(int bit = 0; bit < 64; bit++)
+    {
+        if((generations >> bit) & 1)
+        {
+            advance_pow2(bit);
+        }
+    }
+}
+
+uint32_t HashLife::set_cell_in(uint32_t node, int64_t x, int64_t y, bool alive)
+{
+    const Node copy = nodes[node];
+
+    if(copy.level == leaf_level)
+    {
+        uint64_t bits = leaf_bits(node);
+        const uint64_t bit = uint64_t{1} << (y * 8 + x);
+        bits = alive ? bits | bit : bits & ~bit;
+        return make_leaf(bits);
+    }
+
+    const int64_t half = int64_t{1} << (copy.level - 1);
+    const int quadrant = (y >= half ? 2 : 0) + (x >= half ? 1 : 0);
+
+    uint32_t children[4] = {copy.children[0], copy.children[1], copy.children[2], copy.children[3]};
+    children[quadrant] = set_cell_in(children[quadrant], x % half, y % half, alive);
+    return make_node(children[0], children[1], children[2], children[3]);
+}
+
+void HashLife::set_cell(int64_t x, int64_t y, CELL state)
+{
+    // Grow until the coordinate fits in
+    for(;;)
+    {
+        const int64_t half = int64_t{1} << (nodes[root].level - 1);
+        if(x >= -half && x < half && y >= -half && y < half)
+        {
+            root = set_cell_in(root, x + half, y + half, state == ALIVE);
+            return;
+        }
+        expand_root();
+    }
+}
+
+CELL HashLife::get_cell(int64_t x, int64_t y) const
+{
+    const int64_t root_half = int64_t{1} << (nodes[root].level - 1);
+    if(x < -root_half || x >= root_half || y < -root_half || y >= root_half)
+    {
+        return DEAD;
+    }
+
+    x += root_half;
+    y += root_half;
+
+    uint32_t node = root;
+    while(nodes[node].level > leaf_level)
+    {
+        if(nodes[node].population == 0)
+        {
+            return DEAD;
+        }
+
+        const int64_t half = int64_t{1} << (nodes[node].level - 1);
+        const int quadrant = (y >= half ? 2 : 0) + (x >= half ? 1 : 0);
+        node = nodes[node].children[quadrant];
+        x %= half;
+        y %= half;
+    }
+
+    return (leaf_bits(node) >> (y * 8 + x)) & 1 ? ALIVE : DEAD;
+}
+
+void HashLife::for_each_live_cell(const std::function<void(int64_t, int64_t)> &callback) const
+{
+    const std::function<void(uint32_t, int64_t, int64_t)> visit = [&](uint32_t node, int64_t left, int64_t top)
+    {
+        const Node &current = nodes[node];
+        if(current.population == 0)
+        {
+            return;
+        }
+
+        if(current.level == leaf_level)
+        {
+            uint64_t bits = leaf_bits(node);
+            while(bits)
+            {
+                const int bit = __builtin_ctzll(bits);
+                callback(left + bit % 8, top + bit / 8);
+                bits &= bits - 1;
+            }
+            return;
+        }
+
+        const int64_t half = int64_t{1} << (current.level - 1);
+        visit(current.children[0], left,        top);
+        visit(current.children[1], left + half, top);
+        visit(current.children[2], left,        top + half);
+        visit(current.children[3], left + half, top + half);
+    };
+
+    const int64_t root_half = int64_t{1} << (nodes[root].level - 1);
+    visit(root, -root_half, -root_half);
+}
+
+void HashLife::load_grid(const LifeGrid &grid)
+{
+    clear();
+    for(int y = 0; y < grid.get_grid_height(); y++)
+    {
+        for(int x = 0; x < grid.get_grid_width(); x++)
+        {
+            if(grid.get_cell(x, y) == ALIVE)
+            {
+                set_cell(x, y, ALIVE);
+            }
+        }
+    }
+}
+
+void HashLife::store_grid(LifeGrid &grid) const
+{
+    grid.clear_grid();
+    for_each_live_cell([&](int64_t x, int64_t y)
+    {
+        if(x >= 0 && x < grid.get_grid_width() && y >= 0 && y < grid.get_grid_height())
+        {
+            grid.set_cell(static_cast<int>(x), static_cast<int>(y), ALIVE);
+        }
+    });
+}
+
+void HashLife::mark(uint32_t node, bool keep_results)
+{
+    Node &current = nodes[node];
+    if(current.is_marked)
+    {
+        return;
+    }
+    current.is_marked = true;
+
+    if(keep_results && current.result != no_node)
+    {
+        mark(current.result, keep_results);
+    }
+
+    if(nodes[node].level > leaf_level)
+    {
+        for(int quadrant = 0; quadrant < 4; quadrant++)
+        {
+            mark(nodes[node].children[quadrant], keep_results);
+        }
+    }
+}
+
+void HashLife::collect_garbage(bool keep_results)
+{
+    for(Node &node : nodes)
+    {
+        node.is_marked = false;
+        if(!keep_results)
+        {
+            node.result = no_node;
+        }
+    }
+
+    mark(root, keep_results);
+    for(uint32_t node : empty_nodes)
+    {
+        if(node != no_node)
+        {
+            mark(node, keep_results);
+        }
+    }
+    for(uint32_t node : gc_stack)
+    {
+        mark(node, keep_results);
+    }
+
+    // Sweep the unmarked nodes into the free list. Free nodes have level 0.
+    free_list = no_node;
+    nodes_in_use = 0;
+    for(uint32_t i = static_cast<uint32_t>(nodes.size()); i-- > 0;)
+    {
+        Node &node = nodes[i];
+        if(node.level != 0 && node.is_marked)
+        {
+            nodes_in_use++;
+            continue;
+        }
+
+        node.level = 0;
+        node.result = no_node;
+        node.next = free_list;
+        free_list = i;
+    }
+
+    // The chains went through the freed nodes, so rebuild the table
+    std::fill(table.begin(), table.end(), no_node);
+    for(uint32_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i].level != 0)
+        {
+            insert_into_table(i);
+        }
+    }
+}
+
+void HashLife::collect_garbage_if_needed()
+{
+    /*
+     * Collecting is only safe while advancing, when every node being worked on is in gc_stack.
+     * The memoized results are kept if that frees enough.
+     */
+    if(nodes_in_use < node_limit || gc_stack.empty())
+    {
+        return;
+    }
+
+    collect_garbage(true);
+    if(nodes_in_use > node_limit / 2)
+    {
+        collect_garbage(false);
+    }
+
+    // The live nodes alone don't fit, there's no choice but to grow
+    if(nodes_in_use > node_limit / 2)
+    {
+        node_limit = nodes_in_use * 2;
+    }
+}
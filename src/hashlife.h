@@ -0,0 +1,224 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include "cellkernel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class LifeGrid;
+
+/*!
+ * \brief Gosper's HashLife on an unbounded plane
+ * \details The plane is a quadtree where identical subtrees are stored only once.
+ *          Every node memoizes its RESULT: the centre half of the node, advanced
+ *          into the future. Repeating and empty regions are computed only once,
+ *          which lets the pattern jump 2^k generations in one go.
+ *
+ *          The leaves are 8x8 cells, packed into a single uint64_t.
+ *          The coordinates are centered, so the root of level L covers
+ *          [-2^(L-1), 2^(L-1)) on both axes.
+ */
+class HashLife
+{
+  public:
+    HashLife();
+
+    /*!
+     * \brief Kills all cells and drops all of the nodes
+     * \details Resets the generation counter as well
+     */
+    void clear();
+
+    /*!
+     * \brief Sets the cell value accordingly
+     * \details The plane grows as needed to fit the coordinate
+     * \param x The column
+     * \param y The row
+     * \param state The wanted state of the cell
+     */
+    void set_cell(int64_t x, int64_t y, CELL state);
+
+    /*!
+     * \brief Fetch the state of a certain cell
+     * \param x The column
+     * \param y The row
+     * \return The cell state, DEAD if outside of the current plane
+     */
+    CELL get_cell(int64_t x, int64_t y) const;
+
+    /*!
+     * \brief Advances the pattern by 2^log2_generations generations
+     * \param log2_generations The base 2 logarithm of the generations to advance
+     */
+    void advance_pow2(int log2_generations);
+
+    /*!
+     * \brief Advances the pattern by any amount of generations
+     * \details Split into advance_pow2() calls, one for every set bit
+     * \param generations The generations to advance
+     */
+    void advance(uint64_t generations);
+
+    /*!
+     * \brief Grab the generation counter
+     * \return The generations advanced since the last clear()
+     */
+    uint64_t get_generation() const;
+
+    /*!
+     * \brief Grab the population
+     * \return The amount of live cells
+     */
+    uint64_t get_population() const;
+
+    /*!
+     * \brief Calls the callback for every live cell
+     * \details The empty parts of the plane are skipped without visiting the cells
+     * \param callback Called with the x and y of a live cell
+     */
+    void for_each_live_cell(const std::function<void(int64_t, int64_t)> &callback) const;
+
+    /*!
+     * \brief Replaces the plane with the contents of the grid
+     * \details The top-left corner of the grid is placed at (0, 0)
+     * \param grid The grid to copy
+     */
+    void load_grid(const LifeGrid &grid);
+
+    /*!
+     * \brief Copies the plane into the grid
+     * \details The top-left corner of the grid shows the cell (0, 0).
+     *          The cells outside of the grid are left out.
+     * \param grid The grid to overwrite
+     */
+    void store_grid(LifeGrid &grid) const;
+
+    /*!
+     * \brief Limit the memory used by the nodes
+     * \details When the limit is reached in the middle of advancing, the unreachable
+     *          nodes are collected. If that's not enough, the memoized results are dropped
+     *          as well. The limit can be exceeded if the live nodes alone don't fit into it.
+     * \param bytes The memory limit in bytes
+     */
+    void set_memory_limit(size_t bytes);
+
+    /*!
+     * \brief Grab the memory used by the nodes
+     * \return The memory used by the node storage and the hash table in bytes
+     */
+    size_t get_memory_usage() const;
+
+    /*!
+     * \brief Grab the node count
+     * \return The amount of nodes in use
+     */
+    size_t get_node_count() const;
+
+    /*!
+     * \brief Frees the nodes unreachable from the current pattern
+     * \param keep_results If false, the memoized results are dropped too
+     */
+    void collect_garbage(bool keep_results = true);
+
+  private:
+    /*!
+     * \brief A quadtree node
+     * \details Level 3 nodes are the 8x8 leaves, bit y*8+x being the cell at (x, y).
+     *          The leaf cells are kept in children[0] (low half) and children[1] (high half).
+     */
+    struct Node
+    {
+        uint32_t children[4];
+
+        /*!
+         * \brief The memoized result or no_node
+         */
+        uint32_t result;
+
+        /*!
+         * \brief The next node in the same hash bucket, or in the free list
+         */
+        uint32_t next;
+
+        uint64_t population;
+        uint8_t level;
+        bool is_marked;
+    };
+
+    static constexpr uint32_t no_node = 0xffffffff;
+    static constexpr int leaf_level = 3;
+
+    uint32_t make_leaf(uint64_t bits);
+    uint32_t make_node(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+    uint32_t allocate_node();
+    uint32_t empty_node(int level);
+
+    uint64_t leaf_bits(uint32_t node) const;
+    size_t hash_node(const Node &node) const;
+    void insert_into_table(uint32_t node);
+    void grow_table();
+
+    /*!
+     * \brief The centre of the node, one level lower
+     */
+    uint32_t centre(uint32_t node);
+
+    /*!
+     * \brief The centre of the node advanced by min(2^(level-2), 2^step_log2) generations
+     */
+    uint32_t result(uint32_t node);
+
+    /*!
+     * \brief The result of a 16x16 node, computed directly from the cells
+     */
+    uint32_t leaf_result(uint32_t node);
+
+    /*!
+     * \brief Adds an empty border around the root, making it one level higher
+     */
+    void expand_root();
+
+    uint32_t set_cell_in(uint32_t node, int64_t x, int64_t y, bool alive);
+
+    void mark(uint32_t node, bool keep_results);
+
+    /*!
+     * \brief Collects garbage if the node count is over the limit
+     */
+    void collect_garbage_if_needed();
+
+    std::vector<Node> nodes;
+
+    /*!
+     * \brief Open hash table with chaining through Node::next
+     */
+    std::vector<uint32_t> table;
+
+    /*!
+     * \brief The empty node of every level, reused a lot
+     */
+    std::vector<uint32_t> empty_nodes;
+
+    /*!
+     * \brief Nodes in the middle of a computation, kept alive over garbage collection
+     */
+    std::vector<uint32_t> gc_stack;
+
+    uint32_t root;
+    uint32_t free_list;
+    size_t nodes_in_use;
+    size_t node_limit;
+
+    /*!
+     * \brief The log2 of the step size the memoized results were computed with
+     * \details The results of the nodes up to level step_log2 + 2 don't depend on it
+     */
+    int step_log2;
+
+    uint64_t generation;
+};
+
+#endif // HASHLIFE_H
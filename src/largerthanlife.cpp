@@ -0,0 +1,349 @@
+#include "largerthanlife.h"
+#include "lifegrid.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+/*
+ * Reads a non-negative number from the string, moving the position past it
+ */
+static int parse_number(const std::string &rulestring, size_t &position)
+{
+    const size_t start = position;
+    int number = 0;
+    for(; position < rulestring.size() && std::isdigit(static_cast<unsigned char>(rulestring[position])); position++)
+    {
+        number = number * 10 + (rulestring[position] - '0');
+        if(number > 1000000)
+        {
+            throw std::invalid_argument("Too large a number in the rulestring: " + rulestring);
+        }
+    }
+
+    if(position == start)
+    {
+        throw std::invalid_argument("Expected a number in the rulestring: " + rulestring);
+    }
+    return number;
+}
+
+/*
+ * Reads a range like 34..58 from the string, moving the position past it
+ */
+static void parse_range(const std::string &rulestring, size_t &position, int &minimum, int &maximum)
+{
+    minimum = parse_number(rulestring, position);
+    if(rulestring.compare(position, 2, "..") != 0)
+    {
+        throw std::invalid_argument("Expected a range like 34..58 in the rulestring: " + rulestring);
+    }
+    position += 2;
+    maximum = parse_number(rulestring, position);
+}
+
+LtLRule::LtLRule(const std::string &rulestring) :
+    radius{0},
+    states{2},
+    counts_middle{false},
+    survival_min{0},
+    survival_max{0},
+    birth_min{0},
+    birth_max{0}
+{
+    bool has_survival = false;
+    bool has_birth = false;
+    size_t position = 0;
+    while(position < rulestring.size())
+    {
+        const char letter = static_cast<char>(std::toupper(static_cast<unsigned char>(rulestring[position])));
+        position++;
+
+        switch(letter)
+        {
+            case 'R':
+                radius = parse_number(rulestring, position);
+                break;
+            case 'C':
+                // C0 is the same as C2, the usual live and dead
+                states = std::max(2, parse_number(rulestring, position));
+                break;
+            case 'M':
+                counts_middle = parse_number(rulestring, position) != 0;
+                break;
+            case 'S':
+                parse_range(rulestring, position, survival_min, survival_max);
+                has_survival = true;
+                break;
+            case 'B':
+                parse_range(rulestring, position, birth_min, birth_max);
+                has_birth = true;
+                break;
+            case 'N':
+                if(position >= rulestring.size() || std::toupper(static_cast<unsigned char>(rulestring[position])) != 'M')
+                {
+                    throw std::invalid_argument("Only the Moore neighbourhood (NM) is supported: " + rulestring);
+                }
+                position++;
+                break;
+            default:
+                throw std::invalid_argument("Unexpected character in the rulestring: " + rulestring);
+        }
+
+        if(position < rulestring.size())
+        {
+            if(rulestring[position] != ',')
+            {
+                throw std::invalid_argument("Expected a comma in the rulestring: " + rulestring);
+            }
+            position++;
+        }
+    }
+
+    if(radius < 1 || radius > 500)
+    {
+        throw std::invalid_argument("The radius must be 1 to 500: " + rulestring);
+    }
+    if(states > 256)
+    {
+        throw std::invalid_argument("The state count must be 256 at most: " + rulestring);
+    }
+    if(!has_survival || !has_birth)
+    {
+        throw std::invalid_argument("The rulestring needs both S and B: " + rulestring);
+    }
+}
+
+std::string LtLRule::to_string() const
+{
+    return "R" + std::to_string(radius) +
+           ",C" + std::to_string(states > 2 ? states : 0) +
+           ",M" + (counts_middle ? "1" : "0") +
+           ",S" + std::to_string(survival_min) + ".." + std::to_string(survival_max) +
+           ",B" + std::to_string(birth_min) + ".." + std::to_string(birth_max) +
+           ",NM";
+}
+
+LargerThanLife::LargerThanLife(int width, int height) :
+    grid_width{0},
+    grid_height{0},
+    wrap_grid{false},
+    rule{bosco_rule}
+{
+    resize_grid(width, height);
+}
+
+void LargerThanLife::clear_grid()
+{
+    cells.assign(static_cast<size_t>(grid_width) * static_cast<size_t>(grid_height), DEAD);
+}
+
+void LargerThanLife::resize_grid(int new_width, int new_height)
+{
+    grid_width = std::max(1, new_width);
+    grid_height = std::max(1, new_height);
+    clear_grid();
+}
+
+void LargerThanLife::set_cell(int x, int y, CELL state)
+{
+    if(x < 0 || x >= grid_width || y < 0 || y >= grid_height)
+    {
+        return;
+    }
+    cells[static_cast<size_t>(y) * static_cast<size_t>(grid_width) + static_cast<size_t>(x)] = state;
+}
+
+CELL LargerThanLife::get_cell(int x, int y) const
+{
+    if(x < 0 || x >= grid_width || y < 0 || y >= grid_height)
+    {
+        return DEAD;
+    }
+    return cells[static_cast<size_t>(y) * static_cast<size_t>(grid_width) + static_cast<size_t>(x)];
+}
+
+void LargerThanLife::set_wrap_grid(bool wrap)
+{
+    wrap_grid = wrap;
+}
+
+void LargerThanLife::set_rule(const LtLRule &new_rule)
+{
+    rule = new_rule;
+    for(CELL &cell : cells)
+    {
+        if(cell >= rule.states)
+        {
+            cell = DEAD;
+        }
+    }
+}
+
+LtLRule LargerThanLife::get_rule() const
+{
+    return rule;
+}
+
+int LargerThanLife::get_grid_width() const
+{
+    return grid_width;
+}
+
+int LargerThanLife::get_grid_height() const
+{
+    return grid_height;
+}
+
+void LargerThanLife::sum_row(int y)
+{
+    const int radius = rule.radius;
+    const CELL *row = cells.data() + static_cast<size_t>(y) * static_cast<size_t>(grid_width);
+
+    /*
+     * Pad the row with the cells from across the edges, then turn it into
+     * a prefix sum. The sum over any window is then a single subtraction.
+     */
+    const int padded_width = grid_width + 2 * radius;
+    padded_row.resize(static_cast<size_t>(padded_width) + 1);
+    padded_row[0] = 0;
+    for(int i = 0; i < padded_width; i++)
+    {
+        int x = i - radius;
+        uint32_t alive = 0;
+        if(x >= 0 && x < grid_width)
+        {
+            alive = row[x] == ALIVE;
+        }
+        else if(wrap_grid)
+        {
+            x = ((x % grid_width) + grid_width) % grid_width;
+            alive = row[x] == ALIVE;
+        }
+        padded_row[static_cast<size_t>(i) + 1] = padded_row[static_cast<size_t>(i)] + alive;
+    }
+
+    uint32_t *sums = row_sums.data() + static_cast<size_t>(y) * static_cast<size_t>(grid_width);
+    const uint32_t *window_end = padded_row.data() + 2 * radius + 1;
+    for(int x = 0; x < grid_width; x++)
+    {
+        sums[x] = window_end[x] - padded_row[static_cast<size_t>(x)];
+    }
+}
+
+void LargerThanLife::add_row_sums(int y, int sign)
+{
+    if(y < 0 || y >= grid_height)
+    {
+        if(!wrap_grid)
+        {
+            return;
+        }
+        y = ((y % grid_height) + grid_height) % grid_height;
+    }
+
+    const uint32_t *sums = row_sums.data() + static_cast<size_t>(y) * static_cast<size_t>(grid_width);
+    if(sign > 0)
+    {
+        for(int x = 0; x < grid_width; x++)
+        {
+            column_sums[static_cast<size_t>(x)] += sums[x];
+        }
+    }
+    else
+    {
+        for(int x = 0; x < grid_width; x++)
+        {
+            column_sums[static_cast<size_t>(x)] -= sums[x];
+        }
+    }
+}
+
+void LargerThanLife::next_generation()
+{
+    const int radius = rule.radius;
+
+    row_sums.resize(cells.size());
+    cells_next_generation.resize(cells.size());
+    column_sums.assign(static_cast<size_t>(grid_width), 0);
+
+    for(int y = 0; y < grid_height; y++)
+    {
+        sum_row(y);
+    }
+
+    // The box of the first row
+    for(int y = -radius; y <= radius; y++)
+    {
+        add_row_sums(y, 1);
+    }
+
+    for(int y = 0; y < grid_height; y++)
+    {
+        const CELL *row = cells.data() + static_cast<size_t>(y) * static_cast<size_t>(grid_width);
+        CELL *next = cells_next_generation.data() + static_cast<size_t>(y) * static_cast<size_t>(grid_width);
+
+        for(int x = 0; x < grid_width; x++)
+        {
+            const CELL state = row[x];
+            int count = static_cast<int>(column_sums[static_cast<size_t>(x)]);
+            if(state == ALIVE && !rule.counts_middle)
+            {
+                count--;
+            }
+
+            if(state == DEAD)
+            {
+                next[x] = count >= rule.birth_min && count <= rule.birth_max ? ALIVE : DEAD;
+            }
+            else if(state == ALIVE && count >= rule.survival_min && count <= rule.survival_max)
+            {
+                next[x] = ALIVE;
+            }
+            else
+            {
+                // Start dying, or keep on dying, until past the last state
+                const int next_state = state + 1;
+                next[x] = next_state < rule.states ? static_cast<CELL>(next_state) : DEAD;
+            }
+        }
+
+        // Slide the box down by a row
+        add_row_sums(y + radius + 1, 1);
+        add_row_sums(y - radius, -1);
+    }
+
+    std::swap(cells, cells_next_generation);
+}
+
+void LargerThanLife::load_grid(const LifeGrid &grid)
+{
+    resize_grid(grid.get_grid_width(), grid.get_grid_height());
+    for(int y = 0; y < grid_height; y++)
+    {
+        for(int x = 0; x < grid_width; x++)
+        {
+            if(grid.get_cell(x, y) == ALIVE)
+            {
+                set_cell(x, y, ALIVE);
+            }
+        }
+    }
+}
+
+void LargerThanLife::store_grid(LifeGrid &grid) const
+{
+    grid.clear_grid();
+    const int width = std::min(grid_width, grid.get_grid_width());
+    const int height = std::min(grid_height, grid.get_grid_height());
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            if(get_cell(x, y) == ALIVE)
+            {
+                grid.set_cell(x, y, ALIVE);
+            }
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#ifndef LARGERTHANLIFE_H
+#define LARGERTHANLIFE_H
+
+#include "cellkernel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class LifeGrid;
+
+/*!
+ * \brief A Larger than Life rule, like Bosco's rule R5,C0,M1,S34..58,B34..45,NM
+ * \details The neighbourhood is the (2*radius+1)^2 box around the cell. A dead cell
+ *          is born if the live cell count is in [birth_min, birth_max], and a live cell
+ *          survives if the count is in [survival_min, survival_max]. With more than two
+ *          states, the cells that don't survive go through the dying states like in
+ *          the Generations rules.
+ */
+struct LtLRule
+{
+    /*!
+     * \brief The distance to the farthest neighbour
+     */
+    int radius;
+
+    /*!
+     * \brief The amount of cell states, DEAD and ALIVE included
+     */
+    int states;
+
+    /*!
+     * \brief Is the cell itself counted as its own neighbour?
+     */
+    bool counts_middle;
+
+    int survival_min;
+    int survival_max;
+    int birth_min;
+    int birth_max;
+
+    /*!
+     * \brief Construct the rule from the ranges
+     */
+    constexpr LtLRule(int range, int survival_from, int survival_to, int birth_from, int birth_to, bool middle=false, int state_count=2) :
+        radius{range},
+        states{state_count},
+        counts_middle{middle},
+        survival_min{survival_from},
+        survival_max{survival_to},
+        birth_min{birth_from},
+        birth_max{birth_to}
+    {
+    }
+
+    /*!
+     * \brief Parses a rulestring
+     * \details Accepts the comma separated notation, like "R5,C0,M1,S34..58,B34..45,NM".
+     *          C0 and C2 both mean two states. Only the Moore neighbourhood (NM) is supported.
+     *          Throws std::invalid_argument if the rulestring can't be parsed.
+     * \param rulestring The rule to parse
+     */
+    explicit LtLRule(const std::string &rulestring);
+
+    /*!
+     * \brief Formats the rule in the comma separated notation
+     * \return The rulestring, like "R5,C0,M1,S34..58,B34..45,NM"
+     */
+    std::string to_string() const;
+
+    constexpr bool operator==(const LtLRule &other) const
+    {
+        return radius == other.radius && states == other.states && counts_middle == other.counts_middle &&
+               survival_min == other.survival_min && survival_max == other.survival_max &&
+               birth_min == other.birth_min && birth_max == other.birth_max;
+    }
+};
+
+/*!
+ * \brief R5,C0,M1,S34..58,B34..45,NM, Bosco's rule
+ */
+constexpr LtLRule bosco_rule{5, 34, 58, 34, 45, true};
+
+/*!
+ * \brief A grid stepped with a Larger than Life rule
+ * \details The neighbour counts come from running box sums: every row is summed
+ *          horizontally over the width of the box first, and those sums are then
+ *          summed vertically, adding the row entering the box and subtracting the
+ *          one leaving it. The cost per cell stays the same no matter the radius.
+ */
+class LargerThanLife
+{
+  public:
+    /*!
+     * \brief Creates an empty width * height grid, stepped with Bosco's rule
+     */
+    LargerThanLife(int width=5, int height=5);
+
+    /*!
+     * \brief Kills all cells in the grid
+     */
+    void clear_grid();
+
+    /*!
+     * \brief Resizes the grid and kills all cells in it
+     * \param new_width The new width of the grid, at least 1
+     * \param new_height The new height of the grid, at least 1
+     */
+    void resize_grid(int new_width, int new_height);
+
+    /*!
+     * \brief Sets the cell value accordingly
+     * \details The cells outside of the grid are left alone
+     * \param x The column. The 1st column is 0
+     * \param y The row. The 1st row is 0
+     * \param state The wanted state of the cell
+     */
+    void set_cell(int x, int y, CELL state);
+
+    /*!
+     * \brief Fetch the state of a certain cell
+     * \param x The column. The 1st column is 0
+     * \param y The row. The 1st row is 0
+     * \return The cell state, DEAD if outside of the grid
+     */
+    CELL get_cell(int x, int y) const;
+
+    /*!
+     * \brief Set grid wrap
+     * \details If the box is larger than the grid, the wrapped cells are counted again
+     * \param wrap Should the grid wrap around itself?
+     */
+    void set_wrap_grid(bool wrap);
+
+    /*!
+     * \brief Change the rule the grid is stepped with
+     * \details The cells in the states the new rule doesn't have are killed
+     * \param new_rule The wanted rule
+     */
+    void set_rule(const LtLRule &new_rule);
+
+    /*!
+     * \brief Grab the rule in use
+     * \return The current rule
+     */
+    LtLRule get_rule() const;
+
+    /*!
+     * \brief Updates the whole grid into the next generation
+     */
+    void next_generation();
+
+    int get_grid_width() const;
+    int get_grid_height() const;
+
+    /*!
+     * \brief Replaces the contents with the live cells of the grid
+     * \details Resizes to the size of the grid
+     * \param grid The grid to copy
+     */
+    void load_grid(const LifeGrid &grid);
+
+    /*!
+     * \brief Copies the live cells into the grid
+     * \details The cells outside of the grid are left out
+     * \param grid The grid to overwrite
+     */
+    void store_grid(LifeGrid &grid) const;
+
+  private:
+    /*!
+     * \brief Sums the live cells of a row over the width of the box, into row_sums
+     */
+    void sum_row(int y);
+
+    /*!
+     * \brief Adds the horizontal sums of a row to column_sums, multiplied by sign
+     * \details Rows outside of the grid are either wrapped around or skipped
+     */
+    void add_row_sums(int y, int sign);
+
+    int grid_width;
+    int grid_height;
+    bool wrap_grid;
+    LtLRule rule;
+
+    std::vector<CELL> cells;
+
+    /*!
+     * \brief The next state of the grid. Swapped with cells after a step.
+     */
+    std::vector<CELL> cells_next_generation;
+
+    /*!
+     * \brief The live cells of a row, with radius cells from the opposite edges, or dead cells, on both sides
+     */
+    std::vector<uint32_t> padded_row;
+
+    /*!
+     * \brief The horizontal sums of every row, grid_width per row
+     */
+    std::vector<uint32_t> row_sums;
+
+    /*!
+     * \brief The box sums of the current row
+     */
+    std::vector<uint32_t> column_sums;
+};
+
+#endif // LARGERTHANLIFE_H
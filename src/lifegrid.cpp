@@ -1,24 +1,360 @@
 #include "lifegrid.h"
+#include "lookupkernel.h"
+#include "wordkernel.h"
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
+#include <new>
 #include <numeric>
-#include <exception>
+#include <stdexcept>
 #include <type_traits>
+#include <thread>
+#include <utility>
 
-#include <QPainter>
-#include <QGraphicsSceneMouseEvent>
-#include <QGraphicsSceneWheelEvent>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+
+/*
+ * Sixteen cells of the byte engines, written with the GCC vector extensions like the row kernels.
+ * The comparisons give all ones in the bytes where they hold.
+ */
+typedef unsigned char CellBytes __attribute__((vector_size(16)));
+
+// Every byte set to one, or ALIVE
+constexpr uint64_t one_bytes = 0x0101010101010101u;
+
+// The highest bit set in the bytes that are zero
+uint64_t zero_bytes(uint64_t bytes)
+{
+    const uint64_t low_bits = 0x7f7f7f7f7f7f7f7fu;
+    return ~(((bytes & low_bits) + low_bits) | bytes | low_bits);
+}
+
+// Gathers the highest bits of the bytes into the lowest byte, the first byte in memory into bit 0
+uint64_t gather_byte_bits(uint64_t high_bits)
+{
+    return ((high_bits >> 7) * 0x0102040810204080u) >> 56;
+}
+
+// Sums up the bytes of a word, as long as none of them is over 64
+uint64_t sum_bytes(uint64_t bytes)
+{
+    const uint64_t pairs = (bytes & 0x00ff00ff00ff00ffu) + ((bytes >> 8) & 0x00ff00ff00ff00ffu);
+    return (pairs * 0x0001000100010001u) >> 48;
+}
+
+// Sums up the bytes of a vector, as long as none of them is over 64
+uint64_t sum_bytes(CellBytes bytes)
+{
+    uint64_t halves[2];
+    std::memcpy(halves, &bytes, sizeof(halves));
+    return sum_bytes(halves[0]) + sum_bytes(halves[1]);
+}
+
+// Reads up to 8 cells into the bytes of a word, the rest are dead
+uint64_t load_cell_bytes(const CELL *cells, int count)
+{
+    uint64_t bytes = 0;
+    if(count >= 8)
+    {
+        std::memcpy(&bytes, cells, 8);
+    }
+    else
+    {
+        std::memcpy(&bytes, cells, static_cast<size_t>(count));
+    }
+    return bytes;
+}
+
+// The live cells of a packed tile, whether it holds anything, and its births and deaths
+struct PackedTally
+{
+    uint32_t count;
+    uint64_t occupied;
+    uint64_t born;
+    uint64_t died;
+};
+
+/*
+ * Tallies the rows of a packed tile, starting from the first word of the tile in every plane.
+ * The bits are counted with the popcnt instruction if HARDWARE_POPCOUNT is set, in which case
+ * the target of the caller must have it. SINGLE_PLANE lets the two state rules skip the plane loops.
+ */
+template<bool HARDWARE_POPCOUNT, bool SINGLE_PLANE>
+WORD_KERNEL_INLINE PackedTally tally_packed_rows(
+    const uint64_t *current,
+    const uint64_t *previous,
+    size_t row_stride,
+    int rows,
+    int words,
+    uint64_t last_mask,
+    size_t plane_size,
+    int planes
+)
+{
+    if constexpr(SINGLE_PLANE)
+    {
+        planes = 1;
+    }
+
+    const auto count_bits = [](uint64_t bits) -> uint64_t
+    {
+        if constexpr(HARDWARE_POPCOUNT)
+        {
+            return static_cast<uint64_t>(__builtin_popcountll(bits));
+        }
+        else
+        {
+            return count_word_bits<uint64_t>(bits);
+        }
+    };
+
+    // A live cell has only the lowest bit of its state set
+    const auto live_cells = [plane_size, planes](const uint64_t *buffer, size_t index)
+    {
+        uint64_t bits = buffer[index];
+        for(int plane = 1; plane < planes; plane++)
+        {
+            bits &= ~buffer[index + plane_size * static_cast<size_t>(plane)];
+        }
+        return bits;
+    };
+
+    PackedTally tally{0, 0, 0, 0};
+    for(int y = 0; y < rows; y++)
+    {
+        for(int word = 0; word < words; word++)
+        {
+            // Only the last word of a row has bits past the width, which may hold a ghost cell
+            const size_t index = row_stride * static_cast<size_t>(y) + static_cast<size_t>(word);
+            const uint64_t mask = word == words - 1 ? last_mask : ~uint64_t{0};
+            const uint64_t now = live_cells(current, index) & mask;
+            tally.count += static_cast<uint32_t>(count_bits(now));
+
+            for(int plane = 0; plane < planes; plane++)
+            {
+                tally.occupied |= current[index + plane_size * static_cast<size_t>(plane)] & mask;
+            }
+
+            if(previous)
+            {
+                const uint64_t before = live_cells(previous, index) & mask;
+                tally.born += count_bits(now & ~before);
+                tally.died += count_bits(before & ~now);
+            }
+        }
+    }
+    return tally;
+}
+
+/*
+ * Adds the live cells of a packed row to the counts of its tiles, and marks the tiles holding
+ * any state. The bits are counted like in tally_packed_rows().
+ */
+template<bool HARDWARE_POPCOUNT, bool SINGLE_PLANE>
+WORD_KERNEL_INLINE void count_packed_row_tiles(
+    const uint64_t *row,
+    int words,
+    int tile_words,
+    uint64_t last_mask,
+    size_t plane_size,
+    int planes,
+    uint32_t *counts,
+    unsigned char *occupied
+)
+{
+    if constexpr(SINGLE_PLANE)
+    {
+        planes = 1;
+    }
+
+    const auto count_tile = [=](int first_word, int last_word, uint64_t mask, size_t tile)
+    {
+        uint32_t count = 0;
+        uint64_t any_state = 0;
+        for(int word = first_word; word < last_word; word++)
+        {
+            // Only the last word of the row has bits past the width
+            const uint64_t word_mask = word == words - 1 ? mask : ~uint64_t{0};
+            uint64_t bits = row[word] & word_mask;
+            any_state |= bits;
+
+            // A live cell has only the lowest bit of its state set
+            for(int plane = 1; plane < planes; plane++)
+            {
+                const uint64_t plane_bits = row[static_cast<size_t>(word) + plane_size * static_cast<size_t>(plane)] & word_mask;
+                bits &= ~plane_bits;
+                any_state |= plane_bits;
+            }
+
+            if constexpr(HARDWARE_POPCOUNT)
+            {
+                count += static_cast<uint32_t>(__builtin_popcountll(bits));
+            }
+            else
+            {
+                count += static_cast<uint32_t>(count_word_bits<uint64_t>(bits));
+            }
+        }
+
+        counts[tile] += count;
+        occupied[tile] |= any_state != 0;
+    };
+
+    // The full tiles have no bits past the width, the last one is counted after them
+    const int last_tile = (words - 1) / tile_words;
+    for(int tile = 0; tile < last_tile; tile++)
+    {
+        count_tile(tile * tile_words, (tile + 1) * tile_words, ~uint64_t{0}, static_cast<size_t>(tile));
+    }
+    count_tile(last_tile * tile_words, words, last_mask, static_cast<size_t>(last_tile));
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+__attribute__((target("popcnt")))
+void count_packed_row_tiles_popcnt(const uint64_t *row, int words, int tile_words, uint64_t last_mask, size_t plane_size, int planes, uint32_t *counts, unsigned char *occupied)
+{
+    if(planes == 1)
+    {
+        count_packed_row_tiles<true, true>(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+        return;
+    }
+    count_packed_row_tiles<true, false>(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+}
+
+__attribute__((target("popcnt")))
+PackedTally tally_packed_rows_popcnt(const uint64_t *current, const uint64_t *previous, size_t row_stride, int rows, int words, uint64_t last_mask, size_t plane_size, int planes)
+{
+    if(planes == 1)
+    {
+        return tally_packed_rows<true, true>(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+    }
+    return tally_packed_rows<true, false>(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+}
+
+// The CPU isn't going to change, so probe it only once
+bool has_popcount()
+{
+    static const bool supported = __builtin_cpu_supports("popcnt");
+    return supported;
+}
+#endif
+
+// Tallies the rows of a packed tile with the fastest bit count the CPU has
+PackedTally tally_packed_tile_rows(const uint64_t *current, const uint64_t *previous, size_t row_stride, int rows, int words, uint64_t last_mask, size_t plane_size, int planes)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if(has_popcount())
+    {
+        return tally_packed_rows_popcnt(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+    }
+    if(planes == 1)
+    {
+        return tally_packed_rows<false, true>(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+    }
+    return tally_packed_rows<false, false>(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+#else
+    if(planes == 1)
+    {
+        return tally_packed_rows<true, true>(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+    }
+    return tally_packed_rows<true, false>(current, previous, row_stride, rows, words, last_mask, plane_size, planes);
+#endif
+}
+
+// Counts a packed row into its tiles with the fastest bit count the CPU has
+void count_packed_row(const uint64_t *row, int words, int tile_words, uint64_t last_mask, size_t plane_size, int planes, uint32_t *counts, unsigned char *occupied)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if(has_popcount())
+    {
+        count_packed_row_tiles_popcnt(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+        return;
+    }
+    if(planes == 1)
+    {
+        count_packed_row_tiles<false, true>(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+        return;
+    }
+    count_packed_row_tiles<false, false>(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+#else
+    if(planes == 1)
+    {
+        count_packed_row_tiles<true, true>(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+        return;
+    }
+    count_packed_row_tiles<true, false>(row, words, tile_words, last_mask, plane_size, planes, counts, occupied);
+#endif
+}
+
+// The size of a huge page on x86, the buffers at least this big are aligned to one
+constexpr size_t huge_page_bytes = size_t{2} << 20;
+
+// A changed tile waits for every collector
+constexpr unsigned char every_collector = 0xff;
+
+}
+
+void *allocate_grid_memory(size_t bytes)
+{
+    if(bytes < huge_page_bytes)
+    {
+        return ::operator new(bytes);
+    }
+
+    void *memory = ::operator new(bytes, std::align_val_t{huge_page_bytes});
+#ifdef __linux__
+    // Only a hint, the grid works the same without the huge pages
+    madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+    return memory;
+}
+
+void free_grid_memory(void *memory, size_t bytes)
+{
+    if(bytes < huge_page_bytes)
+    {
+        ::operator delete(memory);
+        return;
+    }
+    ::operator delete(memory, std::align_val_t{huge_page_bytes});
+}
 
 LifeGrid::LifeGrid(int size_n) :
     grid_width{size_n},
     grid_height{size_n},
+    words_per_row{(size_n + 63) / 64},
+    packed_row_stride{words_per_row + 2},
+    engine{PACKED_ENGINE},
+    row_kernel{best_row_kernel()},
+    rule{conway_rule},
+    tiles_x{0},
+    tiles_y{0},
+    generation{0},
+    population{0},
+    births{0},
+    deaths{0},
+    tile_statistics_stale{false},
+    tile_counts_stale{false},
+    dirty_first_row{0},
+    dirty_last_row{0},
+    cycle_max_period{0},
+    cycle_period{0},
+    hashes_valid{false},
+    hash_history_count{0},
+    block_hash_count{0},
+    cycle_check_steps{0},
     wrap_grid{false}
 {
     if(grid_width < 3 || grid_height < 3)
     {
         throw std::out_of_range("3x3 is the smallest supported grid size");
     }
-    cells = std::vector<CELL>(size_n * size_n, DEAD);
     resize_grid(size_n, size_n);
 }
 
@@ -28,10 +364,51 @@ LifeGrid::~LifeGrid()
 
 void LifeGrid::clear_grid()
 {
-    cells = std::vector<CELL>(grid_width * grid_height, DEAD);
+    reset_grid(true);
 }
 
-size_t LifeGrid::coord_to_index(int x, int y) const
+void LifeGrid::reset_grid(bool kill_cells)
+{
+    generation = 0;
+    reset_cycle_detection();
+    if(engine == PACKED_ENGINE)
+    {
+        // Both keep the capacity, so clearing or shrinking the grid doesn't allocate
+        const size_t size = packed_plane_size() * static_cast<size_t>(rule.get_state_bits());
+        if(kill_cells)
+        {
+            packed_cells.assign(size, 0);
+        }
+        else
+        {
+            packed_cells.resize(size);
+        }
+    }
+    else
+    {
+        cells.assign(static_cast<size_t>(grid_width + 2) * static_cast<size_t>(grid_height + 2), DEAD);
+    }
+
+    // The byte engines use the tiles for the statistics only
+    mark_all_tiles_changed();
+
+    // The next buffer may still hold anything
+    dirty_first_row = 0;
+    dirty_last_row = grid_height;
+
+    const size_t tile_count = static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y);
+    tile_population.assign(tile_count, 0);
+    tile_occupied.assign(tile_count, 0);
+    tile_row_births.assign(static_cast<size_t>(tiles_y), 0);
+    tile_row_deaths.assign(static_cast<size_t>(tiles_y), 0);
+    population = 0;
+    births = 0;
+    deaths = 0;
+    tile_statistics_stale = false;
+    tile_counts_stale = false;
+}
+
+void LifeGrid::clamp_coord(int &x, int &y) const
 {
     if(x >= grid_width)
     {
@@ -45,14 +422,25 @@ size_t LifeGrid::coord_to_index(int x, int y) const
 
     if(x < 0 || y < 0)
     {
-        return 0;
+        x = 0;
+        y = 0;
     }
+}
+
+size_t LifeGrid::coord_to_index(int x, int y) const
+{
+    clamp_coord(x, y);
+    return (static_cast<size_t>(grid_width + 2) * static_cast<size_t>(y + 1)) + static_cast<size_t>(x + 1);
+}
 
-    return (static_cast<size_t>(grid_width) * static_cast<size_t>(y)) + static_cast<size_t>(x);
+size_t LifeGrid::coord_to_word_index(int x, int y) const
+{
+    clamp_coord(x, y);
+    return (static_cast<size_t>(packed_row_stride) * static_cast<size_t>(y + 1)) + static_cast<size_t>(x / 64 + 1);
 }
 
 
-void LifeGrid::resize_grid(int new_width, int new_height)
+void LifeGrid::resize_grid(int new_width, int new_height, bool clear)
 {
     if(new_width <= 0)
     {
@@ -63,34 +451,104 @@ void LifeGrid::resize_grid(int new_width, int new_height)
         new_height = 1;
     }
 
-    const size_t total_cells = static_cast<size_t>(new_width * new_height);
-    const size_t total_cells_before = static_cast<size_t>(grid_width) * static_cast<size_t>(grid_height);
-    if (total_cells < total_cells_before)
+    // The old cells aren't copied over, reset_grid() kills them all unless told not to
+    grid_width = new_width;
+    grid_height = new_height;
+    words_per_row = (new_width + 63) / 64;
+    packed_row_stride = words_per_row + 2;
+    reset_grid(clear);
+}
+
+void LifeGrid::set_cell(const int x, const int y, const CELL state)
+{
+    reset_cycle_detection();
+
+    int column = x;
+    int row = y;
+    clamp_coord(column, row);
+
+    // The cell is taken off the statistics, and put back in its new state
+    count_row_population(row, column, column + 1, -1);
+
+    if(engine == PACKED_ENGINE)
     {
-        // TODO: Copy old contents into the new grid
-        grid_width = new_width;
-        grid_height = new_height;
-        cells.resize(total_cells);
+        set_packed_cell(column, row, state);
+
+        // The tile and its neighbours need to be stepped again
+        tile_changed[static_cast<size_t>((row / tile_rows) * tiles_x + column / (64 * tile_words))] = 1;
     }
     else
     {
-        // TODO: Copy old contents into the new grid
-        cells = std::vector<CELL>{total_cells, DEAD};
-        grid_width = new_width;
-        grid_height = new_height;
+        cells[coord_to_index(column, row)] = state;
     }
-}
 
-void LifeGrid::set_cell(const int x, const int y, const CELL state)
-{
-    size_t index = coord_to_index(x, y);
-    cells[index] = state;
+    count_row_population(row, column, column + 1, 1);
 }
 
-void LifeGrid::set_next_generation_cell(const int x, const int y, const CELL state)
+void LifeGrid::set_cell_run(int x, int y, int length, const CELL state)
 {
-    size_t index = coord_to_index(x, y);
-    cells_next_generation[index] = state;
+    if(y < 0 || y >= grid_height || length <= 0)
+    {
+        return;
+    }
+    reset_cycle_detection();
+
+    // Clip the run to the grid
+    const int end_x = static_cast<int>(std::min<long long>(static_cast<long long>(x) + length, grid_width));
+    x = std::max(x, 0);
+    if(x >= end_x)
+    {
+        return;
+    }
+
+    count_row_population(y, x, end_x, -1);
+
+    if(engine != PACKED_ENGINE)
+    {
+        CELL *row = cells.data() + coord_to_index(x, y);
+        std::fill(row, row + (end_x - x), state);
+        count_row_population(y, x, end_x, 1);
+        return;
+    }
+
+    const int first_word = x / 64;
+    const int last_word = (end_x - 1) / 64;
+    const size_t row_index = coord_to_word_index(0, y);
+    for(int plane = 0; plane < rule.get_state_bits(); plane++)
+    {
+        uint64_t *row = packed_cells.data() + packed_plane_size() * static_cast<size_t>(plane) + row_index;
+        const bool set = (state >> plane) & 1;
+        for(int word = first_word; word <= last_word; word++)
+        {
+            // The bits of the run within this word
+            uint64_t mask = ~uint64_t{0};
+            if(word == first_word)
+            {
+                mask &= ~uint64_t{0} << (x % 64);
+            }
+            if(word == last_word && end_x % 64 != 0)
+            {
+                mask &= ~uint64_t{0} >> (64 - end_x % 64);
+            }
+
+            if(set)
+            {
+                row[word] |= mask;
+            }
+            else
+            {
+                row[word] &= ~mask;
+            }
+        }
+    }
+
+    const size_t tile_row = static_cast<size_t>((y / tile_rows) * tiles_x);
+    for(int tile_x = x / (64 * tile_words); tile_x <= (end_x - 1) / (64 * tile_words); tile_x++)
+    {
+        tile_changed[tile_row + static_cast<size_t>(tile_x)] = 1;
+    }
+
+    count_row_population(y, x, end_x, 1);
 }
 
 /*!
@@ -117,10 +575,53 @@ CELL LifeGrid::get_cell(int x, int y) const
         y = 0;
     }
 
+    if(engine == PACKED_ENGINE)
+    {
+        clamp_coord(x, y);
+        return get_packed_cell(x, y);
+    }
+
     size_t index = coord_to_index(x, y);
     return cells[index];
 }
 
+size_t LifeGrid::packed_plane_size() const
+{
+    return static_cast<size_t>(packed_row_stride) * static_cast<size_t>(grid_height + 2);
+}
+
+void LifeGrid::set_packed_cell(int x, int y, CELL state)
+{
+    const size_t index = coord_to_word_index(x, y);
+    const uint64_t bit = uint64_t{1} << (x % 64);
+
+    // Bit N of the state goes into the plane N
+    for(int plane = 0; plane < rule.get_state_bits(); plane++)
+    {
+        uint64_t &word = packed_cells[packed_plane_size() * static_cast<size_t>(plane) + index];
+        if((state >> plane) & 1)
+        {
+            word |= bit;
+        }
+        else
+        {
+            word &= ~bit;
+        }
+    }
+}
+
+CELL LifeGrid::get_packed_cell(int x, int y) const
+{
+    const size_t index = coord_to_word_index(x, y);
+
+    int state = 0;
+    for(int plane = 0; plane < rule.get_state_bits(); plane++)
+    {
+        state |= static_cast<int>((packed_cells[packed_plane_size() * static_cast<size_t>(plane) + index] >> (x % 64)) & 1) << plane;
+    }
+    return static_cast<CELL>(state);
+}
+
 /*
  * Creates the glider one cell away from the top left corner
  */
@@ -149,113 +650,1457 @@ void LifeGrid::next_generation()
     /*
      * A quadtree would be nice for the larger grids.
      */
-
-    // Make sure there's enough space
-    cells_next_generation.resize(cells.size());
-
-    for(int y=0; y < grid_height; y++)
+    if(engine == PACKED_ENGINE)
     {
-        /* Kernel we will be updating as the grid is traversed through
-         * 0 1 2
-         * 3 4 5
-         * 6 7 8
-         */
-        CellKernel current_kernel{DEAD};
+        next_generation_packed();
+    }
+    else if(engine == LOOKUP_ENGINE)
+    {
+        next_generation_lookup();
+    }
+    else
+    {
+        next_generation_kernel();
+    }
+    generation++;
 
-        // If we're not on the top-row, we can grab the cells from the row above
-        if(y > 0)
+    if(cycle_max_period > 0)
+    {
+        // Only the packed two state stepping follows the tile hashes
+        if(engine != PACKED_ENGINE || rule.states > 2)
         {
-            current_kernel.cells[1] = get_cell(0, y-1);
-            current_kernel.cells[2] = get_cell(1, y-1);
+            hashes_valid = false;
         }
+        update_cycle_detection();
+    }
+}
 
-        current_kernel.cells[4] = get_cell(0, y);
-        current_kernel.cells[5] = get_cell(1, y);
-
-        // If we're not on the bottom row, we can grab the cells from the row below
-        if(y < grid_height - 1)
-        {
-            current_kernel.cells[7] = get_cell(0, y+1);
-            current_kernel.cells[8] = get_cell(1, y+1);
-        }
+void LifeGrid::advance(int generations)
+{
+    // The blocking is for the two state rules only
+    const bool is_blocked = engine == PACKED_ENGINE && rule.states <= 2;
 
-        for(int x=0; x < grid_width; x++)
+    if(cycle_max_period > 0)
+    {
+        while(generations > 0)
         {
-            /*
-             *  When grid wrapping is enabled we need to initialize more of
-             * the kernel cells when next to the grid borders.
-             *
-             * get_cell() will help us here, as it wraps the out-of-bound coordinates around.
-             */
-            if(wrap_grid)
+            // The whole cycles change nothing but the generation count
+            if(cycle_period > 0)
             {
-                if(y == 0)
-                {
-                    // This is the top row
-                    current_kernel.cells[0] = get_cell(x-1, y-1);
-                    current_kernel.cells[1] = get_cell(x,   y-1);
-                    current_kernel.cells[2] = get_cell(x+1, y-1);
-                }
-                else if(y == grid_height - 1)
+                const int skipped = generations - generations % cycle_period;
+                generation += static_cast<uint64_t>(skipped);
+                generations -= skipped;
+                if(generations == 0)
                 {
-                    // This is the bottom row
-                    current_kernel.cells[6] = get_cell(x-1, 0);
-                    current_kernel.cells[7] = get_cell(x,   0);
-                    current_kernel.cells[8] = get_cell(x+1, 0);
-                }
-
-                if(x == 0)
-                {
-                    // This is the first column
-                    current_kernel.cells[3] = get_cell(x-1, y);
-                    current_kernel.cells[0] = get_cell(x-1, y-1);
-                    current_kernel.cells[6] = get_cell(x-1, y+1);
-                }
-
-                else if(x == grid_width-1)
-                {
-                    // This is the last column
-                    current_kernel.cells[5] = get_cell(0, y);
-                    current_kernel.cells[2] = get_cell(0, y-1);
-                    current_kernel.cells[8] = get_cell(0, y+1);
+                    break;
                 }
             }
 
-            // Back to the usual rules, which are not affected whether or not the grid wraps
-
-            // If this isn't the rightmost column of the grid, fill
-            // the right kernel column with whatever data is available
-            if(x < grid_width - 1)
-            {
-                if(y > 0)
+            /*
+             * Only the generations after the blocks are hashed. Once they repeat, the
+             * generations are stepped one by one until the period is found.
+             * The last generation is stepped on its own, like below.
+             */
+            if(is_blocked && cycle_period == 0 && cycle_check_steps == 0 && generations > temporal_depth)
+            {
+                advance_packed_blocked(temporal_depth);
+                generations -= temporal_depth;
+                generation += static_cast<uint64_t>(temporal_depth);
+                update_block_cycle_detection();
+                continue;
+            }
+            next_generation();
+            generations--;
+            cycle_check_steps = std::max(0, cycle_check_steps - 1);
+        }
+        return;
+    }
+
+    if(!is_blocked)
+    {
+        for(int step = 0; step < generations; step++)
+        {
+            next_generation();
+        }
+        return;
+    }
+
+    /*
+     * A single generation gains nothing from the blocking, while the active tiles may skip most of it.
+     * The last generation is always stepped on its own, so that the births and deaths are of a single generation.
+     */
+    while(generations > 1)
+    {
+        const int depth = std::min(generations - 1, temporal_depth);
+        advance_packed_blocked(depth);
+        generations -= depth;
+        generation += static_cast<uint64_t>(depth);
+    }
+    if(generations == 1)
+    {
+        next_generation_packed();
+        generation++;
+    }
+}
+
+void LifeGrid::advance_packed_blocked(int generations)
+{
+    packed_next_generation.resize(packed_cells.size());
+
+    /*
+     * Make the bands as tall as the cache allows. Each band is stepped
+     * with `generations` extra rows on both sides, so the bands
+     * shouldn't get much shorter than that.
+     */
+    const size_t band_row_bytes = 2 * sizeof(uint64_t) * static_cast<size_t>(packed_row_stride);
+    const int fitting_rows = static_cast<int>(std::min<size_t>(temporal_block_bytes / band_row_bytes, static_cast<size_t>(grid_height)));
+    const int band_height = std::max({min_band_height, 2 * generations, fitting_rows - 2 * generations});
+    const int band_count = (grid_height + band_height - 1) / band_height;
+
+    run_in_bands(band_count, 1, [this, band_height, generations](int first_band, int last_band)
+    {
+        for(int band = first_band; band < last_band; band++)
+        {
+            const int first_y = band * band_height;
+            step_packed_block(first_y, std::min(grid_height, first_y + band_height), generations);
+        }
+    });
+
+    std::swap(packed_cells, packed_next_generation);
+
+    // The tiles weren't followed through the generations in between
+    mark_all_tiles_changed();
+    tile_statistics_stale = true;
+    hashes_valid = false;
+}
+
+void LifeGrid::step_packed_block(int first_y, int last_y, int generations)
+{
+    const size_t row_stride = static_cast<size_t>(packed_row_stride);
+    const int rows = last_y - first_y + 2 * generations;
+
+    // Band row r is the grid row first_y - generations + r
+    static thread_local std::vector<uint64_t> band;
+    static thread_local std::vector<uint64_t> band_next;
+    band.resize(row_stride * static_cast<size_t>(rows));
+    band_next.resize(band.size());
+
+    for(int r = 0; r < rows; r++)
+    {
+        int y = first_y - generations + r;
+        uint64_t *band_row = band.data() + row_stride * static_cast<size_t>(r);
+
+        // Past the top and bottom rows there's either the opposite edge or nothing
+        if(y < 0 || y >= grid_height)
+        {
+            if(!wrap_grid)
+            {
+                std::fill_n(band_row, row_stride, 0);
+                continue;
+            }
+            y = ((y % grid_height) + grid_height) % grid_height;
+        }
+
+        // The ghost words come along, they're refreshed before stepping anyway
+        std::copy_n(packed_cells.data() + coord_to_word_index(0, y) - 1, row_stride, band_row);
+    }
+
+    for(int step = 1; step <= generations; step++)
+    {
+        // The rows valid after this step, the ones outside are out of date
+        const int first_r = step;
+        const int last_r  = rows - step;
+
+        for(int r = first_r - 1; r < last_r + 1; r++)
+        {
+            refresh_packed_row_ghosts(band.data() + row_stride * static_cast<size_t>(r) + 1);
+        }
+
+        for(int r = first_r; r < last_r; r++)
+        {
+            const uint64_t *row = band.data() + row_stride * static_cast<size_t>(r) + 1;
+            uint64_t *next = band_next.data() + row_stride * static_cast<size_t>(r) + 1;
+
+            // Nothing lives outside of a grid that doesn't wrap
+            const int y = first_y - generations + r;
+            if(!wrap_grid && (y < 0 || y >= grid_height))
+            {
+                std::fill_n(next, words_per_row, 0);
+                continue;
+            }
+
+            step_packed_words(row_kernel, rule, row - row_stride, row, row + row_stride, next, nullptr, grid_width, 0, words_per_row);
+        }
+
+        std::swap(band, band_next);
+    }
+
+    for(int y = first_y; y < last_y; y++)
+    {
+        const uint64_t *band_row = band.data() + row_stride * static_cast<size_t>(y - first_y + generations) + 1;
+        std::copy_n(band_row, words_per_row, packed_next_generation.data() + coord_to_word_index(0, y));
+    }
+}
+
+void LifeGrid::next_generation_packed()
+{
+    if(rule.states > 2)
+    {
+        next_generation_packed_planes();
+        return;
+    }
+
+    // Make sure there's enough space
+    packed_next_generation.resize(packed_cells.size());
+    tile_changed_next.resize(tile_changed.size());
+
+    refresh_packed_halo();
+
+    run_in_bands(tiles_y, 1, [this](int first_tile_y, int last_tile_y)
+    {
+        step_packed_tiles(first_tile_y, last_tile_y);
+    });
+
+    /*
+     * The old generation is overwritten during the next step.
+     * The tiles that didn't change are the same in both buffers, so they
+     * can be skipped without copying them over.
+     */
+    std::swap(packed_cells, packed_next_generation);
+    std::swap(tile_changed, tile_changed_next);
+
+    if(tile_statistics_stale)
+    {
+        sum_tile_statistics(true);
+        tile_statistics_stale = false;
+        tile_counts_stale = false;
+        return;
+    }
+
+    births = std::accumulate(tile_row_births.begin(), tile_row_births.end(), uint64_t{0});
+    deaths = std::accumulate(tile_row_deaths.begin(), tile_row_deaths.end(), uint64_t{0});
+    population = population + births - deaths;
+    tile_counts_stale = true;
+}
+
+void LifeGrid::next_generation_packed_planes()
+{
+    packed_next_generation.resize(packed_cells.size());
+
+    refresh_packed_halo();
+
+    run_in_bands(grid_height, min_band_height, [this](int first_y, int last_y)
+    {
+        const size_t row_stride = static_cast<size_t>(packed_row_stride);
+        for(int y = first_y; y < last_y; y++)
+        {
+            const uint64_t *row = packed_cells.data() + coord_to_word_index(0, y);
+            uint64_t *next = packed_next_generation.data() + coord_to_word_index(0, y);
+            step_packed_generations_row(row_kernel, rule, row - row_stride, row, row + row_stride, next, packed_plane_size(), grid_width);
+        }
+    });
+
+    std::swap(packed_cells, packed_next_generation);
+
+    // The tiles aren't followed with the multi-state rules, everything is stepped every time
+    mark_all_tiles_changed();
+    tally_tiles(0, grid_height, true);
+}
+
+bool LifeGrid::tile_needs_step(int tile_x, int tile_y) const
+{
+    for(int dy = -1; dy <= 1; dy++)
+    {
+        for(int dx = -1; dx <= 1; dx++)
+        {
+            int x = tile_x + dx;
+            int y = tile_y + dy;
+
+            // Across the border there's either the opposite edge or nothing
+            if(x < 0 || x >= tiles_x || y < 0 || y >= tiles_y)
+            {
+                if(!wrap_grid)
                 {
-                    // Not the bottom row, so we can grab a cell from there
-                    current_kernel.cells[2] = get_cell(x+1, y-1);
+                    continue;
                 }
+                x = (x + tiles_x) % tiles_x;
+                y = (y + tiles_y) % tiles_y;
+            }
+
+            if(tile_changed[static_cast<size_t>(y * tiles_x + x)])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void LifeGrid::step_packed_tiles(int first_tile_y, int last_tile_y)
+{
+    const size_t row_stride = static_cast<size_t>(packed_row_stride);
+
+    /*
+     * The cells born and died in every word of the current tile row, counted by
+     * the row kernel while it has the words at hand. Both buffers are per thread,
+     * and keep their capacity between the steps.
+     */
+    static thread_local std::vector<uint64_t> tallies;
+    static thread_local std::vector<std::pair<int, int>> runs;
+    tallies.resize(static_cast<size_t>(words_per_row));
+
+    for(int tile_y = first_tile_y; tile_y < last_tile_y; tile_y++)
+    {
+        const int first_y = tile_y * tile_rows;
+        const int last_y  = std::min(grid_height, first_y + tile_rows);
+
+        /*
+         * Nothing around the skipped tiles changed, so neither will they.
+         * The neighbouring tiles to step are merged into runs, so the row
+         * kernel gets to work on as many words at a time as possible.
+         */
+        runs.clear();
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            if(!tile_needs_step(tile_x, tile_y))
+            {
+                continue;
+            }
+
+            if(!runs.empty() && runs.back().second == tile_x)
+            {
+                runs.back().second++;
+            }
+            else
+            {
+                runs.emplace_back(tile_x, tile_x + 1);
+            }
+        }
+
+        std::fill(tallies.begin(), tallies.end(), 0);
+        tile_row_births[static_cast<size_t>(tile_y)] = 0;
+        tile_row_deaths[static_cast<size_t>(tile_y)] = 0;
+
+        for(int y = first_y; y < last_y; y++)
+        {
+            // The ghost rows take care of the top and bottom edges
+            const uint64_t *row   = packed_cells.data() + coord_to_word_index(0, y);
+            const uint64_t *above = row - row_stride;
+            const uint64_t *below = row + row_stride;
+
+            uint64_t *next = packed_next_generation.data() + coord_to_word_index(0, y);
+
+            for(const auto &run : runs)
+            {
+                const int first_word = run.first * tile_words;
+                const int last_word  = std::min(words_per_row, run.second * tile_words);
+                step_packed_words(row_kernel, rule, above, row, below, next, tallies.data(), grid_width, first_word, last_word);
+            }
+        }
+
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            uint64_t born = 0;
+            uint64_t died = 0;
+            for(int word = tile_x * tile_words; word < std::min(words_per_row, (tile_x + 1) * tile_words); word++)
+            {
+                born += tallies[static_cast<size_t>(word)] & 0xffffffff;
+                died += tallies[static_cast<size_t>(word)] >> 32;
+            }
+
+            const size_t tile = static_cast<size_t>(tile_y * tiles_x + tile_x);
+            const bool changed = born != 0 || died != 0;
+            tile_changed_next[tile] = changed;
+
+            /*
+             * Only the totals follow the births and deaths, the tiles are counted again when
+             * they're needed. Unless the stepping went past the tiles, then everything is counted.
+             */
+            if(tile_statistics_stale)
+            {
+                tally_tile(packed_next_generation.data(), packed_cells.data(), tile_x, tile_y);
+            }
+            else if(changed)
+            {
+                tile_uncollected_changes[tile] = every_collector;
+                tile_row_births[static_cast<size_t>(tile_y)] += born;
+                tile_row_deaths[static_cast<size_t>(tile_y)] += died;
+            }
+
+            if(changed && hashes_valid)
+            {
+                tile_hashes[tile] = hash_packed_tile(packed_next_generation.data(), tile_x, tile_y);
+            }
+        }
+    }
+}
+
+void LifeGrid::mark_all_tiles_changed()
+{
+    tiles_x = (words_per_row + tile_words - 1) / tile_words;
+    tiles_y = (grid_height + tile_rows - 1) / tile_rows;
+    tile_changed.assign(static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y), 1);
+    tile_uncollected_changes.assign(tile_changed.size(), every_collector);
+}
+
+void LifeGrid::refresh_packed_row_ghosts(uint64_t *row) const
+{
+    // Drop the ghost cells of the previous generation
+    row[-1] = 0;
+    row[words_per_row] = 0;
+
+    const int last_bits = grid_width % 64;
+    if(last_bits)
+    {
+        row[words_per_row - 1] &= (uint64_t{1} << last_bits) - 1;
+    }
+
+    if(wrap_grid)
+    {
+        // The last column goes before the first one, and the first column after the last one
+        const int last = grid_width - 1;
+        row[-1] = ((row[last / 64] >> (last % 64)) & 1) << 63;
+        row[grid_width / 64] |= (row[0] & 1) << (grid_width % 64);
+    }
+}
+
+void LifeGrid::refresh_packed_halo()
+{
+    const size_t row_stride = static_cast<size_t>(packed_row_stride);
+
+    // Every state plane has a halo of its own
+    for(int plane = 0; plane < rule.get_state_bits(); plane++)
+    {
+        uint64_t *plane_cells = packed_cells.data() + packed_plane_size() * static_cast<size_t>(plane);
+
+        for(int y=0; y < grid_height; y++)
+        {
+            refresh_packed_row_ghosts(plane_cells + coord_to_word_index(0, y));
+        }
+
+        // The ghost rows are copied along with their ghost words, which takes care of the corners
+        uint64_t *top_ghost    = plane_cells;
+        uint64_t *bottom_ghost = plane_cells + row_stride * static_cast<size_t>(grid_height + 1);
+        if(wrap_grid)
+        {
+            std::copy_n(bottom_ghost - row_stride, row_stride, top_ghost);
+            std::copy_n(top_ghost + row_stride, row_stride, bottom_ghost);
+        }
+        else
+        {
+            std::fill_n(top_ghost, row_stride, 0);
+            std::fill_n(bottom_ghost, row_stride, 0);
+        }
+    }
+}
+
+void LifeGrid::refresh_kernel_halo()
+{
+    const size_t row_stride = static_cast<size_t>(grid_width + 2);
+
+    for(int y=0; y < grid_height; y++)
+    {
+        CELL *row = cells.data() + coord_to_index(0, y);
+        row[-1]         = wrap_grid ? row[grid_width - 1] : DEAD;
+        row[grid_width] = wrap_grid ? row[0] : DEAD;
+    }
+
+    CELL *top_ghost    = cells.data();
+    CELL *bottom_ghost = cells.data() + row_stride * static_cast<size_t>(grid_height + 1);
+    if(wrap_grid)
+    {
+        std::copy_n(bottom_ghost - row_stride, row_stride, top_ghost);
+        std::copy_n(top_ghost + row_stride, row_stride, bottom_ghost);
+    }
+    else
+    {
+        std::fill_n(top_ghost, row_stride, DEAD);
+        std::fill_n(bottom_ghost, row_stride, DEAD);
+    }
+}
+
+void LifeGrid::next_generation_kernel()
+{
+    // Make sure there's enough space. Allocates only when the grid has grown.
+    cells_next_generation.resize(cells.size());
+
+    refresh_kernel_halo();
+
+    int first_y = 0;
+    int last_y = grid_height;
+    clip_stepped_rows(first_y, last_y);
+
+    step_and_tally_rows(first_y, last_y, [this](int first_band_y, int last_band_y)
+    {
+        step_kernel_rows(first_band_y, last_band_y);
+    });
+
+    /*
+     * Every cell of the next generation was written, or cleared by clip_stepped_rows(),
+     * so the buffers can be swapped instead of copied. The ghost border of the old buffer
+     * is refreshed before the next step.
+     */
+    std::swap(cells, cells_next_generation);
+    sum_tile_statistics(true);
+}
+
+void LifeGrid::step_and_tally_rows(int first_y, int last_y, const std::function<void(int, int)> &step_rows)
+{
+    const int first_tile_y = first_y / tile_rows;
+    const int last_tile_y = (last_y + tile_rows - 1) / tile_rows;
+
+    // The rows outside had no cells to be born or to die
+    std::fill(tile_row_births.begin(), tile_row_births.end(), 0);
+    std::fill(tile_row_deaths.begin(), tile_row_deaths.end(), 0);
+
+    // The tiles are counted right after stepping them, while their rows are still in the cache
+    run_in_bands(last_tile_y - first_tile_y, 1, [&](int first_band, int last_band)
+    {
+        for(int tile_y = first_tile_y + first_band; tile_y < first_tile_y + last_band; tile_y++)
+        {
+            step_rows(std::max(first_y, tile_y * tile_rows), std::min(last_y, (tile_y + 1) * tile_rows));
+            for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+            {
+                tally_tile(cells_next_generation.data(), cells.data(), tile_x, tile_y);
+            }
+        }
+    });
+}
+
+void LifeGrid::step_kernel_rows(int first_y, int last_y)
+{
+    const size_t row_stride = static_cast<size_t>(grid_width + 2);
+
+    // The original rule is hard-coded into compute_state(), and it's the fastest
+    const bool is_conway = rule == conway_rule;
+
+    for(int y=first_y; y < last_y; y++)
+    {
+        // The ghost border takes care of the edges, whether the grid wraps or not
+        const CELL *row   = cells.data() + coord_to_index(0, y);
+        const CELL *above = row - row_stride;
+        const CELL *below = row + row_stride;
+
+        CELL *next = cells_next_generation.data() + coord_to_index(0, y);
+
+        /* Kernel we will be updating as the grid is traversed through
+         * 0 1 2
+         * 3 4 5
+         * 6 7 8
+         */
+        CellKernel current_kernel{{
+            above[-1], above[0], DEAD,
+            row[-1],   row[0],   DEAD,
+            below[-1], below[0], DEAD
+        }};
+
+        for(int x=0; x < grid_width; x++)
+        {
+            // Fill the right kernel column, the ghost cells are there past the last column
+            current_kernel.cells[2] = above[x+1];
+            current_kernel.cells[5] = row[x+1];
+            current_kernel.cells[8] = below[x+1];
+
+            // Update the next generation grid
+            next[x] = is_conway ? current_kernel.compute_state() : current_kernel.compute_state(rule);
+
+            // Move kernel contents left by one
+            current_kernel.step_right();
+        }
+    }
+}
+
+void LifeGrid::next_generation_lookup()
+{
+    // The tables are for the two state rules only
+    if(rule.states > 2)
+    {
+        next_generation_kernel();
+        return;
+    }
+
+    cells_next_generation.resize(cells.size());
+
+    if(rule != conway_rule && rule_block_table.empty())
+    {
+        build_lookup_tables(rule, rule_cell_table, rule_block_table);
+    }
+
+    refresh_kernel_halo();
+
+    int first_y = 0;
+    int last_y = grid_height;
+    clip_stepped_rows(first_y, last_y);
+
+    // The bands have to start on an even row, which the tile rows do
+    first_y -= first_y % 2;
+    step_and_tally_rows(first_y, last_y, [this](int first_band_y, int last_band_y)
+    {
+        step_lookup_rows(first_band_y, last_band_y);
+    });
+
+    std::swap(cells, cells_next_generation);
+    sum_tile_statistics(true);
+}
+
+void LifeGrid::step_lookup_rows(int first_y, int last_y)
+{
+    const size_t row_stride = static_cast<size_t>(grid_width + 2);
+
+    const bool is_conway = rule == conway_rule;
+    const CELL *cell_table = is_conway ? cell_state_table.data() : rule_cell_table.data();
+    const unsigned char *block_table = is_conway ? block_state_table.data() : rule_block_table.data();
+
+    // A single cell, using the 3x3 table. For the odd row and column left over from the blocks.
+    const auto step_cell = [this, row_stride, cell_table](int x, int y)
+    {
+        const CELL *centre = cells.data() + coord_to_index(x, y);
+
+        unsigned neighbourhood = 0;
+        for(int dy = -1; dy <= 1; dy++)
+        {
+            const CELL *row = centre + static_cast<std::ptrdiff_t>(row_stride) * dy;
+            neighbourhood |= static_cast<unsigned>(row[-1] | (row[0] << 1) | (row[1] << 2)) << (3 * (dy + 1));
+        }
+        cells_next_generation[coord_to_index(x, y)] = cell_table[neighbourhood];
+    };
+
+    int y = first_y;
+    for(; y + 1 < last_y; y += 2)
+    {
+        // The four rows of the 4x4 blocks, the ghost rows take care of the edges
+        const CELL *row_0 = cells.data() + coord_to_index(0, y) - row_stride;
+        const CELL *row_1 = row_0 + row_stride;
+        const CELL *row_2 = row_1 + row_stride;
+        const CELL *row_3 = row_2 + row_stride;
+
+        CELL *next_0 = cells_next_generation.data() + coord_to_index(0, y);
+        CELL *next_1 = next_0 + row_stride;
+
+        // A column of the block as four bits, the topmost cell being the lowest bit
+        const auto column = [=](int x)
+        {
+            return static_cast<unsigned>(row_0[x] | (row_1[x] << 1) | (row_2[x] << 2) | (row_3[x] << 3));
+        };
+
+        // The columns x-1 and x of the first block, the rest are shifted in as the block slides
+        unsigned block = column(-1) | (column(0) << 4);
+
+        int x = 0;
+        for(; x + 1 < grid_width; x += 2)
+        {
+            block |= (column(x + 1) << 8) | (column(x + 2) << 12);
+
+            const unsigned char state = block_table[block];
+            next_0[x]     = static_cast<CELL>(state & 1);
+            next_1[x]     = static_cast<CELL>((state >> 1) & 1);
+            next_0[x + 1] = static_cast<CELL>((state >> 2) & 1);
+            next_1[x + 1] = static_cast<CELL>((state >> 3) & 1);
+
+            block >>= 8;
+        }
+
+        if(x < grid_width)
+        {
+            step_cell(x, y);
+            step_cell(x, y + 1);
+        }
+    }
+
+    if(y < last_y)
+    {
+        for(int x = 0; x < grid_width; x++)
+        {
+            step_cell(x, y);
+        }
+    }
+}
+
+void LifeGrid::run_in_bands(int count, int min_band_size, const std::function<void(int, int)> &step_band)
+{
+    if(!worker_pool)
+    {
+        step_band(0, count);
+        return;
+    }
+
+    /*
+     * Every output row depends only on the three input rows around it,
+     * so the bands can be stepped independently of each other.
+     * A few bands per thread evens out the threads finishing at different times.
+     */
+    const int band_count = std::max(1, std::min(worker_pool->get_thread_count() * 4, count / min_band_size));
+
+    worker_pool->run(band_count, [&](int band)
+    {
+        const int first = static_cast<int>(static_cast<long long>(count) * band / band_count);
+        const int last  = static_cast<int>(static_cast<long long>(count) * (band + 1) / band_count);
+        step_band(first, last);
+    });
+}
+
+void LifeGrid::set_wrap_grid(bool wrap)
+{
+    if(wrap != wrap_grid)
+    {
+        reset_cycle_detection();
+    }
+    if(wrap != wrap_grid && engine == PACKED_ENGINE)
+    {
+        // The border tiles see different neighbours now
+        mark_all_tiles_changed();
+    }
+    wrap_grid = wrap;
+}
+
+bool LifeGrid::get_wrap_grid() const
+{
+    return wrap_grid;
+}
+
+void LifeGrid::set_cycle_detection(int max_period)
+{
+    cycle_max_period = std::max(0, max_period);
+    reset_cycle_detection();
+}
+
+int LifeGrid::get_cycle_period() const
+{
+    return cycle_period;
+}
+
+uint64_t LifeGrid::get_population() const
+{
+    return population;
+}
+
+uint64_t LifeGrid::get_births() const
+{
+    return births;
+}
+
+uint64_t LifeGrid::get_deaths() const
+{
+    return deaths;
+}
+
+bool LifeGrid::get_bounding_box(int &min_x, int &min_y, int &max_x, int &max_y) const
+{
+    refresh_tile_counts();
+
+    int box_min_x = grid_width;
+    int box_min_y = grid_height;
+    int box_max_x = -1;
+    int box_max_y = -1;
+
+    const auto is_occupied = [this](int tile_x, int tile_y)
+    {
+        return tile_occupied[static_cast<size_t>(tile_y * tiles_x + tile_x)] != 0;
+    };
+
+    /*
+     * The leftmost and rightmost cells of every tile row are within the first and
+     * last occupied tiles, and the tile may turn out empty with the dying states.
+     */
+    int first_tile_y = -1;
+    int last_tile_y = -1;
+    for(int tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        int left = tiles_x;
+        for(int tile_x = 0; tile_x < tiles_x && left == tiles_x; tile_x++)
+        {
+            if(is_occupied(tile_x, tile_y) && add_tile_bounds(tile_x, tile_y, box_min_x, box_min_y, box_max_x, box_max_y))
+            {
+                left = tile_x;
+            }
+        }
+        if(left == tiles_x)
+        {
+            continue;
+        }
+        for(int tile_x = tiles_x - 1; tile_x > left; tile_x--)
+        {
+            if(is_occupied(tile_x, tile_y) && add_tile_bounds(tile_x, tile_y, box_min_x, box_min_y, box_max_x, box_max_y))
+            {
+                break;
+            }
+        }
+
+        if(first_tile_y < 0)
+        {
+            first_tile_y = tile_y;
+        }
+        last_tile_y = tile_y;
+    }
+
+    if(first_tile_y < 0)
+    {
+        return false;
+    }
+
+    // The topmost and bottom cells can be in any tile of the first and last tile rows
+    for(int tile_y : {first_tile_y, last_tile_y})
+    {
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            if(is_occupied(tile_x, tile_y))
+            {
+                add_tile_bounds(tile_x, tile_y, box_min_x, box_min_y, box_max_x, box_max_y);
+            }
+        }
+    }
+
+    min_x = box_min_x;
+    min_y = box_min_y;
+    max_x = box_max_x;
+    max_y = box_max_y;
+    return true;
+}
+
+bool LifeGrid::add_tile_bounds(int tile_x, int tile_y, int &min_x, int &min_y, int &max_x, int &max_y) const
+{
+    const int first_word = tile_x * tile_words;
+    const int last_word = std::min(words_per_row, first_word + tile_words);
+    const int first_y = tile_y * tile_rows;
+    const int last_y = std::min(grid_height, first_y + tile_rows);
+
+    bool found = false;
+    for(int y = first_y; y < last_y; y++)
+    {
+        for(int word = first_word; word < last_word; word++)
+        {
+            const uint64_t bits = occupied_bits(y, word);
+            if(bits == 0)
+            {
+                continue;
+            }
+            found = true;
+            min_x = std::min(min_x, word * 64 + __builtin_ctzll(bits));
+            max_x = std::max(max_x, word * 64 + 63 - __builtin_clzll(bits));
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+        }
+    }
+    return found;
+}
+
+uint64_t LifeGrid::packed_word_mask(int word) const
+{
+    if(word == words_per_row - 1 && grid_width % 64 != 0)
+    {
+        return ~uint64_t{0} >> (64 - grid_width % 64);
+    }
+    return ~uint64_t{0};
+}
+
+uint64_t LifeGrid::alive_bits(int y, int word) const
+{
+    uint64_t bits = 0;
+    if(engine == PACKED_ENGINE)
+    {
+        const size_t index = coord_to_word_index(0, y) + static_cast<size_t>(word);
+        bits = packed_cells[index];
+
+        // A live cell has only the lowest bit of its state set
+        for(int plane = 1; plane < rule.get_state_bits(); plane++)
+        {
+            bits &= ~packed_cells[index + packed_plane_size() * static_cast<size_t>(plane)];
+        }
+    }
+    else
+    {
+        // Eight cells at a time, the bytes equal to ALIVE are found like the zero bytes
+        const CELL *row = cells.data() + coord_to_index(0, y);
+        const int count = std::min(64, grid_width - word * 64);
+        for(int x = 0; x < count; x += 8)
+        {
+            bits |= gather_byte_bits(zero_bytes(load_cell_bytes(row + word * 64 + x, count - x) ^ one_bytes)) << x;
+        }
+    }
+    return bits & packed_word_mask(word);
+}
+
+uint64_t LifeGrid::occupied_bits(int y, int word) const
+{
+    uint64_t bits = 0;
+    if(engine == PACKED_ENGINE)
+    {
+        const size_t index = coord_to_word_index(0, y) + static_cast<size_t>(word);
+        for(int plane = 0; plane < rule.get_state_bits(); plane++)
+        {
+            bits |= packed_cells[index + packed_plane_size() * static_cast<size_t>(plane)];
+        }
+    }
+    else
+    {
+        const CELL *row = cells.data() + coord_to_index(0, y);
+        const int count = std::min(64, grid_width - word * 64);
+        for(int x = 0; x < count; x += 8)
+        {
+            const uint64_t dead = zero_bytes(load_cell_bytes(row + word * 64 + x, count - x));
+            bits |= gather_byte_bits(~dead & ~one_bytes & (one_bytes << 7)) << x;
+        }
+    }
+    return bits & packed_word_mask(word);
+}
+
+void LifeGrid::count_row_population(int y, int first_x, int last_x, int sign)
+{
+    // Stale tile counts are adjusted all the same, refresh_tile_counts() counts them over anyway
+    const int tile_width = 64 * tile_words;
+    for(int tile_x = first_x / tile_width; tile_x <= (last_x - 1) / tile_width; tile_x++)
+    {
+        const int start = std::max(first_x, tile_x * tile_width);
+        const int end = std::min(last_x, (tile_x + 1) * tile_width);
+
+        uint32_t count = 0;
+        uint64_t occupied = 0;
+        for(int word = start / 64; word <= (end - 1) / 64; word++)
+        {
+            uint64_t mask = ~uint64_t{0};
+            if(word == start / 64)
+            {
+                mask &= ~uint64_t{0} << (start % 64);
+            }
+            if(word == (end - 1) / 64 && end % 64 != 0)
+            {
+                mask &= ~uint64_t{0} >> (64 - end % 64);
+            }
+            count += static_cast<uint32_t>(count_word_bits<uint64_t>(alive_bits(y, word) & mask));
+            occupied |= occupied_bits(y, word) & mask;
+        }
+
+        const size_t tile = static_cast<size_t>((y / tile_rows) * tiles_x + tile_x);
+        if(sign > 0)
+        {
+            tile_population[tile] += count;
+            population += count;
+            tile_uncollected_changes[tile] = every_collector;
+        }
+        else
+        {
+            tile_population[tile] -= count;
+            population -= count;
+        }
+
+        // Without the dying states a tile is occupied exactly when it has live cells
+        if(rule.states <= 2)
+        {
+            tile_occupied[tile] = tile_population[tile] > 0;
+        }
+        else if(occupied != 0)
+        {
+            tile_occupied[tile] = 1;
+        }
+    }
+}
+
+void LifeGrid::tally_tile(const uint64_t *current, const uint64_t *previous, int tile_x, int tile_y)
+{
+    const int first_word = tile_x * tile_words;
+    const int last_word = std::min(words_per_row, first_word + tile_words);
+    const int first_y = tile_y * tile_rows;
+    const int last_y = std::min(grid_height, first_y + tile_rows);
+    const size_t first_index = coord_to_word_index(0, first_y) + static_cast<size_t>(first_word);
+
+    const PackedTally tally = tally_packed_tile_rows(
+        current + first_index,
+        previous ? previous + first_index : nullptr,
+        static_cast<size_t>(packed_row_stride),
+        last_y - first_y,
+        last_word - first_word,
+        packed_word_mask(last_word - 1),
+        packed_plane_size(),
+        rule.get_state_bits()
+    );
+
+    const size_t tile = static_cast<size_t>(tile_y * tiles_x + tile_x);
+    if(previous && tallied_tile_changed(tile, tally.born, tally.died, tally.occupied != 0))
+    {
+        tile_uncollected_changes[tile] = every_collector;
+    }
+    tile_population[tile] = tally.count;
+    tile_occupied[tile] = tally.occupied != 0;
+    tile_row_births[static_cast<size_t>(tile_y)] += tally.born;
+    tile_row_deaths[static_cast<size_t>(tile_y)] += tally.died;
+}
+
+void LifeGrid::tally_tile(const CELL *current, const CELL *previous, int tile_x, int tile_y)
+{
+    const int first_x = tile_x * tile_words * 64;
+    const int last_x = std::min(grid_width, first_x + tile_words * 64);
+    const int first_y = tile_y * tile_rows;
+    const int last_y = std::min(grid_height, first_y + tile_rows);
+
+    /*
+     * Eight cells at a time, with the highest bit set in the bytes holding a live cell.
+     * The counts are kept per byte until the end of the row, which is at most 32 words long.
+     */
+    uint64_t count = 0;
+    uint64_t occupied = 0;
+    uint64_t born = 0;
+    uint64_t died = 0;
+    for(int y = first_y; y < last_y; y++)
+    {
+        const size_t row_index = coord_to_index(0, y);
+        const CELL *row = current + row_index;
+        const CELL *before = previous ? previous + row_index : nullptr;
+
+        // Sixteen at a time first, the comparisons subtract one for every match
+        CellBytes vector_count{};
+        CellBytes vector_born{};
+        CellBytes vector_died{};
+        CellBytes vector_occupied{};
+        int x = first_x;
+        for(; x + 16 <= last_x; x += 16)
+        {
+            CellBytes bytes;
+            std::memcpy(&bytes, row + x, sizeof(bytes));
+            const CellBytes alive = reinterpret_cast<CellBytes>(bytes == static_cast<unsigned char>(ALIVE));
+            vector_count -= alive;
+            vector_occupied |= bytes;
+
+            if(before)
+            {
+                CellBytes was;
+                std::memcpy(&was, before + x, sizeof(was));
+                const CellBytes was_alive = reinterpret_cast<CellBytes>(was == static_cast<unsigned char>(ALIVE));
+                vector_born -= alive & ~was_alive;
+                vector_died -= was_alive & ~alive;
+            }
+        }
+        count += sum_bytes(vector_count);
+        born += sum_bytes(vector_born);
+        died += sum_bytes(vector_died);
+        uint64_t occupied_halves[2];
+        std::memcpy(occupied_halves, &vector_occupied, sizeof(occupied_halves));
+        occupied |= occupied_halves[0] | occupied_halves[1];
+
+        uint64_t row_count = 0;
+        uint64_t row_born = 0;
+        uint64_t row_died = 0;
+        for(; x < last_x; x += 8)
+        {
+            const uint64_t bytes = load_cell_bytes(row + x, last_x - x);
+            const uint64_t alive = zero_bytes(bytes ^ one_bytes);
+            row_count += alive >> 7;
+            occupied |= bytes;
+
+            if(before)
+            {
+                const uint64_t was_alive = zero_bytes(load_cell_bytes(before + x, last_x - x) ^ one_bytes);
+                row_born += (alive & ~was_alive) >> 7;
+                row_died += (was_alive & ~alive) >> 7;
+            }
+        }
+        count += sum_bytes(row_count);
+        born += sum_bytes(row_born);
+        died += sum_bytes(row_died);
+    }
+
+    const size_t tile = static_cast<size_t>(tile_y * tiles_x + tile_x);
+    if(previous && tallied_tile_changed(tile, born, died, occupied != 0))
+    {
+        tile_uncollected_changes[tile] = every_collector;
+    }
+    tile_population[tile] = static_cast<uint32_t>(count);
+    tile_occupied[tile] = occupied != 0;
+    tile_row_births[static_cast<size_t>(tile_y)] += born;
+    tile_row_deaths[static_cast<size_t>(tile_y)] += died;
+}
+
+bool LifeGrid::tallied_tile_changed(size_t tile, uint64_t born, uint64_t died, bool occupied) const
+{
+    // The dying states move on by themselves, so any tile holding them before or after has changed
+    return born != 0 || died != 0 || (rule.states > 2 && (occupied || tile_occupied[tile]));
+}
+
+void LifeGrid::tally_tiles(int first_y, int last_y, bool count_changes)
+{
+    const int first_tile_y = first_y / tile_rows;
+    const int last_tile_y = (last_y + tile_rows - 1) / tile_rows;
+
+    // The rows outside had no cells to be born or to die
+    std::fill(tile_row_births.begin(), tile_row_births.end(), 0);
+    std::fill(tile_row_deaths.begin(), tile_row_deaths.end(), 0);
+
+    run_in_bands(last_tile_y - first_tile_y, 1, [this, first_tile_y, count_changes](int first_band, int last_band)
+    {
+        for(int tile_y = first_tile_y + first_band; tile_y < first_tile_y + last_band; tile_y++)
+        {
+            for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+            {
+                if(engine == PACKED_ENGINE)
+                {
+                    tally_tile(packed_cells.data(), count_changes ? packed_next_generation.data() : nullptr, tile_x, tile_y);
+                }
+                else
+                {
+                    tally_tile(cells.data(), count_changes ? cells_next_generation.data() : nullptr, tile_x, tile_y);
+                }
+            }
+        }
+    });
+
+    sum_tile_statistics(count_changes);
+    if(first_y == 0 && last_y == grid_height)
+    {
+        tile_counts_stale = false;
+    }
+}
+
+void LifeGrid::refresh_tile_counts() const
+{
+    // Only the two state packed steps leave the tiles behind
+    if(!tile_counts_stale)
+    {
+        return;
+    }
+
+    for(int tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        const int first_y = tile_y * tile_rows;
+        const int last_y = std::min(grid_height, first_y + tile_rows);
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            const int first_word = tile_x * tile_words;
+            const int last_word = std::min(words_per_row, first_word + tile_words);
+            const PackedTally tally = tally_packed_tile_rows(
+                packed_cells.data() + coord_to_word_index(0, first_y) + static_cast<size_t>(first_word),
+                nullptr,
+                static_cast<size_t>(packed_row_stride),
+                last_y - first_y,
+                last_word - first_word,
+                packed_word_mask(last_word - 1),
+                packed_plane_size(),
+                rule.get_state_bits()
+            );
+
+            const size_t tile = static_cast<size_t>(tile_y * tiles_x + tile_x);
+            tile_population[tile] = tally.count;
+            tile_occupied[tile] = tally.occupied != 0;
+        }
+    }
+    tile_counts_stale = false;
+}
 
-                current_kernel.cells[5] = get_cell(x+1, y);
+void LifeGrid::sum_tile_statistics(bool count_changes)
+{
+    population = std::accumulate(tile_population.begin(), tile_population.end(), uint64_t{0});
+    if(count_changes)
+    {
+        births = std::accumulate(tile_row_births.begin(), tile_row_births.end(), uint64_t{0});
+        deaths = std::accumulate(tile_row_deaths.begin(), tile_row_deaths.end(), uint64_t{0});
+    }
+}
 
-                if(y < grid_height - 1)
-                {
-                    // Not the top row, so we can grab a cell from there
-                    current_kernel.cells[8] = get_cell(x+1, y+1);
-                }
+void LifeGrid::clip_stepped_rows(int &first_y, int &last_y)
+{
+    first_y = 0;
+    last_y = grid_height;
+
+    /*
+     * The edges meet when wrapping, and with B0 the empty space comes alive.
+     * Otherwise the rows of the occupied tiles and a row around them are enough.
+     * Going by the tiles instead of the bounding box costs nothing to find out.
+     */
+    if(!wrap_grid && !(rule.birth & 1))
+    {
+        const auto first_occupied = std::find(tile_occupied.begin(), tile_occupied.end(), 1);
+        if(first_occupied == tile_occupied.end())
+        {
+            last_y = 0;
+        }
+        else
+        {
+            const auto last_occupied = std::find(tile_occupied.rbegin(), tile_occupied.rend(), 1);
+            const int first_tile_y = static_cast<int>(first_occupied - tile_occupied.begin()) / tiles_x;
+            const int last_tile_y = static_cast<int>(tile_occupied.rend() - last_occupied - 1) / tiles_x;
+            first_y = std::max(0, first_tile_y * tile_rows - 1);
+            last_y = std::min(grid_height, (last_tile_y + 1) * tile_rows + 1);
+        }
+    }
+
+    // The rows left out hold the generation before the current one, which may have had cells there
+    const size_t row_stride = static_cast<size_t>(grid_width + 2);
+    const auto clear_rows = [this, row_stride](int first, int last)
+    {
+        if(first < last)
+        {
+            // From the ghost cell on the left, past the ghost row above
+            const auto row = cells_next_generation.begin() + static_cast<std::ptrdiff_t>(row_stride * static_cast<size_t>(first + 1));
+            std::fill(row, row + static_cast<std::ptrdiff_t>(row_stride * static_cast<size_t>(last - first)), DEAD);
+        }
+    };
+    clear_rows(dirty_first_row, std::min(dirty_last_row, first_y));
+    clear_rows(std::max(dirty_first_row, last_y), dirty_last_row);
+
+    // After the swap, the next buffer holds the current generation, which fits in the stepped rows
+    dirty_first_row = first_y;
+    dirty_last_row = last_y;
+}
+
+void LifeGrid::reset_cycle_detection()
+{
+    hashes_valid = false;
+    cycle_period = 0;
+    hash_history_count = 0;
+    block_hash_count = 0;
+    cycle_check_steps = 0;
+}
+
+uint64_t LifeGrid::hash_packed_tile(const uint64_t *buffer, int tile_x, int tile_y) const
+{
+    const int first_word = tile_x * tile_words;
+    const int last_word = std::min(words_per_row, first_word + tile_words);
+    const int first_y = tile_y * tile_rows;
+    const int last_y = std::min(grid_height, first_y + tile_rows);
+
+    // The bits past the width may hold the ghost cells
+    const uint64_t last_word_mask = grid_width % 64 ? ~uint64_t{0} >> (64 - grid_width % 64) : ~uint64_t{0};
+
+    uint64_t hash = (static_cast<uint64_t>(tile_y) << 32 | static_cast<uint64_t>(tile_x)) * 0x9e3779b97f4a7c15u + 1;
+    for(int plane = 0; plane < rule.get_state_bits(); plane++)
+    {
+        const uint64_t *plane_start = buffer + packed_plane_size() * static_cast<size_t>(plane);
+        for(int y = first_y; y < last_y; y++)
+        {
+            const uint64_t *row = plane_start + coord_to_word_index(0, y);
+            for(int word = first_word; word < last_word; word++)
+            {
+                const uint64_t bits = word == words_per_row - 1 ? row[word] & last_word_mask : row[word];
+                hash = (hash ^ bits) * 0xbf58476d1ce4e5b9u;
+                hash ^= hash >> 31;
             }
+        }
+    }
+    return hash;
+}
 
-            // Update the next generation grid
-            const auto new_state = current_kernel.compute_state();
-            set_next_generation_cell(x, y, new_state);
+void LifeGrid::recompute_tile_hashes()
+{
+    const int tile_count_x = (words_per_row + tile_words - 1) / tile_words;
+    const int tile_count_y = (grid_height + tile_rows - 1) / tile_rows;
 
-            // Move kernel contents left by one
-            current_kernel.step_right();
+    // The byte engines are packed into a buffer of their own first
+    std::vector<uint64_t> packed;
+    const uint64_t *buffer = packed_cells.data();
+    if(engine != PACKED_ENGINE)
+    {
+        packed.assign(packed_plane_size() * static_cast<size_t>(rule.get_state_bits()), 0);
+        for(int plane = 0; plane < rule.get_state_bits(); plane++)
+        {
+            for(int y = 0; y < grid_height; y++)
+            {
+                get_row_bits(y, plane, packed.data() + packed_plane_size() * static_cast<size_t>(plane) + coord_to_word_index(0, y));
+            }
+        }
+        buffer = packed.data();
+    }
+
+    tile_hashes.resize(static_cast<size_t>(tile_count_x) * static_cast<size_t>(tile_count_y));
+    for(int tile_y = 0; tile_y < tile_count_y; tile_y++)
+    {
+        for(int tile_x = 0; tile_x < tile_count_x; tile_x++)
+        {
+            tile_hashes[static_cast<size_t>(tile_y * tile_count_x + tile_x)] = hash_packed_tile(buffer, tile_x, tile_y);
         }
     }
-    cells = cells_next_generation;
+    hashes_valid = true;
 }
 
-void LifeGrid::set_wrap_grid(bool wrap)
+uint64_t LifeGrid::update_cycle_detection()
 {
-    wrap_grid = wrap;
+    if(!hashes_valid)
+    {
+        recompute_tile_hashes();
+    }
+    const uint64_t hash = std::accumulate(tile_hashes.begin(), tile_hashes.end(), uint64_t{0});
+
+    const size_t history_size = static_cast<size_t>(cycle_max_period);
+    hash_history.resize(history_size);
+
+    // The shortest period matching the history wins
+    if(cycle_period == 0)
+    {
+        for(size_t period = 1; period <= std::min(hash_history_count, history_size); period++)
+        {
+            if(hash_history[(hash_history_count - period) % history_size] == hash)
+            {
+                cycle_period = static_cast<int>(period);
+                break;
+            }
+        }
+    }
+
+    hash_history[hash_history_count % history_size] = hash;
+    hash_history_count++;
+    return hash;
+}
+
+void LifeGrid::update_block_cycle_detection()
+{
+    hash_history_count = 0;
+    const uint64_t hash = update_cycle_detection();
+
+    const size_t history_size = static_cast<size_t>(cycle_max_period);
+    block_hash_history.resize(history_size);
+
+    /*
+     * The period divides the distance to the repeated block, but may be longer than looked for.
+     * The history starts over, so that a period too long isn't checked again after every block.
+     */
+    for(size_t block = 1; block <= std::min(block_hash_count, history_size); block++)
+    {
+        if(block_hash_history[(block_hash_count - block) % history_size] == hash)
+        {
+            cycle_check_steps = cycle_max_period;
+            block_hash_count = 0;
+            break;
+        }
+    }
+
+    block_hash_history[block_hash_count % history_size] = hash;
+    block_hash_count++;
+}
+
+uint64_t LifeGrid::get_generation() const
+{
+    return generation;
+}
+
+void LifeGrid::set_generation(uint64_t new_generation)
+{
+    generation = new_generation;
+}
+
+void LifeGrid::get_row_bits(int y, int plane, uint64_t *words) const
+{
+    get_row_bits(y, plane, 0, words_per_row, words);
+}
+
+void LifeGrid::get_row_bits(int y, int plane, int first_word, int last_word, uint64_t *words) const
+{
+    if(engine == PACKED_ENGINE)
+    {
+        const uint64_t *row = packed_cells.data() + packed_plane_size() * static_cast<size_t>(plane) + coord_to_word_index(0, y);
+        std::copy(row + first_word, row + last_word, words);
+
+        // The bits past the width may hold a ghost cell
+        if(last_word == words_per_row && first_word < last_word)
+        {
+            words[last_word - first_word - 1] &= packed_word_mask(words_per_row - 1);
+        }
+        return;
+    }
+
+    // Eight cells at a time, with the bit of the plane moved to the top of every byte
+    const CELL *row = cells.data() + coord_to_index(0, y);
+    for(int word = first_word; word < last_word; word++)
+    {
+        const int count = std::min(64, grid_width - word * 64);
+        uint64_t bits = 0;
+        for(int x = 0; x < count; x += 8)
+        {
+            const uint64_t bytes = load_cell_bytes(row + word * 64 + x, count - x);
+            bits |= gather_byte_bits((bytes << (7 - plane)) & (one_bytes << 7)) << x;
+        }
+        words[word - first_word] = bits;
+    }
+}
+
+void LifeGrid::set_row_bits(int y, int plane, const uint64_t *words)
+{
+    reset_cycle_detection();
+    count_row_population(y, 0, grid_width, -1);
+    write_row_bits(y, plane, words);
+    count_row_population(y, 0, grid_width, 1);
+}
+
+void LifeGrid::set_plane_bits(int plane, const uint64_t *words)
+{
+    reset_cycle_detection();
+    mark_all_tiles_changed();
+
+    /*
+     * Every row is replaced, so the tiles are counted over instead of taking the rows
+     * off the counts and putting them back. A packed row is counted right after it's
+     * written, while it's still in the cache.
+     */
+    if(engine == PACKED_ENGINE)
+    {
+        std::fill(tile_population.begin(), tile_population.end(), 0);
+        std::fill(tile_occupied.begin(), tile_occupied.end(), 0);
+        tile_counts_stale = false;
+
+        const uint64_t last_mask = packed_word_mask(words_per_row - 1);
+        for(int y = 0; y < grid_height; y++)
+        {
+            write_row_bits(y, plane, words + static_cast<size_t>(y) * static_cast<size_t>(words_per_row));
+
+            const size_t first_tile = static_cast<size_t>((y / tile_rows) * tiles_x);
+            count_packed_row(
+                packed_cells.data() + coord_to_word_index(0, y),
+                words_per_row,
+                tile_words,
+                last_mask,
+                packed_plane_size(),
+                rule.get_state_bits(),
+                tile_population.data() + first_tile,
+                tile_occupied.data() + first_tile
+            );
+        }
+
+        sum_tile_statistics(false);
+        return;
+    }
+
+    // The cells are counted a tile row at a time instead
+    for(int tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        const int first_y = tile_y * tile_rows;
+        const int last_y = std::min(grid_height, first_y + tile_rows);
+        for(int y = first_y; y < last_y; y++)
+        {
+            write_row_bits(y, plane, words + static_cast<size_t>(y) * static_cast<size_t>(words_per_row));
+        }
+
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            tally_tile(cells.data(), nullptr, tile_x, tile_y);
+        }
+    }
+
+    sum_tile_statistics(false);
+}
+
+void LifeGrid::write_row_bits(int y, int plane, const uint64_t *words)
+{
+    if(engine == PACKED_ENGINE)
+    {
+        uint64_t *row = packed_cells.data() + packed_plane_size() * static_cast<size_t>(plane) + coord_to_word_index(0, y);
+        std::copy(words, words + words_per_row, row);
+
+        // Keep the padding past the width dead
+        if(grid_width % 64 != 0)
+        {
+            row[words_per_row - 1] &= ~uint64_t{0} >> (64 - grid_width % 64);
+        }
+
+        const size_t tile_row = static_cast<size_t>((y / tile_rows) * tiles_x);
+        std::fill(tile_changed.begin() + static_cast<std::ptrdiff_t>(tile_row),
+                  tile_changed.begin() + static_cast<std::ptrdiff_t>(tile_row + static_cast<size_t>(tiles_x)), 1);
+    }
+    else
+    {
+        CELL *row = cells.data() + coord_to_index(0, y);
+        const int bit = 1 << plane;
+        for(int x = 0; x < grid_width; x++)
+        {
+            const int value = static_cast<int>((words[x / 64] >> (x % 64)) & 1);
+            row[x] = static_cast<CELL>((row[x] & ~bit) | (value << plane));
+        }
+    }
 }
 
 int LifeGrid::get_grid_width() const
@@ -267,3 +2112,228 @@ int LifeGrid::get_grid_height() const
 {
     return grid_height;
 }
+
+void LifeGrid::set_engine(GridEngine new_engine)
+{
+    // The cells stay the same, but the hashes are followed differently
+    hashes_valid = false;
+
+    // The byte engines go by the tile counts when stepping
+    refresh_tile_counts();
+
+    // KERNEL_ENGINE and LOOKUP_ENGINE share the byte buffers, only the packed one needs converting
+    if((new_engine == PACKED_ENGINE) == (engine == PACKED_ENGINE))
+    {
+        engine = new_engine;
+        return;
+    }
+
+    if(new_engine == PACKED_ENGINE)
+    {
+        packed_cells.assign(packed_plane_size() * static_cast<size_t>(rule.get_state_bits()), 0);
+        for(int y=0; y < grid_height; y++)
+        {
+            for(int x=0; x < grid_width; x++)
+            {
+                set_packed_cell(x, y, cells[coord_to_index(x, y)]);
+            }
+        }
+
+        mark_all_tiles_changed();
+
+        // Release the byte buffers, they would take eight times the memory
+        std::vector<CELL>().swap(cells);
+        std::vector<CELL>().swap(cells_next_generation);
+    }
+    else
+    {
+        cells.assign(static_cast<size_t>(grid_width + 2) * static_cast<size_t>(grid_height + 2), DEAD);
+        for(int y=0; y < grid_height; y++)
+        {
+            for(int x=0; x < grid_width; x++)
+            {
+                cells[coord_to_index(x, y)] = get_packed_cell(x, y);
+            }
+        }
+
+        // The next buffer is allocated again on the first step
+        dirty_first_row = 0;
+        dirty_last_row = grid_height;
+
+        decltype(packed_cells)().swap(packed_cells);
+        decltype(packed_next_generation)().swap(packed_next_generation);
+    }
+
+    engine = new_engine;
+}
+
+GridEngine LifeGrid::get_engine() const
+{
+    return engine;
+}
+
+void LifeGrid::set_row_kernel(RowKernel kernel)
+{
+    if(!is_row_kernel_supported(kernel))
+    {
+        throw std::invalid_argument("The row kernel isn't supported by this CPU");
+    }
+    row_kernel = kernel;
+}
+
+RowKernel LifeGrid::get_row_kernel() const
+{
+    return row_kernel;
+}
+
+void LifeGrid::set_rule(const LifeRule &new_rule)
+{
+    if(new_rule == rule)
+    {
+        return;
+    }
+    reset_cycle_detection();
+
+    // The states the new rule doesn't have are dropped, a word or a byte at a time
+    if(new_rule.states < rule.states)
+    {
+        if(engine == PACKED_ENGINE)
+        {
+            drop_packed_states(new_rule.states);
+        }
+        else
+        {
+            std::replace_if(cells.begin(), cells.end(), [&new_rule](CELL state)
+            {
+                return state >= new_rule.states;
+            }, DEAD);
+        }
+    }
+
+    /*
+     * The packed grid needs a plane for every bit of the states. The planes are one after
+     * another, so the ones kept stay where they are. The dropped ones hold no cells anymore,
+     * and the added ones start out empty.
+     */
+    if(engine == PACKED_ENGINE && new_rule.get_state_bits() != rule.get_state_bits())
+    {
+        const size_t old_size = packed_cells.size();
+        packed_cells.resize(packed_plane_size() * static_cast<size_t>(new_rule.get_state_bits()));
+        if(packed_cells.size() > old_size)
+        {
+            std::fill(packed_cells.begin() + static_cast<std::ptrdiff_t>(old_size), packed_cells.end(), 0);
+        }
+    }
+
+    rule = new_rule;
+
+    // Rebuilt when needed
+    rule_cell_table.clear();
+    rule_block_table.clear();
+
+    // The still parts of the grid may not be still anymore
+    if(engine == PACKED_ENGINE)
+    {
+        mark_all_tiles_changed();
+    }
+
+    // The cells may have lost their states
+    tally_tiles(0, grid_height, false);
+}
+
+void LifeGrid::drop_packed_states(int states)
+{
+    const int planes = rule.get_state_bits();
+    const size_t plane_size = packed_plane_size();
+    for(size_t index = 0; index < plane_size; index++)
+    {
+        // The cells at or above `states`, compared a bit at a time from the highest one
+        uint64_t above = 0;
+        uint64_t equal = ~uint64_t{0};
+        for(int plane = planes - 1; plane >= 0; plane--)
+        {
+            const uint64_t bits = packed_cells[plane_size * static_cast<size_t>(plane) + index];
+            if((states >> plane) & 1)
+            {
+                equal &= bits;
+            }
+            else
+            {
+                above |= equal & bits;
+                equal &= ~bits;
+            }
+        }
+
+        const uint64_t kept = ~(above | equal);
+        for(int plane = 0; plane < planes; plane++)
+        {
+            packed_cells[plane_size * static_cast<size_t>(plane) + index] &= kept;
+        }
+    }
+}
+
+void LifeGrid::set_rule(const std::string &rulestring)
+{
+    set_rule(LifeRule{rulestring});
+}
+
+LifeRule LifeGrid::get_rule() const
+{
+    return rule;
+}
+
+void LifeGrid::set_thread_count(int thread_count)
+{
+    if(thread_count <= 0)
+    {
+        thread_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    if(thread_count == get_thread_count())
+    {
+        return;
+    }
+
+    // A single thread steps the grid directly, without the pool
+    worker_pool.reset();
+    if(thread_count > 1)
+    {
+        worker_pool = std::make_unique<WorkerPool>(thread_count);
+    }
+}
+
+int LifeGrid::get_thread_count() const
+{
+    return worker_pool ? worker_pool->get_thread_count() : 1;
+}
+
+size_t LifeGrid::get_changed_tile_count() const
+{
+    return static_cast<size_t>(std::count(tile_changed.begin(), tile_changed.end(), 1));
+}
+
+void LifeGrid::collect_changed_tiles(std::vector<unsigned char> &changed, int collector)
+{
+    if(collector < 0 || collector >= change_collectors)
+    {
+        throw std::out_of_range("No change collector " + std::to_string(collector));
+    }
+
+    const unsigned char bit = static_cast<unsigned char>(1u << collector);
+    changed.resize(tile_uncollected_changes.size());
+    for(size_t tile = 0; tile < changed.size(); tile++)
+    {
+        changed[tile] = (tile_uncollected_changes[tile] & bit) != 0;
+        tile_uncollected_changes[tile] &= static_cast<unsigned char>(~bit);
+    }
+}
+
+int LifeGrid::get_tile_width() const
+{
+    return 64 * tile_words;
+}
+
+int LifeGrid::get_tile_height() const
+{
+    return tile_rows;
+}
@@ -2,9 +2,98 @@
 #define LIFEGRID_H
 
 #include "cellkernel.h"
+#include "liferule.h"
+#include "rowkernel.h"
+#include "workerpool.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+/*!
+ * \brief Allocates the memory of a packed grid
+ * \details The big buffers are aligned to huge pages, and on Linux backed by them when the
+ *          kernel has them to spare, which saves most of the page faults of the first write
+ * \param bytes The size of the buffer
+ * \return The buffer
+ */
+void *allocate_grid_memory(size_t bytes);
+
+/*!
+ * \brief Frees the memory from allocate_grid_memory()
+ * \param memory The buffer
+ * \param bytes The size of the buffer, as allocated
+ */
+void free_grid_memory(void *memory, size_t bytes);
+
+/*!
+ * \brief Allocates with allocate_grid_memory(), and leaves the elements added by resize() uninitialized
+ * \details For the buffers that are written over before they're read
+ */
+template <typename T>
+struct GridAllocator : std::allocator<T>
+{
+    template <typename U>
+    struct rebind
+    {
+        using other = GridAllocator<U>;
+    };
+
+    GridAllocator() = default;
+
+    template <typename U>
+    GridAllocator(const GridAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T*>(allocate_grid_memory(count * sizeof(T)));
+    }
+
+    void deallocate(T *memory, size_t count)
+    {
+        free_grid_memory(memory, count * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U *memory)
+    {
+        ::new(static_cast<void*>(memory)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *memory, Args&&... args)
+    {
+        ::new(static_cast<void*>(memory)) U(std::forward<Args>(args)...);
+    }
+};
+
+/*!
+ * \brief How the grid is stored and stepped
+ */
+enum GridEngine : unsigned char
+{
+    /*!
+     * One CELL per byte, stepped by dragging a CellKernel around. The reference implementation.
+     */
+    KERNEL_ENGINE,
+
+    /*!
+     * 64 cells packed into every uint64_t, stepped a word at a time with a WordKernel
+     */
+    PACKED_ENGINE,
+
+    /*!
+     * One CELL per byte like KERNEL_ENGINE, stepped 2x2 cells at a time with a lookup table
+     */
+    LOOKUP_ENGINE
+};
+
 /*!
  * \brief Class for basic management of the whole Game of Life grid
  * \details Handles the basic modifications of the grid
@@ -28,10 +117,14 @@ class LifeGrid
 
     /*!
      * \brief Resizes the grid
+     * \details The old cells aren't copied over, resizing clears the grid. Place them again
+     *          afterwards to keep them, e.g. with get_row_bits() and set_row_bits().
      * \param new_width The new width of the grid
      * \param new_height The new height of the grid
+     * \param clear Kill all cells. Otherwise the packed grid is left with whatever was in its
+     *        memory, for the loaders that write every plane with set_plane_bits() right after.
      */
-    void resize_grid(int new_width, int new_height);
+    void resize_grid(int new_width, int new_height, bool clear=true);
 
     /*!
      * \brief Creates the famous glider in the top-left corner
@@ -43,14 +136,34 @@ class LifeGrid
      */
     void next_generation();
 
+    /*!
+     * \brief Advances the grid by the given amount of generations
+     * \details The result is the same as calling next_generation() that many times.
+     *          PACKED_ENGINE steps several generations on a band of rows while
+     *          the band is still in the cache, before moving on to the next band.
+     * \param generations The generations to advance
+     */
+    void advance(int generations);
+
     /*!
      * \brief Sets the cell value accordingly
      * \param x The column to set. The 1st column is 0
      * \param y The row to set. The 1st row is 0
-     * \param state The wanted state of the cell
+     * \param state The wanted state of the cell. Must be one of the states of the rule.
      */
     void set_cell(const int x, const int y, const CELL state);
 
+    /*!
+     * \brief Sets a horizontal run of cells to the same state
+     * \details The parts of the run outside the grid are skipped. PACKED_ENGINE
+     *          sets the run a word at a time, which makes loading large patterns fast.
+     * \param x The first column of the run
+     * \param y The row of the run
+     * \param length The amount of cells in the run
+     * \param state The wanted state of the cells. Must be one of the states of the rule.
+     */
+    void set_cell_run(int x, int y, int length, const CELL state);
+
     /*!
      * \brief Fetch the state of a certain cell
      * \details Will wrap coordinates around as necessary to keep them in-bounds
@@ -66,6 +179,116 @@ class LifeGrid
      */
     void set_wrap_grid(bool wrap);
 
+    /*!
+     * \brief Grab grid wrap
+     * \return True if the grid wraps around itself
+     */
+    bool get_wrap_grid() const;
+
+    /*!
+     * \brief Grab the generation count
+     * \details Counts the generations stepped since the grid was last cleared or resized
+     * \return The current generation
+     */
+    uint64_t get_generation() const;
+
+    /*!
+     * \brief Set the generation count, when restoring a saved grid
+     * \param new_generation The generation of the grid
+     */
+    void set_generation(uint64_t new_generation);
+
+    /*!
+     * \brief Enables spotting still lifes and oscillators
+     * \details Keeps a hash of the grid, updated for the changed tiles only by
+     *          PACKED_ENGINE, and a history of the hashes of the last generations.
+     *          Once the grid repeats itself, advance() skips the whole cycles, which
+     *          means stepping every generation on its own instead of in blocks.
+     *          Any change to the cells from outside starts the history over.
+     * \param max_period The longest period looked for, or 0 to disable
+     */
+    void set_cycle_detection(int max_period);
+
+    /*!
+     * \brief Grab the period of the cycle the grid is in
+     * \details Based on the 64-bit hashes, so a false match is possible but very unlikely
+     * \return 1 for a still life (or an empty grid), 2 and up for an oscillator,
+     *          or 0 if no repetition has been seen
+     */
+    int get_cycle_period() const;
+
+    /*!
+     * \brief Grab the amount of live cells
+     * \details Kept up to date by the stepping and the editing, so asking costs nothing.
+     *          The dying states of the Generations rules aren't counted.
+     * \return The live cell count
+     */
+    uint64_t get_population() const;
+
+    /*!
+     * \brief Grab the amount of cells born during the last generation
+     * \return The births of the last generation, not counting the edits since
+     */
+    uint64_t get_births() const;
+
+    /*!
+     * \brief Grab the amount of live cells that died during the last generation
+     * \details A cell moving on to a dying state of the Generations rules counts as a death
+     * \return The deaths of the last generation, not counting the edits since
+     */
+    uint64_t get_deaths() const;
+
+    /*!
+     * \brief Grab the smallest rectangle holding every cell that isn't dead
+     * \details The dying states are included, as they are still drawn. Only the tiles
+     *          on the edges of the occupied ones are scanned.
+     * \param min_x Set to the leftmost column
+     * \param min_y Set to the topmost row
+     * \param max_x Set to the rightmost column
+     * \param max_y Set to the bottom row
+     * \return False if every cell is dead, leaving the parameters alone
+     */
+    bool get_bounding_box(int &min_x, int &min_y, int &max_x, int &max_y) const;
+
+    /*!
+     * \brief Copies a row out as bits, 64 cells a word
+     * \details Bit N of a word is the cell 64*word+N. The words past the
+     *          width are zero. Works with every engine, but PACKED_ENGINE
+     *          only needs to copy its words.
+     * \param y The row to copy
+     * \param plane The bit of the cell states to copy, below rule.get_state_bits()
+     * \param words Room for (width+63)/64 words
+     */
+    void get_row_bits(int y, int plane, uint64_t *words) const;
+
+    /*!
+     * \brief Copies a part of a row out as bits, like the whole row
+     * \param y The row to copy
+     * \param plane The bit of the cell states to copy, below rule.get_state_bits()
+     * \param first_word The first word of the row to copy
+     * \param last_word One past the last word to copy, at most (width+63)/64
+     * \param words Room for last_word-first_word words
+     */
+    void get_row_bits(int y, int plane, int first_word, int last_word, uint64_t *words) const;
+
+    /*!
+     * \brief Overwrites a bit of the cell states of a row
+     * \details The counterpart of get_row_bits(). The bits past the width are ignored.
+     * \param y The row to write
+     * \param plane The bit of the cell states to write, below rule.get_state_bits()
+     * \param words (width+63)/64 words
+     */
+    void set_row_bits(int y, int plane, const uint64_t *words);
+
+    /*!
+     * \brief Overwrites a bit of the cell states of every row
+     * \details Like set_row_bits() on every row in turn, but the statistics are counted
+     *          once at the end instead of for every row, which keeps restoring large grids fast.
+     * \param plane The bit of the cell states to write, below rule.get_state_bits()
+     * \param words (width+63)/64 words for every row, a row after another
+     */
+    void set_plane_bits(int plane, const uint64_t *words);
+
     /*!
      * \brief Grab grid width
      * \return Current grid width
@@ -78,15 +301,291 @@ class LifeGrid
      */
     int get_grid_height() const;
 
+    /*!
+     * \brief Change how the grid is stored and stepped
+     * \details The current grid contents are kept
+     * \param new_engine The wanted engine
+     */
+    void set_engine(GridEngine new_engine);
+
+    /*!
+     * \brief Grab the engine in use
+     * \return The current engine
+     */
+    GridEngine get_engine() const;
+
+    /*!
+     * \brief Choose the instruction set for stepping the packed rows
+     * \details Defaults to the widest one supported by the CPU
+     * \param kernel The wanted row kernel. Throws std::invalid_argument if the CPU can't run it
+     */
+    void set_row_kernel(RowKernel kernel);
+
+    /*!
+     * \brief Grab the row kernel in use
+     * \return The current row kernel
+     */
+    RowKernel get_row_kernel() const;
+
+    /*!
+     * \brief Change the rule the grid is stepped with
+     * \details Defaults to B3/S23. The rules in liferule.h have kernels of their own,
+     *          the others are a bit slower with PACKED_ENGINE. The Generations rules
+     *          are stepped with the CellKernel by LOOKUP_ENGINE. The cells in the states
+     *          the new rule doesn't have are killed.
+     * \param new_rule The wanted rule
+     */
+    void set_rule(const LifeRule &new_rule);
+
+    /*!
+     * \brief Change the rule the grid is stepped with
+     * \param rulestring The wanted rule, like "B36/S23". Throws std::invalid_argument if it can't be parsed.
+     */
+    void set_rule(const std::string &rulestring);
+
+    /*!
+     * \brief Grab the rule in use
+     * \return The current rule
+     */
+    LifeRule get_rule() const;
+
+    /*!
+     * \brief Set the amount of threads used for stepping the grid
+     * \details The grid is split into horizontal bands which are stepped in parallel
+     *          on a persistent worker pool. The results are identical to a single thread.
+     * \param thread_count The wanted thread count. 0 or less uses all hardware threads.
+     */
+    void set_thread_count(int thread_count);
+
+    /*!
+     * \brief Grab the thread count
+     * \return The amount of threads used for stepping the grid
+     */
+    int get_thread_count() const;
+
+    /*!
+     * \brief Grab the amount of changed tiles
+     * \details Only the tiles next to a changed tile are stepped by PACKED_ENGINE
+     * \return The amount of tiles changed during the last step or by set_cell() since
+     */
+    size_t get_changed_tile_count() const;
+
+    /*!
+     * \brief The amount of collectors collect_changed_tiles() keeps the changes for
+     */
+    static constexpr int change_collectors = 8;
+
+    /*!
+     * \brief Hands over the tiles changed since the last call by the same collector
+     * \details For keeping something made out of the cells up to date a tile at a time.
+     *          The tiles holding the dying states of the Generations rules are always
+     *          included, as those change on every step. The flags of a resized grid are
+     *          all set, and they come in a different amount.
+     *          Throws std::out_of_range if there's no such collector.
+     * \param changed Set to a flag for every tile, a tile row after another
+     * \param collector Which one collects, below change_collectors. Every collector gets every change.
+     */
+    void collect_changed_tiles(std::vector<unsigned char> &changed, int collector=0);
+
+    /*!
+     * \brief Grab the tile width
+     * \return The width of a tile in cells
+     */
+    int get_tile_width() const;
+
+    /*!
+     * \brief Grab the tile height
+     * \return The height of a tile in cells
+     */
+    int get_tile_height() const;
+
   protected:
+    /*!
+     * \brief Starts the grid over from generation 0, with nothing counted
+     * \param kill_cells Kill all cells, or leave the packed grid with whatever was in its memory
+     */
+    void reset_grid(bool kill_cells);
+
     /*!
      * \brief Calculates the real index for the given coordinate
+     * \details Takes the ghost border of cells into account
      * \param x The column. The 1st column is 0
      * \param y The row. The 1st column is 0
      * \return `size_t` The real cell index
      */
     size_t coord_to_index(int x, int y) const;
 
+    /*!
+     * \brief Calculates the index of the packed word holding the given coordinate
+     * \details Takes the ghost words around packed_cells into account
+     * \param x The column. The 1st column is 0
+     * \param y The row. The 1st row is 0
+     * \return `size_t` The real word index
+     */
+    size_t coord_to_word_index(int x, int y) const;
+
+    /*!
+     * \brief Clamps the coordinate into the grid the same way as coord_to_index()
+     * \param x The column. The 1st column is 0
+     * \param y The row. The 1st row is 0
+     */
+    void clamp_coord(int &x, int &y) const;
+
+    /*!
+     * \brief Fills the ghost border with the cells from the opposite edge, or with dead cells
+     * \details Done once per generation, so that the stepping doesn't have to care about the edges
+     */
+    void refresh_kernel_halo();
+
+    /*!
+     * \brief Kills the packed cells at or above a state, in every plane
+     * \param states The states kept, the ones below this
+     */
+    void drop_packed_states(int states);
+
+    /*!
+     * \brief Fills the ghost cells of packed_cells with the cells from the opposite edge, or with zeroes
+     */
+    void refresh_packed_halo();
+
+    /*!
+     * \brief The size of a single state plane of packed_cells, in words
+     */
+    size_t packed_plane_size() const;
+
+    /*!
+     * \brief The bits of a packed word that are within the grid
+     * \param word The word of the row
+     * \return All ones, except for the padding of the last word
+     */
+    uint64_t packed_word_mask(int word) const;
+
+    /*!
+     * \brief Grabs 64 cells of a row as bits, set for the live cells
+     * \param y The row
+     * \param word The 64 columns, like in packed_cells
+     * \return The bits, none of them past the width
+     */
+    uint64_t alive_bits(int y, int word) const;
+
+    /*!
+     * \brief Grabs 64 cells of a row as bits, set for the cells that aren't dead
+     * \param y The row
+     * \param word The 64 columns, like in packed_cells
+     * \return The bits, none of them past the width
+     */
+    uint64_t occupied_bits(int y, int word) const;
+
+    /*!
+     * \brief Sets the state of a cell in packed_cells, leaving the tiles alone
+     * \param x The column, must be inside the grid
+     * \param y The row, must be inside the grid
+     * \param state The wanted state of the cell
+     */
+    void set_packed_cell(int x, int y, CELL state);
+
+    /*!
+     * \brief Fetch the state of a cell from packed_cells
+     * \param x The column, must be inside the grid
+     * \param y The row, must be inside the grid
+     * \return The cell state
+     */
+    CELL get_packed_cell(int x, int y) const;
+
+    /*!
+     * \brief Steps the multi-state packed grid of a Generations rule
+     */
+    void next_generation_packed_planes();
+
+    /*!
+     * \brief Fills the ghost cells on both sides of a packed row
+     * \param row The first data word of the row
+     */
+    void refresh_packed_row_ghosts(uint64_t *row) const;
+
+    /*!
+     * \brief Advances the packed grid a band of rows at a time
+     * \details Leaves the active tiles out, and marks them all as changed afterwards
+     * \param generations The generations to advance, temporal_depth at most
+     */
+    void advance_packed_blocked(int generations);
+
+    /*!
+     * \brief Advances the rows [first_y, last_y) into packed_next_generation
+     * \details The band is copied into a scratch buffer with an extra row on both sides
+     *           for every generation. Each generation shrinks the valid part by one row
+     *           on both sides, until only the wanted rows are left.
+     */
+    void step_packed_block(int first_y, int last_y, int generations);
+
+    /*!
+     * \brief Steps the grid using the CellKernel
+     */
+    void next_generation_kernel();
+
+    /*!
+     * \brief Steps the grid using the packed rows
+     */
+    void next_generation_packed();
+
+    /*!
+     * \brief Steps the rows [first_y, last_y) into cells_next_generation using the CellKernel
+     */
+    void step_kernel_rows(int first_y, int last_y);
+
+    /*!
+     * \brief Steps the grid using the lookup tables
+     */
+    void next_generation_lookup();
+
+    /*!
+     * \brief Steps the rows [first_y, last_y) into cells_next_generation using the lookup tables
+     * \details The rows are stepped in pairs, so first_y should be even
+     */
+    void step_lookup_rows(int first_y, int last_y);
+
+    /*!
+     * \brief Steps the tile rows [first_tile_y, last_tile_y) into packed_next_generation
+     * \details Skips the tiles which can't change
+     */
+    void step_packed_tiles(int first_tile_y, int last_tile_y);
+
+    /*!
+     * \brief Checks if the tile or any of its neighbours changed during the last step
+     * \return True if the tile has to be stepped
+     */
+    bool tile_needs_step(int tile_x, int tile_y) const;
+
+    /*!
+     * \brief Lays out the tiles for the current grid size and marks them all as changed
+     */
+    void mark_all_tiles_changed();
+
+    /*!
+     * \brief Splits the work into bands and runs them, in parallel if there are threads for it
+     * \param count The amount of rows, or tile rows, to split
+     * \param min_band_size Bands smaller than this aren't split any further
+     * \param step_band Called with the first and one past the last row of a band
+     */
+    void run_in_bands(int count, int min_band_size, const std::function<void(int, int)> &step_band);
+
+    /*!
+     * \brief Bands shorter than this aren't worth handing to another thread
+     */
+    static constexpr int min_band_height = 8;
+
+    /*!
+     * \brief The most generations advance() steps a band of rows before writing it back
+     * \details Every generation adds two rows to be stepped twice, so deeper isn't always better
+     */
+    static constexpr int temporal_depth = 8;
+
+    /*!
+     * \brief The size of the band buffers advance() aims at, both of them together
+     * \details Should stay in the L2 cache
+     */
+    static constexpr size_t temporal_block_bytes = 256 * 1024;
+
     /*!
      * \brief The width of the grid
      */
@@ -99,24 +598,358 @@ class LifeGrid
 
     /*!
      * \brief The current grid state
+     * \details Surrounded by a border of ghost cells, one cell wide. The ghost cells
+     *          mirror the opposite edge when the grid wraps, otherwise they are dead.
      */
     std::vector<CELL> cells;
 
+    /*!
+     * \brief The current grid state when using PACKED_ENGINE
+     * \details packed_row_stride words for each row, bit N of a word being the column 64*word+N.
+     *          Every row has a ghost word on both sides, and there's a ghost row above and below
+     *          the grid. The ghost cells are bit 63 of the word before a row, and the bit right
+     *          past the grid width. The rest of the bits past the grid width are zero.
+     *
+     *          The Generations rules have more states than fit into a bit. Those are stored
+     *          in rule.get_state_bits() planes laid out like the above, one after another.
+     *          Bit N of a state is in the plane N.
+     */
+    std::vector<uint64_t, GridAllocator<uint64_t>> packed_cells;
+
+    /*!
+     * \brief The amount of words in a single packed row
+     */
+    int words_per_row;
+
+    /*!
+     * \brief The amount of words between two packed rows, the ghost words included
+     */
+    int packed_row_stride;
+
+    /*!
+     * \brief The engine in use
+     */
+    GridEngine engine;
+
+    /*!
+     * \brief The instruction set PACKED_ENGINE steps the rows with
+     */
+    RowKernel row_kernel;
+
+    /*!
+     * \brief The rule the grid is stepped with
+     */
+    LifeRule rule;
+
+    /*!
+     * \brief The width of a tile in words
+     * \details PACKED_ENGINE splits the grid into tiles, and steps only the tiles
+     *          which are next to a tile that changed during the last step.
+     */
+    static constexpr int tile_words = 4;
+
+    /*!
+     * \brief The height of a tile in rows
+     */
+    static constexpr int tile_rows = 32;
+
+    /*!
+     * \brief The amount of tile columns
+     */
+    int tiles_x;
+
+    /*!
+     * \brief The amount of tile rows
+     */
+    int tiles_y;
+
+    /*!
+     * \brief For every tile: did it change during the last step, or by set_cell()?
+     */
+    std::vector<unsigned char> tile_changed;
+
   private:
     /*!
-     * \brief The next state of the grid.
+     * \brief The next state of the grid. Swapped with cells after a step.
      * \details Kept here to prevent unnecessary memory allocation and deallocation.
      */
     std::vector<CELL> cells_next_generation;
 
     /*!
-     * \brief Modify the cell in next generation
-     * \details Should only be called by next_generation().
-     * \param x The column. The 1st column is 0.
-     * \param y The row. The 1st row is 0.
-     * \param state The wanted state of the cell.
+     * \brief The next state of the packed grid. Swapped with packed_cells after a step.
+     */
+    std::vector<uint64_t, GridAllocator<uint64_t>> packed_next_generation;
+
+    /*!
+     * \brief The lookup tables of LOOKUP_ENGINE for the current rule
+     * \details Empty with B3/S23, which has tables built at compile time.
+     *          Built on the first step after changing the rule.
+     */
+    std::vector<CELL> rule_cell_table;
+
+    /*!
+     * \brief See rule_cell_table
+     */
+    std::vector<unsigned char> rule_block_table;
+
+    /*!
+     * \brief The tile changes of the step in progress. Swapped with tile_changed after a step.
+     */
+    std::vector<unsigned char> tile_changed_next;
+
+    /*!
+     * \brief The threads stepping the grid. Null when stepping on a single thread.
+     */
+    std::unique_ptr<WorkerPool> worker_pool;
+
+    /*!
+     * \brief The generations stepped since the grid was cleared
+     */
+    uint64_t generation;
+
+    /*!
+     * \brief Adds or takes off the cells of a part of a row from the statistics
+     * \details Called with -1 before the cells are changed from outside, and with 1 after
+     * \param y The row
+     * \param first_x The first column
+     * \param last_x One past the last column
+     * \param sign 1 to add the cells, -1 to take them off
+     */
+    void count_row_population(int y, int first_x, int last_x, int sign);
+
+    /*!
+     * \brief Overwrites a bit of the cell states of a row, leaving the statistics alone
+     * \param y The row to write
+     * \param plane The bit of the cell states to write
+     * \param words (width+63)/64 words
+     */
+    void write_row_bits(int y, int plane, const uint64_t *words);
+
+    /*!
+     * \brief Counts the population of a packed tile, and its births and deaths
+     * \param current The packed planes of the new generation
+     * \param previous The packed planes of the generation before, or null to skip the births and deaths
+     * \param tile_x The tile column
+     * \param tile_y The tile row
+     */
+    void tally_tile(const uint64_t *current, const uint64_t *previous, int tile_x, int tile_y);
+
+    /*!
+     * \brief Counts the population of a tile of the byte engines, and its births and deaths
+     * \param current The cells of the new generation
+     * \param previous The cells of the generation before, or null to skip the births and deaths
+     * \param tile_x The tile column
+     * \param tile_y The tile row
+     */
+    void tally_tile(const CELL *current, const CELL *previous, int tile_x, int tile_y);
+
+    /*!
+     * \brief Checks if a tile counted by tally_tile() changed during the step
+     * \details Called before tile_occupied is updated for the step
+     * \param tile The index of the tile
+     * \param born The cells born on the tile
+     * \param died The cells died on the tile
+     * \param occupied Does the tile have cells that aren't dead after the step?
+     * \return True if the tile changed
+     */
+    bool tallied_tile_changed(size_t tile, uint64_t born, uint64_t died, bool occupied) const;
+
+    /*!
+     * \brief Counts every tile on the rows, and sums up the statistics
+     * \details The cells on the other rows must have been dead before and after the step
+     * \param first_y The first row
+     * \param last_y One past the last row
+     * \param count_changes If true, the births and deaths are counted against the buffer
+     *        holding the previous generation
+     */
+    void tally_tiles(int first_y, int last_y, bool count_changes);
+
+    /*!
+     * \brief Steps the rows of the byte engines a tile row at a time, counting the tiles as it goes
+     * \details The statistics are summed up after the buffers are swapped
+     * \param first_y The first row to step
+     * \param last_y One past the last row to step
+     * \param step_rows Steps the rows from the first to one past the last, into cells_next_generation
+     */
+    void step_and_tally_rows(int first_y, int last_y, const std::function<void(int, int)> &step_rows);
+
+    /*!
+     * \brief Counts tile_population and tile_occupied again, if they're stale
+     * \details Called by everything that reads them outside of the stepping
+     */
+    void refresh_tile_counts() const;
+
+    /*!
+     * \brief Sums the tile statistics up for the whole grid
+     * \param count_changes Sum up the births and deaths as well
+     */
+    void sum_tile_statistics(bool count_changes);
+
+    /*!
+     * \brief Finds the cells that aren't dead within a tile
+     * \param tile_x The tile column
+     * \param tile_y The tile row
+     * \param min_x Lowered to the leftmost column found
+     * \param min_y Lowered to the topmost row found
+     * \param max_x Raised to the rightmost column found
+     * \param max_y Raised to the bottom row found
+     * \return False if the tile is empty after all
+     */
+    bool add_tile_bounds(int tile_x, int tile_y, int &min_x, int &min_y, int &max_x, int &max_y) const;
+
+    /*!
+     * \brief Narrows down the rows the byte engines need to step
+     * \details Without wrapping, nothing happens further than a row away from the occupied tiles.
+     *          The rows left out are cleared from the next buffer, as far as they may hold anything.
+     * \param first_y Set to the first row to step
+     * \param last_y Set to one past the last row to step
+     */
+    void clip_stepped_rows(int &first_y, int &last_y);
+
+    /*!
+     * \brief The live cells of every tile
+     * \details Stale while tile_counts_stale is set, see refresh_tile_counts()
+     */
+    mutable std::vector<uint32_t> tile_population;
+
+    /*!
+     * \brief For every tile: may it have cells that aren't dead?
+     * \details Exact for the two state rules. With the dying states it's only cleared by the stepping.
+     *          Stale while tile_counts_stale is set, like tile_population.
+     */
+    mutable std::vector<unsigned char> tile_occupied;
+
+    /*!
+     * \brief The births of the last generation, for every tile row
+     */
+    std::vector<uint64_t> tile_row_births;
+
+    /*!
+     * \brief The deaths of the last generation, for every tile row
+     */
+    std::vector<uint64_t> tile_row_deaths;
+
+    /*!
+     * \brief For every tile: did it change since the last collect_changed_tiles()?
+     * \details A bit for each collector
+     */
+    std::vector<unsigned char> tile_uncollected_changes;
+
+    /*!
+     * \brief The live cell count
+     */
+    uint64_t population;
+
+    /*!
+     * \brief The births of the last generation
+     */
+    uint64_t births;
+
+    /*!
+     * \brief The deaths of the last generation
+     */
+    uint64_t deaths;
+
+    /*!
+     * \brief Should the next packed step count every tile, instead of just the changed ones?
+     * \details Set when advance() has stepped in blocks, without following the tiles
+     */
+    bool tile_statistics_stale;
+
+    /*!
+     * \brief Do tile_population and tile_occupied lag behind the cells?
+     * \details The two state packed steps only keep the population, births and deaths
+     *          up to date, from the changes tallied by the row kernel.
+     */
+    mutable bool tile_counts_stale;
+
+    /*!
+     * \brief The first row of cells_next_generation that may hold cells that aren't dead
+     */
+    int dirty_first_row;
+
+    /*!
+     * \brief One past the last row of cells_next_generation that may hold cells that aren't dead
+     */
+    int dirty_last_row;
+
+    /*!
+     * \brief Forgets the hash history, after the cells were changed from outside
+     */
+    void reset_cycle_detection();
+
+    /*!
+     * \brief Hashes every tile, for when they can't be followed one by one
+     */
+    void recompute_tile_hashes();
+
+    /*!
+     * \brief Hashes a tile of a buffer laid out like packed_cells
+     * \param buffer The packed planes
+     * \param tile_x The tile column
+     * \param tile_y The tile row
+     * \return The hash, depending on the position of the tile as well
+     */
+    uint64_t hash_packed_tile(const uint64_t *buffer, int tile_x, int tile_y) const;
+
+    /*!
+     * \brief Adds the hash of the new generation to the history and looks for a repetition
+     * \return The hash of the new generation
+     */
+    uint64_t update_cycle_detection();
+
+    /*!
+     * \brief Adds the hash of a generation reached by advance_packed_blocked() to the block history
+     * \details The generations in between weren't hashed, so the history of single generations
+     *          starts over. A repetition between the blocks only tells that the grid cycles, so the
+     *          following generations are stepped one at a time, until the period is found.
+     */
+    void update_block_cycle_detection();
+
+    /*!
+     * \brief The longest period looked for, 0 when the detection is off
+     */
+    int cycle_max_period;
+
+    /*!
+     * \brief The period found, or 0
+     */
+    int cycle_period;
+
+    /*!
+     * \brief The hash of every tile. The grid's hash is their sum.
+     */
+    std::vector<uint64_t> tile_hashes;
+
+    /*!
+     * \brief Are tile_hashes up to date with the cells?
+     */
+    bool hashes_valid;
+
+    /*!
+     * \brief The hashes of the last generations, as a ring
+     */
+    std::vector<uint64_t> hash_history;
+
+    /*!
+     * \brief The amount of hashes in the history
+     */
+    size_t hash_history_count;
+
+    /*!
+     * \brief The hashes of the last generations reached by advance() a block at a time, as a ring
+     */
+    std::vector<uint64_t> block_hash_history;
+
+    /*!
+     * \brief The amount of hashes in the block history
+     */
+    size_t block_hash_count;
+
+    /*!
+     * \brief The generations advance() still steps one at a time, after a repetition between the blocks
      */
-    void set_next_generation_cell(const int x, const int y, const CELL state);
+    int cycle_check_steps;
 
     /*!
      * \brief Should the grid wrap around itself?
@@ -3,14 +3,33 @@
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsSceneWheelEvent>
+#include <QVector>
 
+#include <algorithm>
+#include <cmath>
 #include <type_traits>
 #include <numeric>
 #include <thread>
 #include <chrono>
+#include <utility>
 
 
 
+// The zoom range, in pixels per cell
+static const float min_zoom = 1.f / 64.f;
+static const float max_zoom = 100.f;
+
+// The grid lines would hide the cells narrower than this
+static const float min_grid_line_zoom = 4.f;
+
+// How often the view looks for a new frame while running
+static const int repaint_interval_ms = 1000 / 60;
+
+// The uncapped generations are stepped in batches of a few milliseconds, so the queued changes don't wait long
+static const auto min_batch_duration = std::chrono::milliseconds(2);
+static const auto max_batch_duration = std::chrono::milliseconds(8);
+static const int max_batch_generations = 4096;
+
 // Helper for the float to int casting
 template <
     typename T,
@@ -24,7 +43,7 @@ int to_int(T f)
 LifeGridScene::LifeGridScene(QObject *_parent) :
     LifeGrid{14},
     QGraphicsScene(_parent),
-    zoom{20},
+    zoom{20.f},
     offset_x{0.f},
     offset_y{0.f},
     paint_mode{MAKE_ALIVE},
@@ -32,18 +51,37 @@ LifeGridScene::LifeGridScene(QObject *_parent) :
     is_dragging_view{false},
     speed{1},
     is_running{false},
-    is_painting_enabled{true}
+    is_painting_enabled{true},
+    grid_line_tile_zoom{0.f},
+    published_frame_count{0},
+    published_generation{0},
+    displayed_frame_sequence{0},
+    queued_changes{nullptr},
+    last_painted_cell{-1, -1}
 {
+    set_cycle_detection(64);
+    show_grid_changes();
+
+    // The view follows the running simulation at the display rate, however fast it steps
+    repaint_timer.setInterval(repaint_interval_ms);
+    QObject::connect(&repaint_timer, &QTimer::timeout, this, [this]()
+    {
+        this->show_latest_frame();
+    });
 }
 
 LifeGridScene::~LifeGridScene()
 {
+    stop_and_wait_for_thread();
+    delete queued_changes.exchange(nullptr);
 }
 
 QPoint LifeGridScene::scene_pos_to_grid_pos(const QPointF &scene_pos) const
 {
-    const float grid_total_width  = this->grid_width  * this->zoom;
-    const float grid_total_height = this->grid_height * this->zoom;
+    // The displayed grid, which the user sees and points at
+    const GridFrame &frame = get_displayed_frame();
+    const float grid_total_width  = frame.get_grid_width()  * this->zoom;
+    const float grid_total_height = frame.get_grid_height() * this->zoom;
 
     const float min_x = 0.f - grid_total_width  / 2.f + offset_x;
     const float min_y = 0.f - grid_total_height / 2.f + offset_y;
@@ -51,15 +89,16 @@ QPoint LifeGridScene::scene_pos_to_grid_pos(const QPointF &scene_pos) const
     const float max_x = grid_total_width  / 2.f + offset_x;
     const float max_y = grid_total_height / 2.f + offset_y;
 
-    const float cell_width  = (max_x - min_x) / grid_width;
-    const float cell_height = (max_y - min_y) / grid_height;
+    const float cell_width  = (max_x - min_x) / frame.get_grid_width();
+    const float cell_height = (max_y - min_y) / frame.get_grid_height();
 
     const float scene_x = static_cast<float>(scene_pos.x());
     const float scene_y = static_cast<float>(scene_pos.y());
 
-    // The -2.f adjustments are to fix the slight alignment error caused by cell borders and float to int conversion
-    float grid_x = (scene_x - min_x - 2.f) / cell_width;
-    float grid_y = (scene_y - min_y - 2.f) / cell_height;
+    // The border adjustments are to fix the slight alignment error caused by cell borders and float to int conversion
+    const float border = zoom >= min_grid_line_zoom ? 2.f : 0.f;
+    float grid_x = (scene_x - min_x - border) / cell_width;
+    float grid_y = (scene_y - min_y - border) / cell_height;
 
     if (grid_x < 0.f)
     {
@@ -81,20 +120,300 @@ void LifeGridScene::run(bool run)
     {
         update_thread = std::thread([&]()
         {
+            // Running on from a known cycle is allowed, it's only reported once
+            const bool was_cycling = this->get_cycle_period() > 0;
+            bool cycle_found = false;
+            int batch_generations = 1;
+
             while(this->is_running)
             {
-                this->next_generation();
-                this->update();
+                this->apply_queued_changes();
+
+                // Uncapped, the batches grow or shrink to take a few milliseconds each
+                const int updates_per_second = this->speed;
+                if(updates_per_second == 0)
+                {
+                    const auto batch_start = std::chrono::steady_clock::now();
+                    this->step_generations(batch_generations);
+                    const auto batch_duration = std::chrono::steady_clock::now() - batch_start;
+                    if(batch_duration < min_batch_duration && batch_generations < max_batch_generations)
+                    {
+                        batch_generations *= 2;
+                    }
+                    else if(batch_duration > max_batch_duration && batch_generations > 1)
+                    {
+                        batch_generations /= 2;
+                    }
+                }
+                else
+                {
+                    this->step_generation();
+                }
+
+                // Only a frame the view has caught up with is replaced, the generations in between are never drawn
+                this->publish_frame(false);
+
+                if(!was_cycling && this->get_cycle_period() > 0 && this->cycle_found_callback)
+                {
+                    this->is_running = false;
+                    cycle_found = true;
+                    break;
+                }
+
+                if(updates_per_second > 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1000 / updates_per_second));
+                }
+            }
+
+            // The view may have been behind, the last generation is shown anyway
+            this->publish_frame(true);
 
-                const auto delay = std::chrono::milliseconds(1000 / this->speed);
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            if(cycle_found)
+            {
+                this->cycle_found_callback(this->get_cycle_period());
             }
         });
+        repaint_timer.start();
     }
-    else
+    else if(update_thread.joinable())
     {
         update_thread.join();
+        repaint_timer.stop();
+
+        // The grid is back in the GUI thread, with the changes queued after the last generation
+        apply_queued_changes();
+        show_grid_changes();
+    }
+}
+
+void LifeGridScene::change_grid(std::function<void()> change)
+{
+    if(!update_thread.joinable())
+    {
+        // Shown right away, even if the change fails half way
+        try
+        {
+            change();
+        }
+        catch(...)
+        {
+            show_grid_changes();
+            throw;
+        }
+        show_grid_changes();
+        return;
+    }
+
+    // Takes the queue back, unless the update thread got to it first, and puts it back with the change
+    std::vector<std::function<void()>> *changes = queued_changes.exchange(nullptr);
+    if(!changes)
+    {
+        changes = new std::vector<std::function<void()>>;
+    }
+    changes->push_back(std::move(change));
+    queued_changes.store(changes);
+}
+
+void LifeGridScene::apply_queued_changes()
+{
+    std::unique_ptr<std::vector<std::function<void()>>> changes(queued_changes.exchange(nullptr));
+    if(!changes)
+    {
+        return;
+    }
+    for(const auto &change : *changes)
+    {
+        change();
+    }
+}
+
+bool LifeGridScene::publish_frame(bool force)
+{
+    // The reader hasn't taken the last frame yet, the changes pile up in the grid meanwhile
+    if(!force && !frame_exchange.is_published_frame_taken())
+    {
+        return false;
+    }
+
+    // Nothing to show that the last frame didn't
+    collect_changed_tiles(collected_tiles);
+    const bool has_changes = std::find(collected_tiles.begin(), collected_tiles.end(), 1) != collected_tiles.end();
+    if(!has_changes && published_frame_count > 0 && published_generation == get_generation())
+    {
+        return false;
+    }
+
+    published_frame_count++;
+    published_generation = get_generation();
+    frame_exchange.get_back_frame().capture(*this, collected_tiles, published_frame_count);
+    frame_exchange.publish();
+    return true;
+}
+
+bool LifeGridScene::take_published_frame()
+{
+    if(!frame_exchange.acquire())
+    {
+        return false;
+    }
+
+    // A frame replaced before it was taken had changes of its own, so those are unknown
+    const GridFrame &frame = frame_exchange.get_front_frame();
+    const std::vector<unsigned char> &changed_tiles = frame.get_changed_tiles();
+    if(frame.get_sequence() != displayed_frame_sequence + 1 || pyramid_changed_tiles.size() != changed_tiles.size())
+    {
+        pyramid_changed_tiles.assign(changed_tiles.size(), 1);
+    }
+    else
+    {
+        for(size_t tile = 0; tile < changed_tiles.size(); tile++)
+        {
+            pyramid_changed_tiles[tile] |= changed_tiles[tile];
+        }
+    }
+    displayed_frame_sequence = frame.get_sequence();
+    return true;
+}
+
+void LifeGridScene::show_latest_frame()
+{
+    const GridFrame &frame = get_displayed_frame();
+    const uint64_t previous_sequence = frame.get_sequence();
+    const int previous_width = frame.get_grid_width();
+    const int previous_height = frame.get_grid_height();
+    if(!take_published_frame())
+    {
+        return;
+    }
+
+    // A replaced frame had changes of its own, and a resized grid moves everything
+    const GridFrame &latest = get_displayed_frame();
+    if(latest.get_sequence() != previous_sequence + 1 || latest.get_grid_width() != previous_width || latest.get_grid_height() != previous_height)
+    {
+        this->update();
+        return;
+    }
+
+    // The neighbouring changed tiles on a tile row are repainted as one rectangle
+    const int tile_width = latest.get_tile_width();
+    const int tile_height = latest.get_tile_height();
+    const int tiles_x = (latest.get_grid_width() + tile_width - 1) / tile_width;
+    const int tiles_y = (latest.get_grid_height() + tile_height - 1) / tile_height;
+    const std::vector<unsigned char> &changed_tiles = latest.get_changed_tiles();
+    for(int tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        for(int tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+            if(!changed_tiles[static_cast<size_t>(tile_y * tiles_x + tile_x)])
+            {
+                continue;
+            }
+
+            const int first_tile_x = tile_x;
+            while(tile_x + 1 < tiles_x && changed_tiles[static_cast<size_t>(tile_y * tiles_x + tile_x + 1)])
+            {
+                tile_x++;
+            }
+            this->update(cells_to_scene_rect(
+                first_tile_x * tile_width,
+                tile_y * tile_height,
+                std::min(latest.get_grid_width(), (tile_x + 1) * tile_width),
+                std::min(latest.get_grid_height(), (tile_y + 1) * tile_height)
+            ));
+        }
+    }
+}
+
+void LifeGridScene::show_grid_changes()
+{
+    publish_frame(true);
+    show_latest_frame();
+}
+
+QRectF LifeGridScene::cells_to_scene_rect(int first_x, int first_y, int last_x, int last_y) const
+{
+    const GridFrame &frame = get_displayed_frame();
+    const float min_x = 0.f - frame.get_grid_width()  * zoom / 2.f + offset_x;
+    const float min_y = 0.f - frame.get_grid_height() * zoom / 2.f + offset_y;
+
+    // A pixel more on every side for the grid lines around the cells
+    return QRectF(
+        min_x + zoom * first_x,
+        min_y + zoom * first_y,
+        static_cast<qreal>(zoom) * (last_x - first_x),
+        static_cast<qreal>(zoom) * (last_y - first_y)
+    ).adjusted(-1, -1, 1, 1);
+}
+
+const GridFrame &LifeGridScene::get_displayed_frame() const
+{
+    return frame_exchange.get_front_frame();
+}
+
+void LifeGridScene::set_cycle_found_callback(std::function<void(int)> callback)
+{
+    cycle_found_callback = std::move(callback);
+}
+
+void LifeGridScene::step_generation()
+{
+    next_generation();
+
+    std::lock_guard<std::mutex> lock(recorder_mutex);
+    if(recorder)
+    {
+        try
+        {
+            recorder->record(*this);
+        }
+        catch(const std::exception &)
+        {
+            // The grid was resized or the disk is full, either way the recording is over
+            recorder.reset();
+        }
+    }
+}
+
+void LifeGridScene::step_generations(int generations)
+{
+    bool is_recording = false;
+    {
+        std::lock_guard<std::mutex> lock(recorder_mutex);
+        is_recording = recorder != nullptr;
     }
+
+    // The recording needs every generation, advance() may step them in blocks
+    if(is_recording)
+    {
+        for(int generation = 0; generation < generations; generation++)
+        {
+            step_generation();
+        }
+        return;
+    }
+    LifeGrid::advance(generations);
+}
+
+void LifeGridScene::start_recording(const std::string &path)
+{
+    auto new_recorder = std::make_unique<Recorder>(path, *this);
+    new_recorder->record(*this);
+
+    std::lock_guard<std::mutex> lock(recorder_mutex);
+    recorder = std::move(new_recorder);
+}
+
+void LifeGridScene::stop_recording()
+{
+    std::unique_ptr<Recorder> finished;
+    {
+        std::lock_guard<std::mutex> lock(recorder_mutex);
+        finished = std::move(recorder);
+    }
+
+    // The destructor writes the rest of the frames, outside the lock
+    finished.reset();
 }
 
 void LifeGridScene::stop_and_wait_for_thread()
@@ -103,6 +422,7 @@ void LifeGridScene::stop_and_wait_for_thread()
     {
         is_running = false;
         update_thread.join();
+        repaint_timer.stop();
     }
 }
 
@@ -118,6 +438,17 @@ void LifeGridScene::toggle_painting_enabled(bool enabled)
 
 void LifeGridScene::drawForeground(QPainter *painter, const QRectF &rect)
 {
+    /*
+     * The frames are taken only along with repainting what they changed.
+     * Taking one here would leave the parts of the view outside of rect out of date.
+     * The changes pile up while zoomed in.
+     */
+    if(zoom < 1.f)
+    {
+        density_pyramid.update(get_displayed_frame(), pyramid_changed_tiles);
+        std::fill(pyramid_changed_tiles.begin(), pyramid_changed_tiles.end(), 0);
+    }
+
     draw_grid(painter, rect);
 }
 
@@ -126,25 +457,25 @@ void LifeGridScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     if(is_painting_cells)
     {
         const auto pos = scene_pos_to_grid_pos(event->scenePos());
+        const GridFrame &frame = get_displayed_frame();
 
         // Check if the mouse is hovering over the grid
-        const bool is_valid = pos.x() >= 0 && pos.x() < grid_width &&
-                              pos.y() >= 0 && pos.y() < grid_height;
+        const bool is_valid = pos.x() >= 0 && pos.x() < frame.get_grid_width() &&
+                              pos.y() >= 0 && pos.y() < frame.get_grid_height();
         if(!is_valid)
         {
             return;
         }
 
-        // Check if the cell needs to be updated
-        const auto cell = get_cell(pos.x(), pos.y());
+        // Check if the cell needs to be updated. The frame doesn't show the queued changes yet.
+        const auto cell = frame.get_cell(pos.x(), pos.y());
         const auto target_state = paint_mode == MAKE_ALIVE ? ALIVE : DEAD;
-        if(cell == target_state)
+        if(cell == target_state || pos == last_painted_cell)
         {
             return;
         }
 
-        set_cell(pos.x(), pos.y(), target_state);
-        this->update();
+        paint_cell(pos, target_state);
     }
 
     if(is_dragging_view)
@@ -162,10 +493,11 @@ void LifeGridScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
     if(event->button() == Qt::LeftButton)
     {
         const auto pos = scene_pos_to_grid_pos(event->scenePos());
+        const GridFrame &frame = get_displayed_frame();
 
         // Ignore if the mouse is outside of the grid, or if painting is disabled
-        const bool is_valid = pos.x() >= 0 && pos.x() < grid_width &&
-                              pos.y() >= 0 && pos.y() < grid_height;
+        const bool is_valid = pos.x() >= 0 && pos.x() < frame.get_grid_width() &&
+                              pos.y() >= 0 && pos.y() < frame.get_grid_height();
         if(!is_valid || !is_painting_enabled)
         {
             return;
@@ -175,12 +507,10 @@ void LifeGridScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
         // Save paint_mode reverse to the cell's current state
         // and update the cell
-        const auto cell = get_cell(pos.x(), pos.y());
+        const auto cell = frame.get_cell(pos.x(), pos.y());
         const auto target_state = cell == ALIVE ? DEAD : ALIVE;
         paint_mode = target_state == ALIVE ? MAKE_ALIVE : MAKE_DEAD;
-        set_cell(pos.x(), pos.y(), target_state);
-
-        this->update();
+        paint_cell(pos, target_state);
     }
     else if(event->button() == Qt::MouseButton::RightButton)
     {
@@ -188,11 +518,36 @@ void LifeGridScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
+void LifeGridScene::paint_cell(const QPoint &pos, CELL state)
+{
+    const int x = pos.x();
+    const int y = pos.y();
+    last_painted_cell = pos;
+
+    // The running simulation shows the cell with the next generation, repainting its tile
+    if(update_thread.joinable())
+    {
+        change_grid([this, x, y, state]()
+        {
+            this->set_cell(x, y, state);
+        });
+        return;
+    }
+
+    // Otherwise the frame is taken right away, and only the cell is repainted
+    show_latest_frame();
+    set_cell(x, y, state);
+    publish_frame(true);
+    take_published_frame();
+    this->update(cells_to_scene_rect(x, y, x + 1, y + 1));
+}
+
 void LifeGridScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
     if(event->button() == Qt::MouseButton::LeftButton)
     {
         is_painting_cells = false;
+        last_painted_cell = QPoint(-1, -1);
     }
     else if(event->button() == Qt::MouseButton::RightButton)
     {
@@ -203,22 +558,35 @@ void LifeGridScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 void LifeGridScene::wheelEvent(QGraphicsSceneWheelEvent *event)
 {
     const auto old_zoom = zoom;
-    zoom += event->delta() / 20.f;
 
-    if(zoom < 2)
+    // Whole pixels per cell when zoomed in, and a level of the density pyramid per step below that
+    if(event->delta() < 0 && zoom <= 1.f)
     {
-        zoom = 2;
+        zoom /= 2.f;
     }
-    else if(zoom > 100)
+    else if(event->delta() > 0 && zoom < 1.f)
     {
-        zoom = 100;
+        zoom *= 2.f;
+    }
+    else
+    {
+        zoom = std::max(1.f, std::round(zoom + event->delta() / 20.f));
+    }
+
+    if(zoom < min_zoom)
+    {
+        zoom = min_zoom;
+    }
+    else if(zoom > max_zoom)
+    {
+        zoom = max_zoom;
     }
 
     // If the zoom was changed, scale the view offsets accordingly.
     // This will keep the grid "still" when zooming in and out.
     if(zoom != old_zoom)
     {
-        const auto zoom_ratio = static_cast<float>(zoom) / (old_zoom);
+        const auto zoom_ratio = zoom / old_zoom;
         offset_x *= zoom_ratio;
         offset_y *= zoom_ratio;
     }
@@ -230,122 +598,211 @@ void LifeGridScene::wheelEvent(QGraphicsSceneWheelEvent *event)
 
 void LifeGridScene::draw_grid(QPainter *painter, const QRectF &rect) const
 {
-    painter->setPen(QPen(Qt::black));
-
-    const float grid_total_width  = this->grid_width  * this->zoom;
-    const float grid_total_height = this->grid_height * this->zoom;
+    const GridFrame &frame = get_displayed_frame();
+    const int frame_width  = frame.get_grid_width();
+    const int frame_height = frame.get_grid_height();
+    const float grid_total_width  = frame_width  * this->zoom;
+    const float grid_total_height = frame_height * this->zoom;
 
     // The center of the canvas acts as the origin, so the start position needs to be moved left and up accordingly.
     // Also, the view offset is summed in afterwards.
     const float min_x = 0.f - grid_total_width  / 2.f + offset_x;
     const float min_y = 0.f - grid_total_height / 2.f + offset_y;
 
-    const float max_x = grid_total_width  / 2.f + offset_x;
-    const float max_y = grid_total_height / 2.f + offset_y;
-
-    const float cell_width  = zoom;
-    const float cell_height = zoom;
+    // The cells within the displayed area
+    const int first_x = std::max(0, to_int(std::floor((static_cast<float>(rect.left()) - min_x) / zoom)));
+    const int first_y = std::max(0, to_int(std::floor((static_cast<float>(rect.top()) - min_y) / zoom)));
+    const int last_x  = std::min(frame_width,  to_int(std::ceil((static_cast<float>(rect.right()) - min_x) / zoom)));
+    const int last_y  = std::min(frame_height, to_int(std::ceil((static_cast<float>(rect.bottom()) - min_y) / zoom)));
+    if(first_x >= last_x || first_y >= last_y)
+    {
+        return;
+    }
 
-    // Grab the displayed area
-    const float scene_width  = static_cast<float>(rect.width());
-    const float scene_height = static_cast<float>(rect.height());
+    // A pixel covers several cells when zoomed out
+    if(zoom < 1.f)
+    {
+        draw_density(painter, first_x, first_y, last_x, last_y, min_x, min_y);
+        return;
+    }
 
-    // A safety margin to render content slightly outside of the display
-    const float display_margin  = 2 * zoom;
+    draw_cells(painter, first_x, first_y, last_x, last_y, min_x, min_y);
+    if(zoom >= min_grid_line_zoom)
+    {
+        draw_grid_lines(painter, first_x, first_y, last_x, last_y, min_x, min_y);
+    }
+}
 
-    // Calculate limits around the visible area.
-    // These are to limit what should be rendered and what should be ignored.
-    const float displayed_min_x = 0 - scene_width  / 2 - display_margin;
-    const float displayed_min_y = 0 - scene_height / 2 - display_margin;
-    const float displayed_max_x = displayed_min_x + scene_width  + display_margin * 2;
-    const float displayed_max_y = displayed_min_y + scene_height + display_margin * 2;
+bool LifeGridScene::clip_to_bounding_box(int &first_x, int &first_y, int &last_x, int &last_y) const
+{
+    // Only the cells within the bounding box can be anything but dead
+    int box_min_x = 0;
+    int box_min_y = 0;
+    int box_max_x = 0;
+    int box_max_y = 0;
+    if(!get_displayed_frame().get_bounding_box(box_min_x, box_min_y, box_max_x, box_max_y))
+    {
+        return false;
+    }
+    first_x = std::max(first_x, box_min_x);
+    first_y = std::max(first_y, box_min_y);
+    last_x  = std::min(last_x, box_max_x + 1);
+    last_y  = std::min(last_y, box_max_y + 1);
+    return first_x < last_x && first_y < last_y;
+}
 
+void LifeGridScene::draw_cells(QPainter *painter, int first_x, int first_y, int last_x, int last_y, float min_x, float min_y) const
+{
+    if(!clip_to_bounding_box(first_x, first_y, last_x, last_y))
+    {
+        return;
+    }
+    const GridFrame &frame = get_displayed_frame();
+    const int states = frame.get_states();
+
+    // The image starts on a whole word, so that the packed rows can be copied as they are
+    const int first_word = first_x / 64;
+    const int last_word  = (last_x + 63) / 64;
+    const int image_width  = (last_word - first_word) * 64;
+    const int image_height = last_y - first_y;
+
+    // A bit per cell with the two state rules, a byte per cell with the dying states
+    const bool is_two_state = states <= 2;
+    const QImage::Format format = is_two_state ? QImage::Format_MonoLSB : QImage::Format_Indexed8;
+    if(cell_image.width() != image_width || cell_image.height() != image_height || cell_image.format() != format)
+    {
+        cell_image = QImage(image_width, image_height, format);
+    }
 
-    // Draw the live cells
-    painter->setBrush(QBrush(Qt::BrushStyle::SolidPattern));
-    size_t cell_index = 0;
-    for(int y = 0; y < grid_height; y++)
+    // The dead cells let the background through, and the dying states fade from dark to light grey
+    QVector<QRgb> colors{qRgba(0, 0, 0, 0), qRgb(0, 0, 0)};
+    for(int state = 2; state < states; state++)
     {
-        const int current_y = to_int(min_y + cell_height * y);
+        const int shade = 64 + 160 * (state - 1) / (states - 1);
+        colors.push_back(qRgb(shade, shade, shade));
+    }
+    cell_image.setColorTable(colors);
 
-        // If this row isn't displayed, skip it
-        if(current_y < displayed_min_y)
+    row_words.resize(static_cast<size_t>(last_word - first_word));
+    for(int y = first_y; y < last_y; y++)
+    {
+        uchar *line = cell_image.scanLine(y - first_y);
+        if(is_two_state)
         {
-            cell_index += static_cast<size_t>(grid_width);
+            // Format_MonoLSB has the first pixel in the lowest bit, like the packed words
+            frame.get_row_bits(y, 0, first_word, last_word, row_words.data());
+            for(size_t word = 0; word < row_words.size(); word++)
+            {
+                for(int byte = 0; byte < 8; byte++)
+                {
+                    line[word * 8 + static_cast<size_t>(byte)] = static_cast<uchar>(row_words[word] >> (byte * 8));
+                }
+            }
             continue;
         }
-        else if(current_y > displayed_max_y)
-        {
-            break;
-        }
 
-        for(int x = 0; x < grid_width; x++)
+        std::fill(line, line + image_width, 0);
+        for(int plane = 0; plane < frame.get_state_bits(); plane++)
         {
-            const int current_x = to_int(min_x + cell_width * x);
-
-            // If this column isn't displayed, skip it
-            if(current_x < displayed_min_x)
-            {
-                cell_index += 1;
-                continue;
-            }
-            else if(current_x > displayed_max_x)
-            {
-                cell_index += 1;
-                continue;
-            }
-
-            CELL cell = cells[cell_index++];
-            if (cell == ALIVE)
+            frame.get_row_bits(y, plane, first_word, last_word, row_words.data());
+            for(int x = 0; x < image_width; x++)
             {
-               painter->drawRect(current_x, current_y, to_int(cell_width), to_int(cell_height));
+                line[x] |= static_cast<uchar>(((row_words[static_cast<size_t>(x / 64)] >> (x % 64)) & 1) << plane);
             }
         }
     }
 
-    // Draw the grid
-    painter->setPen(QColor(127, 127, 127, 127));
-    for(int x = 0; x <= grid_width; x++)
+    // A single blit, scaled without smoothing so that every cell stays a sharp square
+    const QRectF target(
+        min_x + zoom * first_word * 64,
+        min_y + zoom * first_y,
+        static_cast<qreal>(zoom) * image_width,
+        static_cast<qreal>(zoom) * image_height
+    );
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->drawImage(target, cell_image);
+}
+
+void LifeGridScene::draw_density(QPainter *painter, int first_x, int first_y, int last_x, int last_y, float min_x, float min_y) const
+{
+    if(density_pyramid.get_level_count() == 0 || !clip_to_bounding_box(first_x, first_y, last_x, last_y))
     {
-        const int line_x = to_int(min_x + cell_width * x);
+        return;
+    }
 
-        // If this column isn't displayed, skip it
-        if(line_x < displayed_min_x)
-        {
-            continue;
-        }
-        else if(line_x > displayed_max_x)
+    // The zoom is a power of two, so there's a level with a block per pixel
+    const int level = std::min(density_pyramid.get_level_count(), std::max(1, to_int(std::lround(std::log2(1.f / zoom)))));
+    const int block_size = 1 << level;
+    const int first_block_x = first_x / block_size;
+    const int first_block_y = first_y / block_size;
+    const int last_block_x  = (last_x + block_size - 1) / block_size;
+    const int last_block_y  = (last_y + block_size - 1) / block_size;
+    const int image_width  = last_block_x - first_block_x;
+    const int image_height = last_block_y - first_block_y;
+
+    if(density_image.width() != image_width || density_image.height() != image_height)
+    {
+        density_image = QImage(image_width, image_height, QImage::Format_Indexed8);
+
+        // The empty blocks let the background through, and the fuller ones are darker
+        QVector<QRgb> colors;
+        for(int shade = 0; shade < 256; shade++)
         {
-            break;
+            colors.push_back(qRgba(0, 0, 0, shade));
         }
-
-        painter->drawLine(
-            line_x,
-            to_int(std::max(min_y, displayed_min_y)),
-            line_x,
-            to_int(std::min(max_y, displayed_max_y))
-        );
+        density_image.setColorTable(colors);
     }
 
-    for(int y = 0; y <= grid_height; y++)
+    for(int y = first_block_y; y < last_block_y; y++)
     {
-        const int line_y = to_int(min_y + cell_height * y);
+        density_pyramid.get_level_shades(level, y, first_block_x, last_block_x, density_image.scanLine(y - first_block_y));
+    }
 
-        // If this row isn't displayed, skip it
-        if(line_y < displayed_min_y)
-        {
-            continue;
-        }
-        else if(line_y > displayed_max_y)
-        {
-            break;
-        }
+    const QRectF target(
+        min_x + zoom * first_block_x * block_size,
+        min_y + zoom * first_block_y * block_size,
+        static_cast<qreal>(zoom) * image_width * block_size,
+        static_cast<qreal>(zoom) * image_height * block_size
+    );
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->drawImage(target, density_image);
+}
+
+void LifeGridScene::draw_grid_lines(QPainter *painter, int first_x, int first_y, int last_x, int last_y, float min_x, float min_y) const
+{
+    const QColor line_color(127, 127, 127, 127);
 
-        painter->drawLine(
-            to_int(std::max(min_x, displayed_min_x)),
-            line_y,
-            to_int(std::min(max_x, displayed_max_x)),
-            line_y
-        );
+    // A cell sized tile with its top and left edge, redrawn only when the zoom changes
+    if(grid_line_tile_zoom != zoom)
+    {
+        const int size = to_int(zoom);
+        grid_line_tile = QPixmap(size, size);
+        grid_line_tile.fill(Qt::transparent);
+
+        QPainter tile_painter(&grid_line_tile);
+        tile_painter.setPen(line_color);
+        tile_painter.drawLine(0, 0, size - 1, 0);
+        tile_painter.drawLine(0, 1, 0, size - 1);
+        grid_line_tile_zoom = zoom;
+    }
+
+    const QRectF area(
+        min_x + zoom * first_x,
+        min_y + zoom * first_y,
+        static_cast<qreal>(zoom) * (last_x - first_x),
+        static_cast<qreal>(zoom) * (last_y - first_y)
+    );
+    painter->drawTiledPixmap(area, grid_line_tile);
+
+    // The tiles leave out the lines closing the last column and row
+    painter->setPen(line_color);
+    const GridFrame &frame = get_displayed_frame();
+    if(last_x == frame.get_grid_width())
+    {
+        painter->drawLine(QLineF(area.right(), area.top(), area.right(), area.bottom()));
+    }
+    if(last_y == frame.get_grid_height())
+    {
+        painter->drawLine(QLineF(area.left(), area.bottom(), area.right(), area.bottom()));
     }
 }
@@ -2,12 +2,22 @@
 #define LIFEGRIDSCENE_H
 
 #include "cellkernel.h"
+#include "densitypyramid.h"
+#include "gridframe.h"
 #include "lifegrid.h"
+#include "recorder.h"
 
 #include <QGraphicsScene>
+#include <QImage>
 #include <QPaintEvent>
+#include <QPixmap>
+#include <QTimer>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <thread>
 
@@ -32,9 +42,11 @@ class LifeGridScene : public LifeGrid, public QGraphicsScene
     virtual ~LifeGridScene() override;
 
     /*!
-     * \brief The zoom level. Can be adjusted with the mouse wheel.
+     * \brief The zoom level in pixels per cell. Can be adjusted with the mouse wheel.
+     * \details A whole number from 1 up. Below that it's a power of two, and the
+     *          cells are drawn as the density of the blocks covered by a pixel.
      */
-    int zoom;
+    float zoom;
 
     /*!
      * \brief The X-axis offset.
@@ -52,6 +64,57 @@ class LifeGridScene : public LifeGrid, public QGraphicsScene
      */
     void run(bool run);
 
+    /*!
+     * \brief Sets what to call when the running simulation settles into a cycle
+     * \details The simulation stops before the callback is called. The callback is
+     *          called from the update thread, so it has to pass the work on to
+     *          the GUI thread. A cycle found before the run started doesn't stop it.
+     * \param callback Called with the period of the cycle
+     */
+    void set_cycle_found_callback(std::function<void(int)> callback);
+
+    /*!
+     * \brief Steps a generation, and records it if a recording is running
+     */
+    void step_generation();
+
+    /*!
+     * \brief Steps generations as fast as the engine allows
+     * \details Steps them one by one while recording, so that every one is recorded
+     * \param generations The amount of generations to step
+     */
+    void step_generations(int generations);
+
+    /*!
+     * \brief Changes the grid without racing the update thread
+     * \details The change is made right away when the simulation isn't running.
+     *          Otherwise it's queued, and made by the update thread between two
+     *          generations. Neither side waits on the other.
+     * \param change Called with the grid to itself
+     */
+    void change_grid(std::function<void()> change);
+
+    /*!
+     * \brief Grab the frame on display
+     * \details The latest generation published by the simulation, for the GUI thread only
+     * \return The displayed frame
+     */
+    const GridFrame &get_displayed_frame() const;
+
+    /*!
+     * \brief Starts recording every generation into a file
+     * \details The current grid is recorded as the first frame. The recording
+     *          stops by itself if the grid is resized. Throws std::runtime_error
+     *          if the file can't be created.
+     * \param path The file to record into
+     */
+    void start_recording(const std::string &path);
+
+    /*!
+     * \brief Stops the recording and finishes the file
+     */
+    void stop_recording();
+
     void drawForeground(QPainter *painter, const QRectF &rect) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
@@ -66,7 +129,8 @@ class LifeGridScene : public LifeGrid, public QGraphicsScene
 
     /*!
      * \brief Set the simulation speed
-     * \param updates_per_second How many times in a second should we step
+     * \param updates_per_second How many times in a second should we step. 0 steps as fast as
+     *        possible, in batches, with the view showing the latest generation at the display rate.
      */
     void set_speed(int updates_per_second);
 
@@ -78,12 +142,113 @@ class LifeGridScene : public LifeGrid, public QGraphicsScene
     void toggle_painting_enabled(bool enabled);
 
   private:
+    /*!
+     * \brief Clips an area of the grid to the bounding box of the cells
+     * \param first_x The first column, moved right if needed
+     * \param first_y The first row, moved down if needed
+     * \param last_x One past the last column, moved left if needed
+     * \param last_y One past the last row, moved up if needed
+     * \return False if nothing but dead cells is left
+     */
+    bool clip_to_bounding_box(int &first_x, int &first_y, int &last_x, int &last_y) const;
+
     /*!
      * \brief Renders the grid
+     * \details The cost follows the displayed pixels, not the amount of live cells
      * \param painter Passed in by Qt upon an update
+     * \param rect The displayed area in scene coordinates
      */
     void draw_grid(QPainter *painter, const QRectF &rect) const;
 
+    /*!
+     * \brief Draws the displayed cells
+     * \details The cells are copied from the packed rows into cell_image, a pixel
+     *          per cell, which is drawn scaled up with a single blit
+     * \param painter Passed in by Qt upon an update
+     * \param first_x The first displayed column
+     * \param first_y The first displayed row
+     * \param last_x One past the last displayed column
+     * \param last_y One past the last displayed row
+     * \param min_x The scene position of the grid's left edge
+     * \param min_y The scene position of the grid's top edge
+     */
+    void draw_cells(QPainter *painter, int first_x, int first_y, int last_x, int last_y, float min_x, float min_y) const;
+
+    /*!
+     * \brief Draws the displayed cells zoomed out, as the density of the live cells
+     * \details The level of density_pyramid with a block per pixel is shaded into
+     *          density_image, a shade of grey per block, and drawn with a single blit
+     * \param painter Passed in by Qt upon an update
+     * \param first_x The first displayed column
+     * \param first_y The first displayed row
+     * \param last_x One past the last displayed column
+     * \param last_y One past the last displayed row
+     * \param min_x The scene position of the grid's left edge
+     * \param min_y The scene position of the grid's top edge
+     */
+    void draw_density(QPainter *painter, int first_x, int first_y, int last_x, int last_y, float min_x, float min_y) const;
+
+    /*!
+     * \brief Draws the lines between the displayed cells, tiled from grid_line_tile
+     * \param painter Passed in by Qt upon an update
+     * \param first_x The first displayed column
+     * \param first_y The first displayed row
+     * \param last_x One past the last displayed column
+     * \param last_y One past the last displayed row
+     * \param min_x The scene position of the grid's left edge
+     * \param min_y The scene position of the grid's top edge
+     */
+    void draw_grid_lines(QPainter *painter, int first_x, int first_y, int last_x, int last_y, float min_x, float min_y) const;
+
+    /*!
+     * \brief Copies the grid into a frame and hands it over to the GUI thread
+     * \details Called by whichever thread has the grid. Nothing is copied if
+     *          the grid didn't change since the last frame.
+     * \param force Replace the last frame even if it hasn't been taken yet
+     * \return True if a frame was published
+     */
+    bool publish_frame(bool force);
+
+    /*!
+     * \brief Takes the latest published frame on display, and notes its changed tiles
+     * \details Repaints nothing, the caller knows what changed
+     * \return False if there was no new frame
+     */
+    bool take_published_frame();
+
+    /*!
+     * \brief Takes the latest published frame on display, and repaints the tiles it changed
+     * \details The whole view is repainted if a frame was skipped, or if the grid was resized
+     */
+    void show_latest_frame();
+
+    /*!
+     * \brief Publishes the changes made by the GUI thread, and repaints them
+     */
+    void show_grid_changes();
+
+    /*!
+     * \brief Calculates the area of some cells in the scene
+     * \param first_x The first column
+     * \param first_y The first row
+     * \param last_x One past the last column
+     * \param last_y One past the last row
+     * \return The area in scene coordinates, with the grid lines around it
+     */
+    QRectF cells_to_scene_rect(int first_x, int first_y, int last_x, int last_y) const;
+
+    /*!
+     * \brief Makes the changes queued by change_grid()
+     */
+    void apply_queued_changes();
+
+    /*!
+     * \brief Paints a cell through change_grid()
+     * \param pos The cell to paint
+     * \param state The wanted state of the cell
+     */
+    void paint_cell(const QPoint &pos, CELL state);
+
     /*!
      * \brief Calculates the relevant grid position when an UI event happens
      * \param scene_pos A position given by the Qt
@@ -110,25 +275,117 @@ class LifeGridScene : public LifeGrid, public QGraphicsScene
     bool is_dragging_view;
 
     /*!
-     * \brief Simulation speed. Updates per second.
+     * \brief Simulation speed. Updates per second, or 0 for uncapped.
      */
-    int speed;
+    std::atomic<int> speed;
 
     /*!
      * \brief Is the simulation running?
      */
-    bool is_running;
+    std::atomic<bool> is_running;
 
     /*!
      * \brief The update thread, used when the simulation is running on its own
      */
     std::thread update_thread;
 
+    /*!
+     * \brief Repaints the view at the display rate while running, when there's a new frame
+     */
+    QTimer repaint_timer;
+
+    /*!
+     * \brief Called when the running simulation settles into a cycle
+     */
+    std::function<void(int)> cycle_found_callback;
+
+    /*!
+     * \brief The recording in progress, or null
+     */
+    std::unique_ptr<Recorder> recorder;
+
+    /*!
+     * \brief Guards the recorder, as the update thread records while the GUI thread stops it
+     */
+    std::mutex recorder_mutex;
+
 
     /*!
      * \brief Can the user paint cells?
      */
     bool is_painting_enabled;
+
+    /*!
+     * \brief The displayed cells, a pixel per cell. Kept between the frames to save the allocation.
+     */
+    mutable QImage cell_image;
+
+    /*!
+     * \brief A row of cell_image as packed words, before it's copied into the image
+     */
+    mutable std::vector<uint64_t> row_words;
+
+    /*!
+     * \brief A single cell of the grid lines, tiled over the displayed cells
+     */
+    mutable QPixmap grid_line_tile;
+
+    /*!
+     * \brief The zoom level grid_line_tile was drawn for
+     */
+    mutable float grid_line_tile_zoom;
+
+    /*!
+     * \brief The density of the live cells at halving resolutions, for when zoomed out
+     */
+    DensityPyramid density_pyramid;
+
+    /*!
+     * \brief The tiles changed since density_pyramid was updated
+     * \details The pyramid is updated only when it's drawn, the changes pile up meanwhile
+     */
+    std::vector<unsigned char> pyramid_changed_tiles;
+
+    /*!
+     * \brief The frames handed over from the thread with the grid to the GUI thread
+     */
+    FrameExchange frame_exchange;
+
+    /*!
+     * \brief The amount of frames published, the sequence of the last one
+     */
+    uint64_t published_frame_count;
+
+    /*!
+     * \brief The generation of the last published frame
+     */
+    uint64_t published_generation;
+
+    /*!
+     * \brief The changed tiles collected for the frame being published
+     */
+    std::vector<unsigned char> collected_tiles;
+
+    /*!
+     * \brief The sequence of the frame on display
+     */
+    uint64_t displayed_frame_sequence;
+
+    /*!
+     * \brief The changes waiting for the update thread, or null
+     * \details Owned by whichever thread last took it out with an exchange
+     */
+    std::atomic<std::vector<std::function<void()>> *> queued_changes;
+
+    /*!
+     * \brief The cell painted last while dragging, so that it's queued only once
+     */
+    QPoint last_painted_cell;
+
+    /*!
+     * \brief The displayed blocks of a density_pyramid level, a byte per block
+     */
+    mutable QImage density_image;
 };
 
 #endif // LIFEGRIDSCENE_H
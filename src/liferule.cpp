@@ -0,0 +1,146 @@
+#include "liferule.h"
+
+#include <cctype>
+#include <stdexcept>
+
+/*
+ * Reads the neighbour counts from the start of the string into the mask.
+ * Returns the amount of characters read.
+ */
+static size_t parse_counts(const std::string &rulestring, size_t position, uint16_t &mask)
+{
+    const size_t start = position;
+    for(; position < rulestring.size() && std::isdigit(static_cast<unsigned char>(rulestring[position])); position++)
+    {
+        const int count = rulestring[position] - '0';
+        if(count > 8)
+        {
+            throw std::invalid_argument("A cell can't have more than 8 neighbours: " + rulestring);
+        }
+        mask |= 1 << count;
+    }
+    return position - start;
+}
+
+/*
+ * Reads the state count of a Generations rule from the start of the string.
+ * Returns the amount of characters read.
+ */
+static size_t parse_states(const std::string &rulestring, size_t position, int &states)
+{
+    const size_t start = position;
+    states = 0;
+    for(; position < rulestring.size() && std::isdigit(static_cast<unsigned char>(rulestring[position])); position++)
+    {
+        states = states * 10 + (rulestring[position] - '0');
+        if(states > 256)
+        {
+            break;
+        }
+    }
+
+    if(position == start || states < 2 || states > 256)
+    {
+        throw std::invalid_argument("The state count must be 2 to 256: " + rulestring);
+    }
+    return position - start;
+}
+
+LifeRule::LifeRule(const std::string &rulestring) :
+    birth{0},
+    survival{0},
+    states{2}
+{
+    const bool has_letters = rulestring.find_first_of("BbSsCc") != std::string::npos;
+
+    if(!has_letters)
+    {
+        // The S/B notation, survival counts first and the state count last
+        size_t position = parse_counts(rulestring, 0, survival);
+        if(position == rulestring.size() || rulestring[position] != '/')
+        {
+            throw std::invalid_argument("Expected a rulestring like B3/S23 or 23/3: " + rulestring);
+        }
+
+        position += 1;
+        position += parse_counts(rulestring, position, birth);
+        if(position < rulestring.size() && rulestring[position] == '/')
+        {
+            position += 1;
+            position += parse_states(rulestring, position, states);
+        }
+
+        if(position != rulestring.size())
+        {
+            throw std::invalid_argument("Unexpected character in the rulestring: " + rulestring);
+        }
+        return;
+    }
+
+    // The B/S notation, in any order
+    bool has_birth = false;
+    bool has_survival = false;
+    bool has_states = false;
+    size_t position = 0;
+    while(position < rulestring.size())
+    {
+        const char letter = static_cast<char>(std::toupper(static_cast<unsigned char>(rulestring[position])));
+        if(letter == 'B' && !has_birth)
+        {
+            has_birth = true;
+            position += 1 + parse_counts(rulestring, position + 1, birth);
+        }
+        else if(letter == 'S' && !has_survival)
+        {
+            has_survival = true;
+            position += 1 + parse_counts(rulestring, position + 1, survival);
+        }
+        else if(letter == 'C' && !has_states)
+        {
+            has_states = true;
+            position += 1 + parse_states(rulestring, position + 1, states);
+        }
+        else
+        {
+            throw std::invalid_argument("Unexpected character in the rulestring: " + rulestring);
+        }
+
+        // The parts may be separated by a slash
+        if(position < rulestring.size() && rulestring[position] == '/')
+        {
+            position++;
+        }
+    }
+
+    if(!has_birth || !has_survival)
+    {
+        throw std::invalid_argument("The rulestring needs both B and S: " + rulestring);
+    }
+}
+
+std::string LifeRule::to_string() const
+{
+    std::string rulestring = "B";
+    for(int count = 0; count <= 8; count++)
+    {
+        if((birth >> count) & 1)
+        {
+            rulestring += static_cast<char>('0' + count);
+        }
+    }
+
+    rulestring += "/S";
+    for(int count = 0; count <= 8; count++)
+    {
+        if((survival >> count) & 1)
+        {
+            rulestring += static_cast<char>('0' + count);
+        }
+    }
+
+    if(states > 2)
+    {
+        rulestring += "/C" + std::to_string(states);
+    }
+    return rulestring;
+}
@@ -0,0 +1,136 @@
+#ifndef LIFERULE_H
+#define LIFERULE_H
+
+#include <cstdint>
+#include <string>
+
+/*!
+ * \brief A Life-like rule, such as B3/S23 for Conway's Game of Life
+ * \details A dead cell is born if its neighbour count is in the birth set,
+ *          and a live cell survives if its neighbour count is in the survival set.
+ *          Bit N of the masks stands for N neighbours.
+ *
+ *          The Generations rules, like Brian's Brain (B2/S/C3), have more than two states.
+ *          A live cell that doesn't survive starts dying instead: it goes through the
+ *          states 2, 3 and so on, one a generation, until it's dead again. Only the live
+ *          cells count as neighbours, and only the dead cells can be born.
+ */
+struct LifeRule
+{
+    /*!
+     * \brief The neighbour counts giving birth to a dead cell
+     */
+    uint16_t birth;
+
+    /*!
+     * \brief The neighbour counts keeping a live cell alive
+     */
+    uint16_t survival;
+
+    /*!
+     * \brief The amount of cell states, DEAD and ALIVE included
+     * \details 2 for the Life-like rules, up to 256 for the Generations rules
+     */
+    int states;
+
+    /*!
+     * \brief Construct the rule from the masks
+     * \param birth_mask Bit N set if N neighbours give birth
+     * \param survival_mask Bit N set if a cell survives with N neighbours
+     * \param state_count The amount of cell states, 2 to 256
+     */
+    constexpr LifeRule(uint16_t birth_mask, uint16_t survival_mask, int state_count=2) :
+        birth{birth_mask},
+        survival{survival_mask},
+        states{state_count}
+    {
+    }
+
+    /*!
+     * \brief Parses a rulestring
+     * \details Accepts the B/S notation, like "B36/S23", and the older S/B notation, like "23/36".
+     *          The Generations rules add the state count, like "B2/S/C3" or "/2/3".
+     *          The letters may be in either case, and the slash can be left out between the parts.
+     *          Throws std::invalid_argument if the rulestring can't be parsed.
+     * \param rulestring The rule to parse
+     */
+    explicit LifeRule(const std::string &rulestring);
+
+    /*!
+     * \brief Formats the rule in the B/S notation
+     * \return The rulestring, like "B3/S23" or "B2/S/C3"
+     */
+    std::string to_string() const;
+
+    /*!
+     * \brief The amount of bits needed for storing a cell state
+     * \return 1 for the Life-like rules, 2 for 3 or 4 states, and so on
+     */
+    constexpr int get_state_bits() const
+    {
+        int bits = 1;
+        while((1 << bits) < states)
+        {
+            bits++;
+        }
+        return bits;
+    }
+
+    /*!
+     * \brief Applies the rule to a single cell
+     * \param is_alive Is the cell alive now?
+     * \param neighbours The amount of live neighbours, 0 to 8
+     * \return True if the cell is alive in the next generation
+     */
+    constexpr bool is_alive_next(bool is_alive, int neighbours) const
+    {
+        return ((is_alive ? survival : birth) >> neighbours) & 1;
+    }
+
+    constexpr bool operator==(const LifeRule &other) const
+    {
+        return birth == other.birth && survival == other.survival && states == other.states;
+    }
+
+    constexpr bool operator!=(const LifeRule &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/*!
+ * \brief B3/S23, Conway's Game of Life. The default rule with the fastest kernels.
+ */
+constexpr LifeRule conway_rule{1 << 3, (1 << 2) | (1 << 3)};
+
+/*!
+ * \brief B36/S23, like Conway's but with a replicator
+ */
+constexpr LifeRule highlife_rule{(1 << 3) | (1 << 6), (1 << 2) | (1 << 3)};
+
+/*!
+ * \brief B3678/S34678, where the live and the dead cells behave the same
+ */
+constexpr LifeRule day_and_night_rule{(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8), (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)};
+
+/*!
+ * \brief B2/S, every cell dies right after being born
+ */
+constexpr LifeRule seeds_rule{1 << 2, 0};
+
+/*!
+ * \brief B3/S012345678, the cells never die
+ */
+constexpr LifeRule life_without_death_rule{1 << 3, 0x1ff};
+
+/*!
+ * \brief B2/S/C3, Brian's Brain
+ */
+constexpr LifeRule brians_brain_rule{1 << 2, 0, 3};
+
+/*!
+ * \brief B2/S345/C4, Star Wars
+ */
+constexpr LifeRule star_wars_rule{1 << 2, (1 << 3) | (1 << 4) | (1 << 5), 4};
+
+#endif // LIFERULE_H
@@ -0,0 +1,75 @@
+#include "lookupkernel.h"
+
+#include <memory>
+
+static constexpr int count_bits(unsigned bits)
+{
+    int count = 0;
+    for(; bits; bits &= bits - 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+static constexpr std::array<CELL, 512> make_cell_state_table(const LifeRule &rule)
+{
+    std::array<CELL, 512> table{};
+    for(unsigned index = 0; index < table.size(); index++)
+    {
+        // Leave the centre cell out of the count
+        const int neighbours = count_bits(index & ~(1u << 4));
+        table[index] = rule.is_alive_next((index >> 4) & 1, neighbours) ? ALIVE : DEAD;
+    }
+    return table;
+}
+
+static constexpr std::array<unsigned char, 65536> make_block_state_table(const LifeRule &rule)
+{
+    /*
+     * The neighbours of the four centre cells, as masks of the block index.
+     * The 3x3 neighbourhood of (1, 1) is the bits 0-2, 4-6 and 8-10, the
+     * others are the same shifted by a column (4 bits) or a row (1 bit).
+     */
+    constexpr unsigned neighbourhood = 0x777;
+
+    std::array<unsigned char, 65536> table{};
+    for(unsigned index = 0; index < table.size(); index++)
+    {
+        unsigned char result = 0;
+        for(int x = 0; x < 2; x++)
+        {
+            for(int y = 0; y < 2; y++)
+            {
+                const int centre = 4 * (x + 1) + (y + 1);
+                const unsigned neighbours = index & (neighbourhood << (4 * x + y)) & ~(1u << centre);
+                if(rule.is_alive_next((index >> centre) & 1, count_bits(neighbours)))
+                {
+                    result |= 1 << (2 * x + y);
+                }
+            }
+        }
+        table[index] = result;
+    }
+    return table;
+}
+
+// The extern declarations in the header give these external linkage
+constexpr std::array<CELL, 512> cell_state_table = make_cell_state_table(conway_rule);
+constexpr std::array<unsigned char, 65536> block_state_table = make_block_state_table(conway_rule);
+
+// A horizontal blinker: the centre survives, the cells above and below it are born
+static_assert(cell_state_table[0x038] == ALIVE, "The centre of a blinker should survive");
+static_assert(cell_state_table[0x007] == ALIVE, "A cell with three neighbours should be born");
+static_assert(cell_state_table[0x1ff] == DEAD, "A crowded cell should die");
+static_assert(block_state_table[0x0660] == 0x0f, "A block should stay still");
+
+void build_lookup_tables(const LifeRule &rule, std::vector<CELL> &cell_table, std::vector<unsigned char> &block_table)
+{
+    // A bit big for the stack
+    const auto blocks = std::make_unique<std::array<unsigned char, 65536>>(make_block_state_table(rule));
+    const std::array<CELL, 512> cells = make_cell_state_table(rule);
+
+    cell_table.assign(cells.begin(), cells.end());
+    block_table.assign(blocks->begin(), blocks->end());
+}
@@ -0,0 +1,41 @@
+#ifndef LOOKUPKERNEL_H
+#define LOOKUPKERNEL_H
+
+#include "cellkernel.h"
+
+#include <array>
+#include <vector>
+
+/*!
+ * \brief The next state of every 3x3 neighbourhood with B3/S23, for stepping a single cell
+ * \details Bit N of the index is the cell N of a CellKernel, set if ALIVE:
+ * <pre>
+ * 0 1 2
+ * 3 4 5
+ * 6 7 8
+ * </pre>
+ *          Built at compile time.
+ */
+extern const std::array<CELL, 512> cell_state_table;
+
+/*!
+ * \brief The next state of the 2x2 centre of every 4x4 block with B3/S23
+ * \details The index is built a column at a time: bit 4*x+y is the cell (x, y)
+ *          of the block. Sliding the block two columns to the right is then just
+ *          a shift by a byte. The result is laid out the same way, bit 2*x+y
+ *          being the next state of the centre cell (x+1, y+1).
+ *
+ *          Built at compile time.
+ */
+extern const std::array<unsigned char, 65536> block_state_table;
+
+/*!
+ * \brief Builds the lookup tables for any rule
+ * \details Laid out the same as cell_state_table and block_state_table
+ * \param rule The rule to build the tables for
+ * \param cell_table Filled with the 512 states of the 3x3 neighbourhoods
+ * \param block_table Filled with the 65536 states of the 4x4 blocks
+ */
+void build_lookup_tables(const LifeRule &rule, std::vector<CELL> &cell_table, std::vector<unsigned char> &block_table);
+
+#endif // LOOKUPKERNEL_H
@@ -0,0 +1,735 @@
+#include "patternio.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+/*
+ * Reads the stream a block at a time, so that even huge
+ * files are parsed without holding them in memory
+ */
+class BlockReader
+{
+  public:
+    explicit BlockReader(std::istream &input) :
+        stream(input),
+        buffer(64 * 1024),
+        position{0},
+        end{0}
+    {
+    }
+
+    int peek()
+    {
+        if(position == end && !fill())
+        {
+            return EOF;
+        }
+        return static_cast<unsigned char>(buffer[position]);
+    }
+
+    int get()
+    {
+        const int c = peek();
+        if(c != EOF)
+        {
+            position++;
+        }
+        return c;
+    }
+
+    void skip_line()
+    {
+        int c = get();
+        while(c != EOF && c != '\n')
+        {
+            c = get();
+        }
+    }
+
+    /*
+     * Reads the rest of the line, for the short header and comment lines
+     */
+    std::string read_line()
+    {
+        std::string line;
+        int c = get();
+        while(c != EOF && c != '\n')
+        {
+            if(c != '\r')
+            {
+                line.push_back(static_cast<char>(c));
+            }
+            c = get();
+        }
+        return line;
+    }
+
+  private:
+    bool fill()
+    {
+        stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        end = static_cast<size_t>(stream.gcount());
+        position = 0;
+        return end > 0;
+    }
+
+    std::istream &stream;
+    std::vector<char> buffer;
+    size_t position;
+    size_t end;
+};
+
+std::string trim(const std::string &text)
+{
+    const size_t first = text.find_first_not_of(" \t");
+    if(first == std::string::npos)
+    {
+        return "";
+    }
+    const size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+int parse_int(const std::string &text, const char *what)
+{
+    size_t end = 0;
+    long long value = 0;
+    try
+    {
+        value = std::stoll(text, &end);
+    }
+    catch(const std::exception &)
+    {
+        end = 0;
+    }
+
+    if(end == 0 || end != text.size() || value < INT_MIN || value > INT_MAX)
+    {
+        throw std::invalid_argument(std::string{"Invalid "} + what + ": " + text);
+    }
+    return static_cast<int>(value);
+}
+
+/*
+ * Writes the part of the run that lands on the grid
+ */
+void put_run(LifeGrid &grid, long long x, long long y, long long length, CELL state)
+{
+    if(y < 0 || y >= grid.get_grid_height())
+    {
+        return;
+    }
+
+    const long long first_x = std::max(x, 0LL);
+    const long long end_x = std::min(x + length, static_cast<long long>(grid.get_grid_width()));
+    if(first_x < end_x)
+    {
+        grid.set_cell_run(static_cast<int>(first_x), static_cast<int>(y), static_cast<int>(end_x - first_x), state);
+    }
+}
+
+/*
+ * Checks that the state fits the rule of the grid before writing it
+ */
+void check_state(const LifeGrid &grid, int state)
+{
+    if(state >= grid.get_rule().states)
+    {
+        throw std::invalid_argument("The pattern has a cell state the rule " + grid.get_rule().to_string() + " doesn't have");
+    }
+}
+
+/*
+ * Parses an RLE pattern. Without a grid, stops after the header.
+ */
+PatternInfo parse_rle(BlockReader &reader, LifeGrid *grid, long long x, long long y)
+{
+    PatternInfo info;
+
+    // The comment lines, and then the header line
+    bool has_header = false;
+    while(!has_header)
+    {
+        const int c = reader.peek();
+        if(c == EOF)
+        {
+            throw std::invalid_argument("The RLE pattern has no header line");
+        }
+
+        if(c == '#')
+        {
+            reader.get();
+            const int type = reader.get();
+            const std::string text = trim(reader.read_line());
+            if(type == 'N')
+            {
+                info.name = text;
+            }
+            else if(type == 'r')
+            {
+                info.rulestring = text;
+            }
+        }
+        else if(std::isspace(c))
+        {
+            reader.get();
+        }
+        else
+        {
+            const std::string header = reader.read_line();
+            size_t start = 0;
+            while(start <= header.size())
+            {
+                size_t comma = header.find(',', start);
+                if(comma == std::string::npos)
+                {
+                    comma = header.size();
+                }
+
+                const std::string item = header.substr(start, comma - start);
+                const size_t equals = item.find('=');
+                if(equals == std::string::npos)
+                {
+                    throw std::invalid_argument("Invalid RLE header: " + header);
+                }
+
+                const std::string key = trim(item.substr(0, equals));
+                const std::string value = trim(item.substr(equals + 1));
+                if(key == "x")
+                {
+                    info.width = parse_int(value, "RLE width");
+                }
+                else if(key == "y")
+                {
+                    info.height = parse_int(value, "RLE height");
+                }
+                else if(key == "rule")
+                {
+                    info.rulestring = value;
+                }
+                start = comma + 1;
+            }
+
+            if(info.width < 0 || info.height < 0)
+            {
+                throw std::invalid_argument("Invalid RLE header: " + header);
+            }
+            has_header = true;
+        }
+    }
+
+    if(!grid)
+    {
+        return info;
+    }
+
+    if(!info.rulestring.empty())
+    {
+        try
+        {
+            grid->set_rule(LifeRule{info.rulestring});
+        }
+        catch(const std::invalid_argument &)
+        {
+            // Not a rule the grid can run, so the cells are read with the current one
+        }
+    }
+
+    long long column = 0;
+    long long row = 0;
+    long long count = 0;
+    for(int c = reader.get(); c != EOF && c != '!'; c = reader.get())
+    {
+        if(c >= '0' && c <= '9')
+        {
+            count = std::min(count * 10 + (c - '0'), static_cast<long long>(INT_MAX));
+            continue;
+        }
+
+        const long long run = count > 0 ? count : 1;
+        count = 0;
+
+        if(c == 'b' || c == '.')
+        {
+            column += run;
+        }
+        else if(c == 'o')
+        {
+            put_run(*grid, x + column, y + row, run, ALIVE);
+            column += run;
+        }
+        else if((c >= 'A' && c <= 'X') || (c >= 'p' && c <= 'y'))
+        {
+            // The Generations states: A to X are 1 to 24, pA to pX 25 to 48 and so on
+            int state = 0;
+            if(c >= 'p')
+            {
+                const int letter = reader.get();
+                if(letter < 'A' || letter > 'X')
+                {
+                    throw std::invalid_argument("Invalid cell state in the RLE pattern");
+                }
+                state = 25 + (c - 'p') * 24 + (letter - 'A');
+            }
+            else
+            {
+                state = c - 'A' + 1;
+            }
+            check_state(*grid, state);
+            put_run(*grid, x + column, y + row, run, static_cast<CELL>(state));
+            column += run;
+        }
+        else if(c == '$')
+        {
+            row += run;
+            column = 0;
+        }
+        else if(c == '#')
+        {
+            reader.skip_line();
+        }
+        else if(!std::isspace(c))
+        {
+            throw std::invalid_argument(std::string{"Unexpected character in the RLE pattern: "} + static_cast<char>(c));
+        }
+    }
+
+    return info;
+}
+
+/*
+ * Parses a Life 1.06 pattern. Without a grid, only measures it.
+ */
+PatternInfo parse_life_106(BlockReader &reader, LifeGrid *grid, long long x, long long y)
+{
+    PatternInfo info;
+
+    long long min_x = 0;
+    long long min_y = 0;
+    long long max_x = -1;
+    long long max_y = -1;
+
+    for(int c = reader.peek(); c != EOF; c = reader.peek())
+    {
+        if(c == '#')
+        {
+            reader.skip_line();
+            continue;
+        }
+        if(std::isspace(c))
+        {
+            reader.get();
+            continue;
+        }
+
+        // A coordinate pair on a line of its own
+        long long coords[2] = {0, 0};
+        for(long long &coord : coords)
+        {
+            while(reader.peek() == ' ' || reader.peek() == '\t')
+            {
+                reader.get();
+            }
+
+            const bool negative = reader.peek() == '-';
+            if(negative || reader.peek() == '+')
+            {
+                reader.get();
+            }
+            if(reader.peek() < '0' || reader.peek() > '9')
+            {
+                throw std::invalid_argument("Expected a coordinate in the Life 1.06 pattern");
+            }
+            while(reader.peek() >= '0' && reader.peek() <= '9')
+            {
+                coord = std::min(coord * 10 + (reader.get() - '0'), static_cast<long long>(INT_MAX));
+            }
+            if(negative)
+            {
+                coord = -coord;
+            }
+        }
+
+        if(max_x < min_x)
+        {
+            min_x = max_x = coords[0];
+            min_y = max_y = coords[1];
+        }
+        else
+        {
+            min_x = std::min(min_x, coords[0]);
+            max_x = std::max(max_x, coords[0]);
+            min_y = std::min(min_y, coords[1]);
+            max_y = std::max(max_y, coords[1]);
+        }
+
+        if(grid)
+        {
+            put_run(*grid, x + coords[0], y + coords[1], 1, ALIVE);
+        }
+    }
+
+    if(max_x >= min_x)
+    {
+        info.min_x = static_cast<int>(min_x);
+        info.min_y = static_cast<int>(min_y);
+        info.width = static_cast<int>(std::min(max_x - min_x + 1, static_cast<long long>(INT_MAX)));
+        info.height = static_cast<int>(std::min(max_y - min_y + 1, static_cast<long long>(INT_MAX)));
+    }
+    return info;
+}
+
+/*
+ * Parses a plaintext pattern. Without a grid, only measures it.
+ */
+PatternInfo parse_plaintext(BlockReader &reader, LifeGrid *grid, long long x, long long y)
+{
+    PatternInfo info;
+
+    long long row = 0;
+    long long column = 0;
+    long long run_start = -1;
+    long long width = 0;
+    bool at_line_start = true;
+
+    for(int c = reader.get(); c != EOF; c = reader.get())
+    {
+        if(at_line_start && c == '!')
+        {
+            const std::string comment = reader.read_line();
+            if(comment.compare(0, 5, "Name:") == 0)
+            {
+                info.name = trim(comment.substr(5));
+            }
+            continue;
+        }
+        at_line_start = false;
+
+        if(c == 'O' || c == '*')
+        {
+            if(run_start < 0)
+            {
+                run_start = column;
+            }
+            column++;
+            continue;
+        }
+
+        // Anything else ends the run of live cells
+        if(run_start >= 0 && grid)
+        {
+            put_run(*grid, x + run_start, y + row, column - run_start, ALIVE);
+        }
+        run_start = -1;
+
+        if(c == '.')
+        {
+            column++;
+        }
+        else if(c == '\n')
+        {
+            width = std::max(width, column);
+            row++;
+            column = 0;
+            at_line_start = true;
+        }
+        else if(c != '\r' && c != ' ' && c != '\t')
+        {
+            throw std::invalid_argument(std::string{"Unexpected character in the plaintext pattern: "} + static_cast<char>(c));
+        }
+    }
+
+    // The last line may lack the line feed
+    if(run_start >= 0 && grid)
+    {
+        put_run(*grid, x + run_start, y + row, column - run_start, ALIVE);
+    }
+    if(!at_line_start)
+    {
+        width = std::max(width, column);
+        row++;
+    }
+
+    info.width = static_cast<int>(std::min(width, static_cast<long long>(INT_MAX)));
+    info.height = static_cast<int>(std::min(row, static_cast<long long>(INT_MAX)));
+    return info;
+}
+
+PatternInfo parse_pattern(std::istream &stream, PatternFormat format, LifeGrid *grid, int x, int y)
+{
+    BlockReader reader{stream};
+    switch(format)
+    {
+        case RLE_FORMAT:
+            return parse_rle(reader, grid, x, y);
+        case LIFE_106_FORMAT:
+            return parse_life_106(reader, grid, x, y);
+        case PLAINTEXT_FORMAT:
+            return parse_plaintext(reader, grid, x, y);
+    }
+    throw std::invalid_argument("Unknown pattern format");
+}
+
+/*
+ * Writes the RLE tokens, wrapping the lines at 70 characters.
+ * A line is gathered into a buffer first, as writing every token
+ * to the stream separately is slow on large patterns.
+ */
+class RleWriter
+{
+  public:
+    explicit RleWriter(std::ostream &output) :
+        stream(output)
+    {
+    }
+
+    ~RleWriter()
+    {
+        flush_line();
+    }
+
+    void put(long long count, const char *tag)
+    {
+        char token[32];
+        char *end = token;
+        if(count > 1)
+        {
+            end = std::to_chars(token, token + 20, count).ptr;
+        }
+        while(*tag)
+        {
+            *end++ = *tag++;
+        }
+
+        const size_t length = static_cast<size_t>(end - token);
+        if(line.size() + length > 70)
+        {
+            line.push_back('\n');
+            flush_line();
+        }
+        line.append(token, length);
+    }
+
+    void flush_line()
+    {
+        stream.write(line.data(), static_cast<std::streamsize>(line.size()));
+        line.clear();
+    }
+
+  private:
+    std::ostream &stream;
+    std::string line;
+};
+
+/*
+ * The tag of a cell state, like "o" or "pA"
+ */
+const char *rle_tag(CELL state, bool two_states, char (&tag)[3])
+{
+    if(two_states)
+    {
+        return state == DEAD ? "b" : "o";
+    }
+    if(state == DEAD)
+    {
+        return ".";
+    }
+    if(state <= 24)
+    {
+        tag[0] = static_cast<char>('A' + state - 1);
+        tag[1] = '\0';
+    }
+    else
+    {
+        tag[0] = static_cast<char>('p' + (state - 25) / 24);
+        tag[1] = static_cast<char>('A' + (state - 25) % 24);
+        tag[2] = '\0';
+    }
+    return tag;
+}
+
+void write_rle(std::ostream &stream, const LifeGrid &grid)
+{
+    const LifeRule rule = grid.get_rule();
+    const bool two_states = rule.states == 2;
+    const int width = grid.get_grid_width();
+    const int height = grid.get_grid_height();
+
+    stream << "x = " << width << ", y = " << height << ", rule = " << rule.to_string() << "\n";
+
+    RleWriter writer{stream};
+    char tag[3];
+    long long pending_rows = 0;
+    for(int y = 0; y < height; y++)
+    {
+        if(y > 0)
+        {
+            pending_rows++;
+        }
+
+        int x = 0;
+        while(x < width)
+        {
+            const CELL state = grid.get_cell(x, y);
+            int run_end = x + 1;
+            while(run_end < width && grid.get_cell(run_end, y) == state)
+            {
+                run_end++;
+            }
+
+            // The dead cells at the end of the row are left out
+            if(state != DEAD || run_end < width)
+            {
+                if(pending_rows > 0)
+                {
+                    writer.put(pending_rows, "$");
+                    pending_rows = 0;
+                }
+                writer.put(run_end - x, rle_tag(state, two_states, tag));
+            }
+            x = run_end;
+        }
+    }
+    writer.put(1, "!\n");
+}
+
+void write_life_106(std::ostream &stream, const LifeGrid &grid)
+{
+    stream << "#Life 1.06\n";
+    for(int y = 0; y < grid.get_grid_height(); y++)
+    {
+        for(int x = 0; x < grid.get_grid_width(); x++)
+        {
+            if(grid.get_cell(x, y) == ALIVE)
+            {
+                stream << x << ' ' << y << '\n';
+            }
+        }
+    }
+}
+
+void write_plaintext(std::ostream &stream, const LifeGrid &grid)
+{
+    std::string line;
+    for(int y = 0; y < grid.get_grid_height(); y++)
+    {
+        line.clear();
+        for(int x = 0; x < grid.get_grid_width(); x++)
+        {
+            if(grid.get_cell(x, y) == ALIVE)
+            {
+                // The dead cells before the live one, as the trailing ones are left out
+                line.resize(static_cast<size_t>(x), '.');
+                line.push_back('O');
+            }
+        }
+        stream << line << '\n';
+    }
+}
+
+}
+
+PatternFormat pattern_format_from_path(const std::string &path)
+{
+    const size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? std::string{} : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    if(extension == "rle")
+    {
+        return RLE_FORMAT;
+    }
+    if(extension == "lif" || extension == "life")
+    {
+        return LIFE_106_FORMAT;
+    }
+    if(extension == "cells")
+    {
+        return PLAINTEXT_FORMAT;
+    }
+    throw std::invalid_argument("Unknown pattern file extension: " + path);
+}
+
+PatternInfo measure_pattern(std::istream &stream, PatternFormat format)
+{
+    return parse_pattern(stream, format, nullptr, 0, 0);
+}
+
+PatternInfo read_pattern(std::istream &stream, PatternFormat format, LifeGrid &grid, int x, int y)
+{
+    return parse_pattern(stream, format, &grid, x, y);
+}
+
+void write_pattern(std::ostream &stream, PatternFormat format, const LifeGrid &grid)
+{
+    switch(format)
+    {
+        case RLE_FORMAT:
+            write_rle(stream, grid);
+            break;
+        case LIFE_106_FORMAT:
+            write_life_106(stream, grid);
+            break;
+        case PLAINTEXT_FORMAT:
+            write_plaintext(stream, grid);
+            break;
+    }
+}
+
+PatternInfo load_pattern(const std::string &path, LifeGrid &grid, bool resize_to_fit)
+{
+    const PatternFormat format = pattern_format_from_path(path);
+    std::ifstream file{path, std::ios::binary};
+    if(!file)
+    {
+        throw std::runtime_error("Can't open " + path);
+    }
+
+    // Measure first, then read again straight into the grid
+    const PatternInfo size = measure_pattern(file, format);
+    file.clear();
+    file.seekg(0);
+
+    int x = -size.min_x;
+    int y = -size.min_y;
+    if(resize_to_fit)
+    {
+        grid.resize_grid(std::max(3, size.width), std::max(3, size.height));
+    }
+    else
+    {
+        grid.clear_grid();
+        x += (grid.get_grid_width() - size.width) / 2;
+        y += (grid.get_grid_height() - size.height) / 2;
+    }
+
+    return read_pattern(file, format, grid, x, y);
+}
+
+void save_pattern(const std::string &path, const LifeGrid &grid)
+{
+    const PatternFormat format = pattern_format_from_path(path);
+    std::ofstream file{path, std::ios::binary};
+    if(!file)
+    {
+        throw std::runtime_error("Can't open " + path + " for writing");
+    }
+
+    write_pattern(file, format, grid);
+    file.flush();
+    if(!file)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
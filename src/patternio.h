@@ -0,0 +1,135 @@
+#ifndef PATTERNIO_H
+#define PATTERNIO_H
+
+#include "lifegrid.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+/*!
+ * \brief The supported pattern file formats
+ */
+enum PatternFormat : unsigned char
+{
+    /*!
+     * \brief Run Length Encoded, the usual format of the pattern collections (.rle)
+     * \details The header holds the size and the rule. The Generations states are
+     *          written with the letters A, B, ... like Golly does.
+     */
+    RLE_FORMAT,
+
+    /*!
+     * \brief Life 1.06, a list of live cell coordinates (.lif, .life)
+     */
+    LIFE_106_FORMAT,
+
+    /*!
+     * \brief Plaintext, a row of 'O' and '.' characters per grid row (.cells)
+     */
+    PLAINTEXT_FORMAT
+};
+
+/*!
+ * \brief What is known about a pattern before or after reading it
+ */
+struct PatternInfo
+{
+    /*!
+     * \brief The leftmost column of the pattern in its own coordinates
+     * \details Always 0 except for Life 1.06, which allows negative coordinates
+     */
+    int min_x{0};
+
+    /*!
+     * \brief The topmost row of the pattern in its own coordinates
+     */
+    int min_y{0};
+
+    /*!
+     * \brief The width of the pattern's bounding box
+     */
+    int width{0};
+
+    /*!
+     * \brief The height of the pattern's bounding box
+     */
+    int height{0};
+
+    /*!
+     * \brief The pattern's name, if the file has one
+     */
+    std::string name;
+
+    /*!
+     * \brief The rule given in the file, or empty if there's none
+     */
+    std::string rulestring;
+};
+
+/*!
+ * \brief Picks the format by the file extension
+ * \details Throws std::invalid_argument for unknown extensions
+ * \param path The file path
+ * \return The format of the file
+ */
+PatternFormat pattern_format_from_path(const std::string &path);
+
+/*!
+ * \brief Reads the size of a pattern without storing its cells
+ * \details RLE only needs its header. The other formats are read through once,
+ *          keeping track of the bounding box. Throws std::invalid_argument if
+ *          the pattern is malformed.
+ * \param stream The stream to read from
+ * \param format The format of the stream
+ * \return The size, name and rule of the pattern
+ */
+PatternInfo measure_pattern(std::istream &stream, PatternFormat format);
+
+/*!
+ * \brief Reads a pattern straight into the grid
+ * \details The stream is read in blocks and the cells go into the grid as they are
+ *          parsed, so there is no copy of the whole file in memory. Only the cells
+ *          that aren't dead are written, and the ones landing outside the grid are dropped.
+ *          If the file has a rule that LifeRule can parse, it is set on the grid
+ *          before the cells. Throws std::invalid_argument if the pattern is malformed.
+ * \param stream The stream to read from
+ * \param format The format of the stream
+ * \param grid The grid to read into
+ * \param x The column of the pattern's coordinate 0
+ * \param y The row of the pattern's coordinate 0
+ * \return The size, name and rule of the pattern
+ */
+PatternInfo read_pattern(std::istream &stream, PatternFormat format, LifeGrid &grid, int x=0, int y=0);
+
+/*!
+ * \brief Writes the grid as a pattern
+ * \details Life 1.06 and plaintext only hold the live cells, so the dying
+ *          states of the Generations rules are written as dead cells.
+ * \param stream The stream to write to
+ * \param format The format to write in
+ * \param grid The grid to write
+ */
+void write_pattern(std::ostream &stream, PatternFormat format, const LifeGrid &grid);
+
+/*!
+ * \brief Loads a pattern file into the grid, replacing its contents
+ * \details Throws std::runtime_error if the file can't be opened,
+ *          and std::invalid_argument if it can't be parsed.
+ * \param path The file to load. The format is picked by the extension.
+ * \param grid The grid to load into
+ * \param resize_to_fit If true, the grid is resized to the size of the pattern.
+ *        Otherwise the pattern is centred on the grid.
+ * \return The size, name and rule of the pattern
+ */
+PatternInfo load_pattern(const std::string &path, LifeGrid &grid, bool resize_to_fit);
+
+/*!
+ * \brief Saves the grid into a pattern file
+ * \details Throws std::runtime_error if the file can't be written
+ * \param path The file to write. The format is picked by the extension.
+ * \param grid The grid to save
+ */
+void save_pattern(const std::string &path, const LifeGrid &grid);
+
+#endif // PATTERNIO_H
@@ -0,0 +1,621 @@
+#include "recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+constexpr char recording_magic[8] = {'G', 'O', 'L', 'R', 'E', 'C', '\0', '\0'};
+constexpr char recording_index_magic[8] = {'G', 'O', 'L', 'R', 'I', 'D', 'X', '\0'};
+constexpr uint32_t recording_version = 1;
+constexpr uint32_t recording_byte_order_mark = 0x01020304;
+
+void put_varint(std::vector<unsigned char> &out, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+uint64_t get_varint(const unsigned char *&in, const unsigned char *end)
+{
+    uint64_t value = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        if(in == end)
+        {
+            break;
+        }
+        const unsigned char byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::invalid_argument("Corrupt frame in the recording");
+}
+
+/*
+ * Codes the frame XORed with the previous one as runs of unchanged and changed words.
+ * For the keyframes that's the frame itself, as if XORed with an empty grid.
+ */
+void encode_delta(const uint64_t *delta, size_t count, std::vector<unsigned char> &out)
+{
+    out.clear();
+    size_t i = 0;
+    while(i < count)
+    {
+        const size_t unchanged_start = i;
+        while(i < count && delta[i] == 0)
+        {
+            i++;
+        }
+        const size_t changed_start = i;
+        while(i < count && delta[i] != 0)
+        {
+            i++;
+        }
+
+        put_varint(out, changed_start - unchanged_start);
+        put_varint(out, i - changed_start);
+        const size_t size = out.size();
+        out.resize(size + (i - changed_start) * sizeof(uint64_t));
+        std::memcpy(out.data() + size, delta + changed_start, (i - changed_start) * sizeof(uint64_t));
+    }
+}
+
+void decode_delta(const std::vector<unsigned char> &in, std::vector<uint64_t> &frame)
+{
+    const unsigned char *position = in.data();
+    const unsigned char *end = in.data() + in.size();
+    size_t word = 0;
+    while(position != end)
+    {
+        const uint64_t unchanged = get_varint(position, end);
+        const uint64_t changed = get_varint(position, end);
+        if(unchanged > frame.size() - word || changed > frame.size() - word - unchanged ||
+           changed * sizeof(uint64_t) > static_cast<size_t>(end - position))
+        {
+            throw std::invalid_argument("Corrupt frame in the recording");
+        }
+
+        word += unchanged;
+        for(uint64_t i = 0; i < changed; i++)
+        {
+            uint64_t delta;
+            std::memcpy(&delta, position, sizeof(delta));
+            position += sizeof(delta);
+            frame[word++] ^= delta;
+        }
+    }
+}
+
+}
+
+Recorder::Recorder(const std::string &path, const LifeGrid &grid, int keyframe_interval, int depth) :
+    file{path, std::ios::binary | std::ios::trunc},
+    header{},
+    frame_words{0},
+    frame_count{0},
+    queue_depth{std::max(1, depth)},
+    tile_words{grid.get_tile_width() / 64},
+    tile_rows{grid.get_tile_height()},
+    tiles_x{0},
+    tiles_y{0},
+    has_recorded{false},
+    written_frames{0},
+    is_finishing{false},
+    has_failed{false},
+    is_finished{false}
+{
+    if(!file)
+    {
+        throw std::runtime_error("Can't create " + path);
+    }
+
+    const LifeRule rule = grid.get_rule();
+    std::memcpy(header.magic, recording_magic, sizeof(header.magic));
+    header.byte_order_mark = recording_byte_order_mark;
+    header.version = recording_version;
+    header.width = grid.get_grid_width();
+    header.height = grid.get_grid_height();
+    header.birth = rule.birth;
+    header.survival = rule.survival;
+    header.states = static_cast<uint16_t>(rule.states);
+    header.wrap = grid.get_wrap_grid() ? 1 : 0;
+    header.words_per_row = static_cast<uint32_t>((header.width + 63) / 64);
+    header.planes = static_cast<uint32_t>(rule.get_state_bits());
+    header.keyframe_interval = static_cast<uint32_t>(std::max(1, keyframe_interval));
+    frame_words = static_cast<size_t>(header.words_per_row) * static_cast<size_t>(header.height) * header.planes;
+    tiles_x = (static_cast<int>(header.words_per_row) + tile_words - 1) / tile_words;
+    tiles_y = (header.height + tile_rows - 1) / tile_rows;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!file)
+    {
+        throw std::runtime_error("Can't write " + path);
+    }
+
+    writer_thread = std::thread([this]()
+    {
+        writer_loop();
+    });
+}
+
+Recorder::~Recorder()
+{
+    try
+    {
+        finish();
+    }
+    catch(const std::runtime_error &)
+    {
+        // Nothing more can be done about it here
+    }
+}
+
+void Recorder::record(LifeGrid &grid)
+{
+    const LifeRule rule = grid.get_rule();
+    if(grid.get_grid_width() != header.width || grid.get_grid_height() != header.height ||
+       rule.birth != header.birth || rule.survival != header.survival || rule.states != header.states)
+    {
+        throw std::invalid_argument("The grid size or rule changed during the recording");
+    }
+
+    Frame frame;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(is_finished)
+        {
+            throw std::runtime_error("The recording is already finished");
+        }
+        if(has_failed)
+        {
+            throw std::runtime_error("Writing the recording failed");
+        }
+
+        if(!free_frames.empty())
+        {
+            frame = std::move(free_frames.back());
+            free_frames.pop_back();
+        }
+    }
+
+    // The first frame has everything, the ones after it only the tiles changed since
+    grid.collect_changed_tiles(changed_tiles, change_collector);
+    if(!has_recorded)
+    {
+        std::fill(changed_tiles.begin(), changed_tiles.end(), 1);
+        has_recorded = true;
+    }
+
+    // The copy is the only work done on the stepping thread
+    frame.generation = grid.get_generation();
+    frame.tiles.clear();
+    frame.words.clear();
+    for(uint32_t tile = 0; tile < changed_tiles.size(); tile++)
+    {
+        if(!changed_tiles[tile])
+        {
+            continue;
+        }
+
+        int first_word, last_word, first_y, last_y;
+        get_tile_bounds(tile, first_word, last_word, first_y, last_y);
+        frame.tiles.push_back(tile);
+        for(uint32_t plane = 0; plane < header.planes; plane++)
+        {
+            for(int y = first_y; y < last_y; y++)
+            {
+                const size_t size = frame.words.size();
+                frame.words.resize(size + static_cast<size_t>(last_word - first_word));
+                grid.get_row_bits(y, static_cast<int>(plane), first_word, last_word, frame.words.data() + size);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(static_cast<int>(queue.size()) < queue_depth)
+        {
+            queue.push_back(std::move(frame));
+            frame_count++;
+        }
+        else
+        {
+            /*
+             * The writer is more than queue_depth frames behind. Instead of waiting for it,
+             * the changes go into the newest frame, and the generation it had is skipped.
+             * The writer doesn't touch the frames still in the queue.
+             */
+            Frame &newest = queue.back();
+            newest.generation = frame.generation;
+            newest.tiles.insert(newest.tiles.end(), frame.tiles.begin(), frame.tiles.end());
+            newest.words.insert(newest.words.end(), frame.words.begin(), frame.words.end());
+            if(newest.tiles.size() > changed_tiles.size())
+            {
+                compact_frame(newest);
+            }
+            free_frames.push_back(std::move(frame));
+        }
+    }
+    frame_queued.notify_one();
+}
+
+void Recorder::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(is_finished)
+        {
+            return;
+        }
+        is_finished = true;
+        is_finishing = true;
+    }
+    frame_queued.notify_one();
+    writer_thread.join();
+
+    if(!has_failed)
+    {
+        // The keyframe index lets the player seek without reading all the frames
+        RecordingTrailer trailer{};
+        trailer.index_offset = static_cast<uint64_t>(file.tellp());
+        trailer.keyframe_count = keyframe_offsets.size();
+        trailer.frame_count = frame_count;
+        std::memcpy(trailer.magic, recording_index_magic, sizeof(trailer.magic));
+
+        file.write(reinterpret_cast<const char*>(keyframe_offsets.data()), static_cast<std::streamsize>(keyframe_offsets.size() * sizeof(uint64_t)));
+        file.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+        file.flush();
+        has_failed = !file;
+    }
+    file.close();
+
+    if(has_failed)
+    {
+        throw std::runtime_error("Writing the recording failed");
+    }
+}
+
+uint64_t Recorder::get_frame_count() const
+{
+    return frame_count;
+}
+
+void Recorder::get_tile_bounds(uint32_t tile, int &first_word, int &last_word, int &first_y, int &last_y) const
+{
+    const int tile_x = static_cast<int>(tile % static_cast<uint32_t>(tiles_x));
+    const int tile_y = static_cast<int>(tile / static_cast<uint32_t>(tiles_x));
+    first_word = tile_x * tile_words;
+    last_word = std::min(static_cast<int>(header.words_per_row), first_word + tile_words);
+    first_y = tile_y * tile_rows;
+    last_y = std::min(header.height, first_y + tile_rows);
+}
+
+void Recorder::compact_frame(Frame &frame) const
+{
+    // Where the words of every copy start
+    std::vector<size_t> offsets(frame.tiles.size() + 1, 0);
+    for(size_t copy = 0; copy < frame.tiles.size(); copy++)
+    {
+        int first_word, last_word, first_y, last_y;
+        get_tile_bounds(frame.tiles[copy], first_word, last_word, first_y, last_y);
+        offsets[copy + 1] = offsets[copy] + static_cast<size_t>(last_word - first_word) * static_cast<size_t>(last_y - first_y) * header.planes;
+    }
+
+    // Going backwards, the first copy of a tile seen is the last one made
+    std::vector<unsigned char> is_seen(static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y), 0);
+    std::vector<unsigned char> is_kept(frame.tiles.size(), 0);
+    for(size_t copy = frame.tiles.size(); copy-- > 0;)
+    {
+        is_kept[copy] = !is_seen[frame.tiles[copy]];
+        is_seen[frame.tiles[copy]] = 1;
+    }
+
+    size_t kept_tiles = 0;
+    size_t kept_words = 0;
+    for(size_t copy = 0; copy < frame.tiles.size(); copy++)
+    {
+        if(!is_kept[copy])
+        {
+            continue;
+        }
+        frame.tiles[kept_tiles++] = frame.tiles[copy];
+        std::copy(frame.words.begin() + static_cast<std::ptrdiff_t>(offsets[copy]),
+                  frame.words.begin() + static_cast<std::ptrdiff_t>(offsets[copy + 1]),
+                  frame.words.begin() + static_cast<std::ptrdiff_t>(kept_words));
+        kept_words += offsets[copy + 1] - offsets[copy];
+    }
+    frame.tiles.resize(kept_tiles);
+    frame.words.resize(kept_words);
+}
+
+void Recorder::writer_loop()
+{
+    /*
+     * The writer keeps its own copy of the grid to code the keyframes from, and the changes
+     * made to it since the last frame. Only the tiles of a frame are touched in either.
+     */
+    std::vector<uint64_t> current(frame_words, 0);
+    std::vector<uint64_t> delta(frame_words, 0);
+    const size_t plane_words = static_cast<size_t>(header.words_per_row) * static_cast<size_t>(header.height);
+
+    for(;;)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_queued.wait(lock, [&]()
+            {
+                return is_finishing || !queue.empty();
+            });
+            if(queue.empty())
+            {
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        // A tile may come more than once in a merged frame, the XORs of the copies add up
+        const uint64_t *words = frame.words.data();
+        for(uint32_t tile : frame.tiles)
+        {
+            int first_word, last_word, first_y, last_y;
+            get_tile_bounds(tile, first_word, last_word, first_y, last_y);
+            for(uint32_t plane = 0; plane < header.planes; plane++)
+            {
+                for(int y = first_y; y < last_y; y++)
+                {
+                    const size_t row = plane * plane_words + static_cast<size_t>(y) * header.words_per_row;
+                    for(int word = first_word; word < last_word; word++)
+                    {
+                        delta[row + static_cast<size_t>(word)] ^= *words ^ current[row + static_cast<size_t>(word)];
+                        current[row + static_cast<size_t>(word)] = *words++;
+                    }
+                }
+            }
+        }
+
+        write_frame(frame.generation, current, delta);
+        const bool failed = !file;
+
+        for(uint32_t tile : frame.tiles)
+        {
+            int first_word, last_word, first_y, last_y;
+            get_tile_bounds(tile, first_word, last_word, first_y, last_y);
+            for(uint32_t plane = 0; plane < header.planes; plane++)
+            {
+                for(int y = first_y; y < last_y; y++)
+                {
+                    const size_t row = plane * plane_words + static_cast<size_t>(y) * header.words_per_row;
+                    std::fill(delta.begin() + static_cast<std::ptrdiff_t>(row + static_cast<size_t>(first_word)),
+                              delta.begin() + static_cast<std::ptrdiff_t>(row + static_cast<size_t>(last_word)), 0);
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_frames.push_back(std::move(frame));
+            has_failed = failed;
+        }
+
+        if(failed)
+        {
+            return;
+        }
+    }
+}
+
+void Recorder::write_frame(uint64_t generation, const std::vector<uint64_t> &current, const std::vector<uint64_t> &delta)
+{
+    RecordingFrameHeader frame_header{};
+    frame_header.generation = generation;
+    frame_header.keyframe = written_frames % header.keyframe_interval == 0 ? 1 : 0;
+
+    if(frame_header.keyframe)
+    {
+        keyframe_offsets.push_back(static_cast<uint64_t>(file.tellp()));
+        encode_delta(current.data(), frame_words, payload);
+    }
+    else
+    {
+        encode_delta(delta.data(), frame_words, payload);
+    }
+    frame_header.payload_bytes = payload.size();
+
+    file.write(reinterpret_cast<const char*>(&frame_header), sizeof(frame_header));
+    file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    written_frames++;
+}
+
+RecordingPlayer::RecordingPlayer(const std::string &path) :
+    file{path, std::ios::binary},
+    header{},
+    frame_words{0},
+    frame_count{0},
+    next_frame{0},
+    generation{0}
+{
+    if(!file)
+    {
+        throw std::runtime_error("Can't open " + path);
+    }
+
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, recording_magic, sizeof(header.magic)) != 0)
+    {
+        throw std::invalid_argument("Not a recording: " + path);
+    }
+    if(header.byte_order_mark != recording_byte_order_mark)
+    {
+        throw std::invalid_argument("The recording was made on a machine of another byte order: " + path);
+    }
+    if(header.version != recording_version)
+    {
+        throw std::invalid_argument("Unsupported recording version " + std::to_string(header.version) + ": " + path);
+    }
+
+    const LifeRule rule{header.birth, header.survival, header.states};
+    if(header.width < 1 || header.height < 1 || header.keyframe_interval < 1 ||
+       header.words_per_row != static_cast<uint32_t>((header.width + 63) / 64) ||
+       header.states < 2 || header.states > 256 ||
+       header.planes != static_cast<uint32_t>(rule.get_state_bits()))
+    {
+        throw std::invalid_argument("Corrupt recording header: " + path);
+    }
+    frame_words = static_cast<size_t>(header.words_per_row) * static_cast<size_t>(header.height) * header.planes;
+    current.assign(frame_words, 0);
+
+    const uint64_t frames_start = sizeof(header);
+    file.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+
+    // A finished recording ends with the keyframe index
+    RecordingTrailer trailer{};
+    bool has_index = false;
+    if(file_size >= frames_start + sizeof(trailer))
+    {
+        file.seekg(static_cast<std::streamoff>(file_size - sizeof(trailer)));
+        file.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+        has_index = file && std::memcmp(trailer.magic, recording_index_magic, sizeof(trailer.magic)) == 0 &&
+                    trailer.index_offset >= frames_start &&
+                    trailer.keyframe_count == (trailer.frame_count + header.keyframe_interval - 1) / header.keyframe_interval &&
+                    trailer.index_offset + trailer.keyframe_count * sizeof(uint64_t) + sizeof(trailer) == file_size;
+    }
+
+    if(has_index)
+    {
+        keyframe_offsets.resize(trailer.keyframe_count);
+        file.seekg(static_cast<std::streamoff>(trailer.index_offset));
+        file.read(reinterpret_cast<char*>(keyframe_offsets.data()), static_cast<std::streamsize>(keyframe_offsets.size() * sizeof(uint64_t)));
+        frame_count = trailer.frame_count;
+    }
+    else
+    {
+        // Cut short, so walk through the frame headers up to the last whole frame
+        uint64_t offset = frames_start;
+        RecordingFrameHeader frame_header{};
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        while(offset + sizeof(frame_header) <= file_size &&
+              file.read(reinterpret_cast<char*>(&frame_header), sizeof(frame_header)) &&
+              frame_header.payload_bytes <= file_size - offset - sizeof(frame_header))
+        {
+            if(frame_count % header.keyframe_interval == 0)
+            {
+                keyframe_offsets.push_back(offset);
+            }
+            frame_count++;
+            offset += sizeof(frame_header) + frame_header.payload_bytes;
+            file.seekg(static_cast<std::streamoff>(offset));
+        }
+    }
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(frames_start));
+}
+
+uint64_t RecordingPlayer::get_frame_count() const
+{
+    return frame_count;
+}
+
+uint64_t RecordingPlayer::get_generation() const
+{
+    return generation;
+}
+
+void RecordingPlayer::seek(uint64_t frame)
+{
+    if(frame >= frame_count)
+    {
+        throw std::out_of_range("No frame " + std::to_string(frame) + " in the recording");
+    }
+
+    // Nothing to skip if the frame is just ahead of the current one
+    if(frame < next_frame || frame - next_frame > header.keyframe_interval)
+    {
+        const uint64_t keyframe = frame / header.keyframe_interval;
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(keyframe_offsets[keyframe]));
+        next_frame = keyframe * header.keyframe_interval;
+    }
+
+    while(next_frame < frame)
+    {
+        decode_next_frame();
+    }
+}
+
+bool RecordingPlayer::read_frame(LifeGrid &grid)
+{
+    if(!decode_next_frame())
+    {
+        return false;
+    }
+
+    const LifeRule rule{header.birth, header.survival, header.states};
+    if(grid.get_grid_width() != header.width || grid.get_grid_height() != header.height)
+    {
+        grid.set_rule(rule);
+        grid.resize_grid(header.width, header.height);
+    }
+    else if(grid.get_rule() != rule)
+    {
+        grid.set_rule(rule);
+    }
+    grid.set_wrap_grid(header.wrap != 0);
+
+    const size_t plane_words = static_cast<size_t>(header.words_per_row) * static_cast<size_t>(header.height);
+    for(uint32_t plane = 0; plane < header.planes; plane++)
+    {
+        grid.set_plane_bits(static_cast<int>(plane), current.data() + plane * plane_words);
+    }
+    grid.set_generation(generation);
+    return true;
+}
+
+bool RecordingPlayer::decode_next_frame()
+{
+    if(next_frame >= frame_count)
+    {
+        return false;
+    }
+
+    RecordingFrameHeader frame_header{};
+    if(!file.read(reinterpret_cast<char*>(&frame_header), sizeof(frame_header)))
+    {
+        throw std::invalid_argument("Truncated recording");
+    }
+
+    // Even a frame of nothing but changed words codes in less
+    if(frame_header.payload_bytes > frame_words * (sizeof(uint64_t) + 20) + 20)
+    {
+        throw std::invalid_argument("Corrupt frame in the recording");
+    }
+    payload.resize(frame_header.payload_bytes);
+    if(!file.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size())))
+    {
+        throw std::invalid_argument("Truncated recording");
+    }
+
+    if(frame_header.keyframe)
+    {
+        std::fill(current.begin(), current.end(), 0);
+    }
+    decode_delta(payload, current);
+
+    generation = frame_header.generation;
+    next_frame++;
+    return true;
+}
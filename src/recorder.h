@@ -0,0 +1,305 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "lifegrid.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief The header at the start of a recording
+ * \details The header is followed by the frames, each a RecordingFrameHeader and its
+ *          payload, and after the last frame by the keyframe index and a RecordingTrailer.
+ *          A frame holds the bits of the grid like a snapshot does: every bit plane
+ *          in turn, and in a plane every row as words_per_row 64-bit words. The numbers
+ *          are in the byte order of the machine, checked through byte_order_mark.
+ */
+struct RecordingHeader
+{
+    /*!
+     * \brief Always "GOLREC\0\0"
+     */
+    char magic[8];
+    uint32_t byte_order_mark;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint16_t birth;
+    uint16_t survival;
+    uint16_t states;
+    uint16_t wrap;
+    uint32_t words_per_row;
+    uint32_t planes;
+
+    /*!
+     * \brief Every Nth frame is a keyframe, starting from the first one
+     */
+    uint32_t keyframe_interval;
+    uint32_t reserved;
+};
+
+/*!
+ * \brief The header of a recorded frame
+ * \details The payload is the frame XORed with the previous one, or with an empty grid
+ *          for the keyframes. It's coded as pairs of varints: the amount of unchanged
+ *          words to skip, and the amount of changed words following the pair.
+ */
+struct RecordingFrameHeader
+{
+    uint64_t generation;
+    uint32_t keyframe;
+    uint32_t reserved;
+    uint64_t payload_bytes;
+};
+
+/*!
+ * \brief The end of a finished recording
+ * \details Points to the keyframe index, a list of file offsets. A recording cut short
+ *          has no trailer, and RecordingPlayer finds its frames by walking through them.
+ */
+struct RecordingTrailer
+{
+    uint64_t index_offset;
+    uint64_t keyframe_count;
+    uint64_t frame_count;
+
+    /*!
+     * \brief Always "GOLRIDX\0"
+     */
+    char magic[8];
+};
+
+/*!
+ * \brief Records every generation of a grid into a file
+ * \details record() only copies the tiles changed since the last frame, and queues them.
+ *          A background thread applies them to its copy of the grid, computes the delta
+ *          against the previous frame, compresses the runs of unchanged words and writes
+ *          the result, so the stepping loop doesn't wait for the disk. If the writer falls
+ *          behind by more than queue_depth frames, record() adds the changes to the newest
+ *          queued frame instead, leaving the generation that frame had out of the recording.
+ */
+class Recorder
+{
+  public:
+    /*!
+     * \brief Creates the file and starts the writer thread
+     * \details Throws std::runtime_error if the file can't be created
+     * \param path The file to record into
+     * \param grid The grid to be recorded. Its size and rule can't change during the recording.
+     * \param keyframe_interval Every Nth frame is stored whole, for seeking
+     * \param queue_depth The amount of frames waiting for the writer at most
+     */
+    Recorder(const std::string &path, const LifeGrid &grid, int keyframe_interval=100, int queue_depth=4);
+
+    /*!
+     * \brief Finishes the recording
+     */
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    /*!
+     * \brief Queues the current state of the grid as the next frame
+     * \details Throws std::invalid_argument if the size or the rule of the grid has
+     *          changed, and std::runtime_error if the writer has failed
+     * \param grid The recorded grid. Its changed tiles are collected as change_collector.
+     */
+    void record(LifeGrid &grid);
+
+    /*!
+     * \brief Writes the queued frames and the keyframe index, and closes the file
+     * \details Called by the destructor as well. Throws std::runtime_error if writing failed.
+     */
+    void finish();
+
+    /*!
+     * \brief Grab the amount of recorded frames
+     * \return The frames queued so far
+     */
+    uint64_t get_frame_count() const;
+
+    /*!
+     * \brief The collector of LifeGrid::collect_changed_tiles() used by the recorders
+     * \details So a grid is recorded by a single recorder at a time
+     */
+    static constexpr int change_collector = 1;
+
+  private:
+    /*!
+     * \brief The changed tiles of a generation, waiting for the writer
+     */
+    struct Frame
+    {
+        uint64_t generation;
+
+        /*!
+         * \brief The changed tiles, a tile row after another. The same tile may come again later.
+         */
+        std::vector<uint32_t> tiles;
+
+        /*!
+         * \brief The words of the tiles in turn. In a tile every plane, and in a plane every row.
+         */
+        std::vector<uint64_t> words;
+    };
+
+    /*!
+     * \brief Calculates the part of the grid a tile covers
+     * \param tile The tile
+     * \param first_word The first word of the rows
+     * \param last_word One past the last word of the rows
+     * \param first_y The first row
+     * \param last_y One past the last row
+     */
+    void get_tile_bounds(uint32_t tile, int &first_word, int &last_word, int &first_y, int &last_y) const;
+
+    /*!
+     * \brief Keeps only the last copy of every tile in a frame
+     * \details Keeps a frame merged into over and over from growing past the grid
+     * \param frame The frame to compact
+     */
+    void compact_frame(Frame &frame) const;
+
+    /*!
+     * \brief The loop of the writer thread
+     */
+    void writer_loop();
+
+    /*!
+     * \brief Codes and writes a frame
+     * \param generation The generation of the frame
+     * \param current The whole frame
+     * \param delta The frame XORed with the previous one
+     */
+    void write_frame(uint64_t generation, const std::vector<uint64_t> &current, const std::vector<uint64_t> &delta);
+
+    std::ofstream file;
+    RecordingHeader header;
+    size_t frame_words;
+    uint64_t frame_count;
+    int queue_depth;
+
+    /*!
+     * \brief The tiles of the recorded grid, in words and rows
+     */
+    int tile_words;
+    int tile_rows;
+    int tiles_x;
+    int tiles_y;
+
+    /*!
+     * \brief The changed tiles collected by record(), reused between the frames
+     */
+    std::vector<unsigned char> changed_tiles;
+
+    /*!
+     * \brief Has record() been called? The first frame gets all of the tiles.
+     */
+    bool has_recorded;
+
+    /*!
+     * \brief The frames written so far, kept by the writer thread
+     */
+    uint64_t written_frames;
+
+    /*!
+     * \brief The file offsets of the keyframes, kept by the writer thread
+     */
+    std::vector<uint64_t> keyframe_offsets;
+
+    /*!
+     * \brief The coded payload of the frame being written, reused between the frames
+     */
+    std::vector<unsigned char> payload;
+
+    /*!
+     * \brief Guards the fields below, along with the condition variables
+     */
+    std::mutex mutex;
+    std::condition_variable frame_queued;
+    std::deque<Frame> queue;
+
+    /*!
+     * \brief The frames already written, reused by record()
+     */
+    std::vector<Frame> free_frames;
+    bool is_finishing;
+    bool has_failed;
+    bool is_finished;
+
+    std::thread writer_thread;
+};
+
+/*!
+ * \brief Plays back a recording
+ */
+class RecordingPlayer
+{
+  public:
+    /*!
+     * \brief Opens the recording and reads its keyframe index
+     * \details Throws std::runtime_error if the file can't be read,
+     *          and std::invalid_argument if it isn't a valid recording.
+     * \param path The recording to play
+     */
+    explicit RecordingPlayer(const std::string &path);
+
+    /*!
+     * \brief Grab the amount of frames
+     * \return The frames in the recording
+     */
+    uint64_t get_frame_count() const;
+
+    /*!
+     * \brief Moves to a frame
+     * \details Decodes from the closest keyframe at or before the frame.
+     *          Throws std::out_of_range if there's no such frame.
+     * \param frame The frame read next by read_frame(), 0 being the first
+     */
+    void seek(uint64_t frame);
+
+    /*!
+     * \brief Reads the next frame into the grid
+     * \details The grid is resized and its rule and wrapping set to the recorded ones.
+     *          Throws std::invalid_argument if the frame is corrupt.
+     * \param grid The grid to read into
+     * \return False if there are no more frames
+     */
+    bool read_frame(LifeGrid &grid);
+
+    /*!
+     * \brief Grab the generation of the frame last read
+     * \return The generation count of the recorded grid
+     */
+    uint64_t get_generation() const;
+
+  private:
+    /*!
+     * \brief Decodes the next frame into the current one
+     * \return False if there are no more frames
+     */
+    bool decode_next_frame();
+
+    std::ifstream file;
+    RecordingHeader header;
+    size_t frame_words;
+    uint64_t frame_count;
+    std::vector<uint64_t> keyframe_offsets;
+
+    /*!
+     * \brief The frame next read by decode_next_frame()
+     */
+    uint64_t next_frame;
+    uint64_t generation;
+    std::vector<uint64_t> current;
+    std::vector<unsigned char> payload;
+};
+
+#endif // RECORDER_H
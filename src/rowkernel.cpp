@@ -0,0 +1,576 @@
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ROW_KERNEL_X86
+
+// The vector helpers are always inlined into the matching target, so their ABI never matters
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+#include "rowkernel.h"
+#include "wordkernel.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Declares the builtins of the wider instruction sets, used by NibbleBitCount
+#ifdef ROW_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * The wide kernels are written with the GCC vector extensions. The compiler turns
+ * the bitwise operators into SSE2, AVX2 or AVX-512 instructions depending on
+ * the target attribute of the function the template gets inlined into.
+ */
+#ifdef ROW_KERNEL_X86
+typedef uint64_t Words128 __attribute__((vector_size(16)));
+typedef uint64_t Words256 __attribute__((vector_size(32)));
+typedef uint64_t Words512 __attribute__((vector_size(64)));
+#endif
+
+/*
+ * Loads the centre words and the words shifted by one cell to both directions.
+ * The words before and after `source` must be readable.
+ */
+template<typename WORDS>
+static WORD_KERNEL_INLINE void load_shifted_words(const uint64_t *source, WORDS &west, WORDS &centre, WORDS &east)
+{
+    WORDS previous;
+    WORDS next;
+    std::memcpy(&previous, source - 1, sizeof(WORDS));
+    std::memcpy(&centre,   source,     sizeof(WORDS));
+    std::memcpy(&next,     source + 1, sizeof(WORDS));
+
+    west = (centre << 1) | (previous >> 63);
+    east = (centre >> 1) | (next << 63);
+}
+
+/*
+ * The rules the kernels are instantiated for. Conway's rule has the shortest adder tree,
+ * the fixed rules have their masks as compile time constants, and AnyRule reads
+ * the masks at run time.
+ */
+struct ConwayRule
+{
+    template<typename WORDS>
+    static WORD_KERNEL_INLINE WORDS apply(const LifeRule &, const WORDS &nw, const WORDS &n, const WORDS &ne, const WORDS &w, const WORDS &c, const WORDS &e, const WORDS &sw, const WORDS &s, const WORDS &se)
+    {
+        return compute_words(nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+template<uint16_t BIRTH, uint16_t SURVIVAL>
+struct FixedRule
+{
+    template<typename WORDS>
+    static WORD_KERNEL_INLINE WORDS apply(const LifeRule &, const WORDS &nw, const WORDS &n, const WORDS &ne, const WORDS &w, const WORDS &c, const WORDS &e, const WORDS &sw, const WORDS &s, const WORDS &se)
+    {
+        return compute_words_rule(BIRTH, SURVIVAL, nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+struct AnyRule
+{
+    template<typename WORDS>
+    static WORD_KERNEL_INLINE WORDS apply(const LifeRule &rule, const WORDS &nw, const WORDS &n, const WORDS &ne, const WORDS &w, const WORDS &c, const WORDS &e, const WORDS &sw, const WORDS &s, const WORDS &se)
+    {
+        return compute_words_rule(rule.birth, rule.survival, nw, n, ne, w, c, e, sw, s, se);
+    }
+};
+
+/*
+ * The ways of counting the set bits of every word, for the births and deaths.
+ * SwarBitCount gets by with the plain bitwise operators and works with every target.
+ * The others need an instruction set of their own in the target of the kernel.
+ */
+struct SwarBitCount
+{
+    template<typename WORDS>
+    static WORD_KERNEL_INLINE WORDS apply(const WORDS &words)
+    {
+        return count_word_bits(words);
+    }
+};
+
+#ifdef ROW_KERNEL_X86
+/*
+ * Looks up the counts of the nibbles with a byte shuffle and sums the bytes of every word. Needs AVX2.
+ */
+struct NibbleBitCount
+{
+    typedef char Bytes256 __attribute__((vector_size(32)));
+
+    static WORD_KERNEL_INLINE Words256 apply(const Words256 &words)
+    {
+        const Bytes256 nibble_counts = {
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+        };
+        const Bytes256 low  = reinterpret_cast<Bytes256>(words & 0x0f0f0f0f0f0f0f0f);
+        const Bytes256 high = reinterpret_cast<Bytes256>((words >> 4) & 0x0f0f0f0f0f0f0f0f);
+        const Bytes256 counts = __builtin_ia32_pshufb256(nibble_counts, low) + __builtin_ia32_pshufb256(nibble_counts, high);
+        return reinterpret_cast<Words256>(__builtin_ia32_psadbw256(counts, Bytes256{}));
+    }
+};
+
+/*
+ * Counts a single word with the popcnt instruction. Needs POPCNT, which every CPU with AVX2 has.
+ */
+struct PopcntBitCount
+{
+    static WORD_KERNEL_INLINE uint64_t apply(const uint64_t &word)
+    {
+        return static_cast<uint64_t>(__builtin_popcountll(word));
+    }
+};
+
+/*
+ * Counts every word on its own. Vectorized into a single instruction with AVX512_VPOPCNTDQ.
+ */
+struct LaneBitCount
+{
+    template<typename WORDS>
+    static WORD_KERNEL_INLINE WORDS apply(const WORDS &words)
+    {
+        WORDS counts = words;
+        for(size_t lane = 0; lane < sizeof(WORDS) / sizeof(uint64_t); lane++)
+        {
+            counts[lane] = static_cast<uint64_t>(__builtin_popcountll(words[lane]));
+        }
+        return counts;
+    }
+};
+#endif
+
+/*
+ * Adds the cells born and died in the words to their tallies, the births to the low and the deaths to the high half.
+ * A row adds at most 64 of either to a word, so the halves never overflow into each other.
+ */
+template<typename BITCOUNT, typename WORDS>
+static WORD_KERNEL_INLINE void tally_word_changes(const WORDS &before, const WORDS &after, uint64_t *tallies)
+{
+    WORDS tally;
+    std::memcpy(&tally, tallies, sizeof(WORDS));
+    tally += BITCOUNT::apply(after & ~before) | (BITCOUNT::apply(before & ~after) << 32);
+    std::memcpy(tallies, &tally, sizeof(WORDS));
+}
+
+/*
+ * Steps the words [first, last) of a row, as many as fit into WORDS at a time.
+ * Both first-1 and last must be valid word indices.
+ * If tallies isn't null, the cells born and died in every word are added to it, see tally_word_changes().
+ *
+ * Returns the first word that was left unprocessed.
+ */
+template<typename WORDS, typename RULE, typename BITCOUNT>
+static WORD_KERNEL_INLINE int step_inner_words(
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    uint64_t *tallies,
+    int first,
+    int last
+)
+{
+    constexpr int lanes = sizeof(WORDS) / sizeof(uint64_t);
+
+    int word = first;
+    for(; word + lanes <= last; word += lanes)
+    {
+        WORDS nw, n, ne;
+        WORDS w,  c, e;
+        WORDS sw, s, se;
+        load_shifted_words(above + word, nw, n, ne);
+        load_shifted_words(row   + word, w,  c, e);
+        load_shifted_words(below + word, sw, s, se);
+
+        const WORDS result = RULE::apply(rule, nw, n, ne, w, c, e, sw, s, se);
+        std::memcpy(next + word, &result, sizeof(WORDS));
+
+        if(tallies)
+        {
+            tally_word_changes<BITCOUNT>(c, result, tallies + word);
+        }
+    }
+    return word;
+}
+
+typedef int (*InnerWordStepper)(const LifeRule &, const uint64_t *, const uint64_t *, const uint64_t *, uint64_t *, uint64_t *, int, int);
+
+template<typename RULE>
+static int step_inner_scalar(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, uint64_t *tallies, int first, int last)
+{
+    return step_inner_words<uint64_t, RULE, SwarBitCount>(rule, above, row, below, next, tallies, first, last);
+}
+
+#ifdef ROW_KERNEL_X86
+template<typename RULE>
+__attribute__((target("sse2")))
+static int step_inner_sse2(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, uint64_t *tallies, int first, int last)
+{
+    return step_inner_words<Words128, RULE, SwarBitCount>(rule, above, row, below, next, tallies, first, last);
+}
+
+/*
+ * The wider kernels step the words left over from their vectors with narrower ones, and the last
+ * few a word at a time. The single words are counted with popcnt instead of the SWAR count of the
+ * scalar kernel, which keeps the tallies from showing up in the stepping time.
+ */
+template<typename RULE>
+__attribute__((target("avx2,popcnt")))
+static int step_inner_avx2(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, uint64_t *tallies, int first, int last)
+{
+    const int word = step_inner_words<Words256, RULE, NibbleBitCount>(rule, above, row, below, next, tallies, first, last);
+    return step_inner_words<uint64_t, RULE, PopcntBitCount>(rule, above, row, below, next, tallies, word, last);
+}
+
+template<typename RULE>
+__attribute__((target("avx512f,avx2,popcnt")))
+static int step_inner_avx512(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, uint64_t *tallies, int first, int last)
+{
+    int word = step_inner_words<Words512, RULE, SwarBitCount>(rule, above, row, below, next, tallies, first, last);
+    word = step_inner_words<Words256, RULE, NibbleBitCount>(rule, above, row, below, next, tallies, word, last);
+    return step_inner_words<uint64_t, RULE, PopcntBitCount>(rule, above, row, below, next, tallies, word, last);
+}
+
+template<typename RULE>
+__attribute__((target("avx512f,avx512vpopcntdq,avx2,popcnt")))
+static int step_inner_avx512_popcount(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, uint64_t *tallies, int first, int last)
+{
+    int word = step_inner_words<Words512, RULE, LaneBitCount>(rule, above, row, below, next, tallies, first, last);
+    word = step_inner_words<Words256, RULE, NibbleBitCount>(rule, above, row, below, next, tallies, word, last);
+    return step_inner_words<uint64_t, RULE, PopcntBitCount>(rule, above, row, below, next, tallies, word, last);
+}
+
+static bool has_vector_popcount()
+{
+    static const bool supported = __builtin_cpu_supports("avx512vpopcntdq");
+    return supported;
+}
+#endif
+
+template<typename RULE>
+static InnerWordStepper inner_word_stepper_for(RowKernel kernel)
+{
+#ifdef ROW_KERNEL_X86
+    switch(kernel)
+    {
+        case SSE2_ROW_KERNEL:
+            return step_inner_sse2<RULE>;
+        case AVX2_ROW_KERNEL:
+            return step_inner_avx2<RULE>;
+        case AVX512_ROW_KERNEL:
+            return has_vector_popcount() ? step_inner_avx512_popcount<RULE> : step_inner_avx512<RULE>;
+        default:
+            break;
+    }
+#else
+    (void)kernel;
+#endif
+    return step_inner_scalar<RULE>;
+}
+
+static InnerWordStepper inner_word_stepper(RowKernel kernel, const LifeRule &rule)
+{
+    // The common rules get kernels of their own, the rest read the masks as they go
+    if(rule == conway_rule)
+    {
+        return inner_word_stepper_for<ConwayRule>(kernel);
+    }
+    if(rule == highlife_rule)
+    {
+        return inner_word_stepper_for<FixedRule<highlife_rule.birth, highlife_rule.survival>>(kernel);
+    }
+    if(rule == day_and_night_rule)
+    {
+        return inner_word_stepper_for<FixedRule<day_and_night_rule.birth, day_and_night_rule.survival>>(kernel);
+    }
+    if(rule == seeds_rule)
+    {
+        return inner_word_stepper_for<FixedRule<seeds_rule.birth, seeds_rule.survival>>(kernel);
+    }
+    if(rule == life_without_death_rule)
+    {
+        return inner_word_stepper_for<FixedRule<life_without_death_rule.birth, life_without_death_rule.survival>>(kernel);
+    }
+    return inner_word_stepper_for<AnyRule>(kernel);
+}
+
+/*
+ * Loads the live cells of a multi-state row, the ones in state 1.
+ * The planes hold the bits of the states, plane_stride words apart.
+ */
+template<typename WORDS>
+static WORD_KERNEL_INLINE WORDS load_alive_words(const uint64_t *source, size_t plane_stride, int planes)
+{
+    WORDS alive;
+    std::memcpy(&alive, source, sizeof(WORDS));
+    for(int plane = 1; plane < planes; plane++)
+    {
+        WORDS bits;
+        std::memcpy(&bits, source + plane_stride * static_cast<size_t>(plane), sizeof(WORDS));
+        alive &= ~bits;
+    }
+    return alive;
+}
+
+template<typename WORDS>
+static WORD_KERNEL_INLINE void load_shifted_alive_words(const uint64_t *source, size_t plane_stride, int planes, WORDS &west, WORDS &centre, WORDS &east)
+{
+    const WORDS previous = load_alive_words<WORDS>(source - 1, plane_stride, planes);
+    const WORDS next     = load_alive_words<WORDS>(source + 1, plane_stride, planes);
+    centre = load_alive_words<WORDS>(source, plane_stride, planes);
+
+    west = (centre << 1) | (previous >> 63);
+    east = (centre >> 1) | (next << 63);
+}
+
+/*
+ * Steps the words [first, last) of a multi-state row with a Generations rule.
+ * The states are added to with a bit-sliced ripple carry, so every plane
+ * is stepped with the same bitwise operations as the Life-like rules.
+ *
+ * Returns the first word that was left unprocessed.
+ */
+template<typename WORDS>
+static WORD_KERNEL_INLINE int step_generations_words(
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    size_t plane_stride,
+    int first,
+    int last
+)
+{
+    constexpr int lanes = sizeof(WORDS) / sizeof(uint64_t);
+    const int planes = rule.get_state_bits();
+    const int last_state = rule.states - 1;
+
+    int word = first;
+    for(; word + lanes <= last; word += lanes)
+    {
+        WORDS nw, n, ne;
+        WORDS w,  c, e;
+        WORDS sw, s, se;
+        load_shifted_alive_words(above + word, plane_stride, planes, nw, n, ne);
+        load_shifted_alive_words(row   + word, plane_stride, planes, w,  c, e);
+        load_shifted_alive_words(below + word, plane_stride, planes, sw, s, se);
+
+        // Alive in the next generation, if the cell is either dead or alive now
+        const WORDS rule_result = compute_words_rule(rule.birth, rule.survival, nw, n, ne, w, c, e, sw, s, se);
+
+        WORDS is_nonzero = c ^ c;
+        WORDS is_last    = ~is_nonzero;
+        for(int plane = 0; plane < planes; plane++)
+        {
+            WORDS bits;
+            std::memcpy(&bits, row + word + plane_stride * static_cast<size_t>(plane), sizeof(WORDS));
+            is_nonzero |= bits;
+            is_last &= ((last_state >> plane) & 1) ? bits : ~bits;
+        }
+
+        const WORDS survives = rule_result & c;
+        const WORDS is_born  = rule_result & ~is_nonzero;
+
+        // The live cells that didn't survive and the dying cells move to the next state, the last one dies
+        const WORDS moves_on = is_nonzero & ~survives & ~is_last;
+
+        WORDS carry = ~(c ^ c);
+        for(int plane = 0; plane < planes; plane++)
+        {
+            const size_t offset = static_cast<size_t>(word) + plane_stride * static_cast<size_t>(plane);
+
+            WORDS bits;
+            std::memcpy(&bits, row + offset, sizeof(WORDS));
+
+            WORDS result = moves_on & (bits ^ carry);
+            carry &= bits;
+
+            // State 1, either staying alive or being born
+            if(plane == 0)
+            {
+                result |= survives | is_born;
+            }
+            std::memcpy(next + offset, &result, sizeof(WORDS));
+        }
+    }
+    return word;
+}
+
+typedef int (*GenerationsStepper)(const LifeRule &, const uint64_t *, const uint64_t *, const uint64_t *, uint64_t *, size_t, int, int);
+
+static int step_generations_scalar(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, size_t plane_stride, int first, int last)
+{
+    return step_generations_words<uint64_t>(rule, above, row, below, next, plane_stride, first, last);
+}
+
+#ifdef ROW_KERNEL_X86
+__attribute__((target("sse2")))
+static int step_generations_sse2(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, size_t plane_stride, int first, int last)
+{
+    return step_generations_words<Words128>(rule, above, row, below, next, plane_stride, first, last);
+}
+
+__attribute__((target("avx2")))
+static int step_generations_avx2(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, size_t plane_stride, int first, int last)
+{
+    return step_generations_words<Words256>(rule, above, row, below, next, plane_stride, first, last);
+}
+
+__attribute__((target("avx512f")))
+static int step_generations_avx512(const LifeRule &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *next, size_t plane_stride, int first, int last)
+{
+    return step_generations_words<Words512>(rule, above, row, below, next, plane_stride, first, last);
+}
+#endif
+
+static GenerationsStepper generations_stepper(RowKernel kernel)
+{
+#ifdef ROW_KERNEL_X86
+    switch(kernel)
+    {
+        case SSE2_ROW_KERNEL:
+            return step_generations_sse2;
+        case AVX2_ROW_KERNEL:
+            return step_generations_avx2;
+        case AVX512_ROW_KERNEL:
+            return step_generations_avx512;
+        default:
+            break;
+    }
+#else
+    (void)kernel;
+#endif
+    return step_generations_scalar;
+}
+
+bool is_row_kernel_supported(RowKernel kernel)
+{
+    switch(kernel)
+    {
+        case SCALAR_ROW_KERNEL:
+            return true;
+#ifdef ROW_KERNEL_X86
+        case SSE2_ROW_KERNEL:
+            return __builtin_cpu_supports("sse2");
+        case AVX2_ROW_KERNEL:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+        case AVX512_ROW_KERNEL:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("popcnt");
+#endif
+        default:
+            return false;
+    }
+}
+
+RowKernel best_row_kernel()
+{
+    // The CPU isn't going to change, so probe it only once
+    static const RowKernel best = []()
+    {
+        for(RowKernel kernel : {AVX512_ROW_KERNEL, AVX2_ROW_KERNEL, SSE2_ROW_KERNEL})
+        {
+            if(is_row_kernel_supported(kernel))
+            {
+                return kernel;
+            }
+        }
+        return SCALAR_ROW_KERNEL;
+    }();
+
+    return best;
+}
+
+void step_packed_row(
+    RowKernel kernel,
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    int width
+)
+{
+    step_packed_words(kernel, rule, above, row, below, next, nullptr, width, 0, (width + 63) / 64);
+}
+
+void step_packed_words(
+    RowKernel kernel,
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    uint64_t *tallies,
+    int width,
+    int first_word,
+    int last_word
+)
+{
+    const int words_per_row = (width + 63) / 64;
+    if(first_word >= last_word)
+    {
+        return;
+    }
+
+    const InnerWordStepper step_scalar = inner_word_stepper(SCALAR_ROW_KERNEL, rule);
+
+    /*
+     * The ghost words on both sides of the rows hold the neighbours from across the
+     * edges, so every word is stepped the same way. Only the last word is left
+     * for later, the ghost cell in its padding bits has to be dropped.
+     */
+    const bool has_last_word = last_word == words_per_row;
+    const int inner_last = has_last_word ? last_word - 1 : last_word;
+    if(first_word < inner_last)
+    {
+        const int word = inner_word_stepper(kernel, rule)(rule, above, row, below, next, tallies, first_word, inner_last);
+        step_scalar(rule, above, row, below, next, tallies, word, inner_last);
+    }
+
+    if(has_last_word)
+    {
+        const int word = words_per_row - 1;
+        const int last_bits = width % 64;
+        const uint64_t mask = last_bits ? (uint64_t{1} << last_bits) - 1 : ~uint64_t{0};
+
+        step_scalar(rule, above, row, below, next, nullptr, word, words_per_row);
+
+        // Keep the bits past the width zeroed
+        next[word] &= mask;
+        if(tallies)
+        {
+            tally_word_changes<SwarBitCount, uint64_t>(row[word] & mask, next[word], tallies + word);
+        }
+    }
+}
+
+void step_packed_generations_row(
+    RowKernel kernel,
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    size_t plane_stride,
+    int width
+)
+{
+    const int words_per_row = (width + 63) / 64;
+
+    // Like in step_packed_words(), the last word is left for later
+    const int word = generations_stepper(kernel)(rule, above, row, below, next, plane_stride, 0, words_per_row - 1);
+    step_generations_scalar(rule, above, row, below, next, plane_stride, word, words_per_row);
+
+    const int last_bits = width % 64;
+    if(last_bits)
+    {
+        for(int plane = 0; plane < rule.get_state_bits(); plane++)
+        {
+            next[plane_stride * static_cast<size_t>(plane) + static_cast<size_t>(words_per_row - 1)] &= (uint64_t{1} << last_bits) - 1;
+        }
+    }
+}
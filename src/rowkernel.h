@@ -0,0 +1,129 @@
+#ifndef ROWKERNEL_H
+#define ROWKERNEL_H
+
+#include "liferule.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \brief The instruction sets a packed row can be stepped with
+ * \details Each one steps the inner words of a row with the same bit-sliced rules
+ *          as WordKernel, only with wider registers.
+ */
+enum RowKernel : unsigned char
+{
+    /*!
+     * One word, 64 cells, at a time. The reference for the others.
+     */
+    SCALAR_ROW_KERNEL,
+
+    /*!
+     * Two words, 128 cells, at a time. Available on every x86-64 CPU.
+     */
+    SSE2_ROW_KERNEL,
+
+    /*!
+     * Four words, 256 cells, at a time.
+     */
+    AVX2_ROW_KERNEL,
+
+    /*!
+     * Eight words, 512 cells, at a time.
+     */
+    AVX512_ROW_KERNEL
+};
+
+/*!
+ * \brief Picks the widest row kernel the CPU supports
+ * \return The fastest usable kernel
+ */
+RowKernel best_row_kernel();
+
+/*!
+ * \brief Checks if the CPU can run the kernel
+ * \param kernel The kernel to check
+ * \return True if the kernel can be used
+ */
+bool is_row_kernel_supported(RowKernel kernel);
+
+/*!
+ * \brief Steps one bit-packed row into the next generation.
+ * \details Bit N of word M is the cell in column 64*M+N. The rows are padded with
+ *          ghost cells, which hold the neighbours from across the edges:
+ *          bit 63 of the word before the row is the west neighbour of the first column,
+ *          and the bit right past the width is the east neighbour of the last column.
+ *          The other bits past the width don't matter, they will be zero in the output.
+ * \param kernel The instruction set to use. Must be supported by the CPU.
+ * \param rule The rule to step with. The common rules have kernels of their own,
+ *        see the *_rule constants in liferule.h.
+ * \param above The row above, with its ghost cells.
+ * \param row The row to step, with its ghost cells.
+ * \param below The row below, with its ghost cells.
+ * \param next The output row.
+ * \param width The width of the rows in cells.
+ */
+void step_packed_row(
+    RowKernel kernel,
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    int width
+);
+
+/*!
+ * \brief Steps a range of words from a bit-packed row into the next generation.
+ * \details Same as step_packed_row(), but only the words [first_word, last_word) are written.
+ * \param kernel The instruction set to use. Must be supported by the CPU.
+ * \param rule The rule to step with.
+ * \param above The row above.
+ * \param row The row to step.
+ * \param below The row below.
+ * \param next The output row. Only the words in the range are written.
+ * \param tallies If not null, the cells born in every word are added to the low 32 bits of
+ *        its word, and the cells died to the high 32 bits. Indexed like the row.
+ * \param width The width of the rows in cells.
+ * \param first_word The first word to step.
+ * \param last_word One past the last word to step.
+ */
+void step_packed_words(
+    RowKernel kernel,
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    uint64_t *tallies,
+    int width,
+    int first_word,
+    int last_word
+);
+
+/*!
+ * \brief Steps one multi-state row into the next generation with a Generations rule
+ * \details The states are stored in rule.get_state_bits() bit planes, bit N of the state
+ *          being in plane N. Every plane is laid out like the rows of step_packed_row(),
+ *          with the ghost cells.
+ * \param kernel The instruction set to use. Must be supported by the CPU.
+ * \param rule The rule to step with.
+ * \param above The first plane of the row above.
+ * \param row The first plane of the row to step.
+ * \param below The first plane of the row below.
+ * \param next The first plane of the output row.
+ * \param plane_stride The distance between the planes of a row, in words.
+ * \param width The width of the rows in cells.
+ */
+void step_packed_generations_row(
+    RowKernel kernel,
+    const LifeRule &rule,
+    const uint64_t *above,
+    const uint64_t *row,
+    const uint64_t *below,
+    uint64_t *next,
+    size_t plane_stride,
+    int width
+);
+
+#endif // ROWKERNEL_H
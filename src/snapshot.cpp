@@ -0,0 +1,205 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+constexpr char snapshot_magic[8] = {'G', 'O', 'L', 'S', 'N', 'A', 'P', '\0'};
+
+/*
+ * The cell data starts at a cache line, so the rows can be copied at full speed
+ */
+constexpr uint64_t snapshot_data_alignment = 64;
+
+std::runtime_error system_error(const std::string &what, const std::string &path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+/*
+ * Closes the file and unmaps the memory when going out of scope
+ */
+class MappedFile
+{
+  public:
+    MappedFile() :
+        fd{-1},
+        data{nullptr},
+        size{0}
+    {
+    }
+
+    ~MappedFile()
+    {
+        if(data)
+        {
+            munmap(data, size);
+        }
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    int fd;
+    void *data;
+    size_t size;
+};
+
+}
+
+void save_snapshot(const std::string &path, const LifeGrid &grid)
+{
+    const LifeRule rule = grid.get_rule();
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.byte_order_mark = snapshot_byte_order_mark;
+    header.version = snapshot_version;
+    header.width = grid.get_grid_width();
+    header.height = grid.get_grid_height();
+    header.generation = grid.get_generation();
+    header.birth = rule.birth;
+    header.survival = rule.survival;
+    header.states = static_cast<uint16_t>(rule.states);
+    header.wrap = grid.get_wrap_grid() ? 1 : 0;
+    header.words_per_row = static_cast<uint32_t>((header.width + 63) / 64);
+    header.planes = static_cast<uint32_t>(rule.get_state_bits());
+    header.data_offset = (sizeof(SnapshotHeader) + snapshot_data_alignment - 1) / snapshot_data_alignment * snapshot_data_alignment;
+
+    const size_t row_bytes = header.words_per_row * sizeof(uint64_t);
+    const size_t plane_bytes = row_bytes * static_cast<size_t>(header.height);
+    const size_t file_size = header.data_offset + plane_bytes * header.planes;
+
+    MappedFile file;
+    file.fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(file.fd < 0)
+    {
+        throw system_error("Can't open", path);
+    }
+    if(ftruncate(file.fd, static_cast<off_t>(file_size)) != 0)
+    {
+        throw system_error("Can't resize", path);
+    }
+
+    file.data = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+    if(file.data == MAP_FAILED)
+    {
+        file.data = nullptr;
+        throw system_error("Can't map", path);
+    }
+    file.size = file_size;
+
+    unsigned char *bytes = static_cast<unsigned char*>(file.data);
+    std::memcpy(bytes, &header, sizeof(header));
+
+    for(uint32_t plane = 0; plane < header.planes; plane++)
+    {
+        uint64_t *words = reinterpret_cast<uint64_t*>(bytes + header.data_offset + plane_bytes * plane);
+        for(int y = 0; y < header.height; y++)
+        {
+            grid.get_row_bits(y, static_cast<int>(plane), words + static_cast<size_t>(y) * header.words_per_row);
+        }
+    }
+
+    if(msync(file.data, file_size, MS_SYNC) != 0)
+    {
+        throw system_error("Can't write", path);
+    }
+}
+
+void load_snapshot(const std::string &path, LifeGrid &grid)
+{
+    MappedFile file;
+    file.fd = open(path.c_str(), O_RDONLY);
+    if(file.fd < 0)
+    {
+        throw system_error("Can't open", path);
+    }
+
+    struct stat status{};
+    if(fstat(file.fd, &status) != 0)
+    {
+        throw system_error("Can't read", path);
+    }
+    const size_t file_size = static_cast<size_t>(status.st_size);
+    if(file_size < sizeof(SnapshotHeader))
+    {
+        throw std::invalid_argument("Not a snapshot file: " + path);
+    }
+
+    file.data = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file.fd, 0);
+    if(file.data == MAP_FAILED)
+    {
+        file.data = nullptr;
+        throw system_error("Can't map", path);
+    }
+    file.size = file_size;
+
+    // The rows are read once, front to back
+    madvise(file.data, file_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    const unsigned char *bytes = static_cast<const unsigned char*>(file.data);
+    SnapshotHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if(std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0)
+    {
+        throw std::invalid_argument("Not a snapshot file: " + path);
+    }
+    if(header.byte_order_mark != snapshot_byte_order_mark)
+    {
+        throw std::invalid_argument("The snapshot was saved on a machine of another byte order: " + path);
+    }
+    if(header.version != snapshot_version)
+    {
+        throw std::invalid_argument("Unsupported snapshot version " + std::to_string(header.version) + ": " + path);
+    }
+
+    const LifeRule rule{header.birth, header.survival, header.states};
+    if(header.width < 1 || header.height < 1 ||
+       header.words_per_row != static_cast<uint32_t>((header.width + 63) / 64) ||
+       header.states < 2 || header.states > 256 ||
+       header.planes != static_cast<uint32_t>(rule.get_state_bits()) ||
+       header.data_offset < sizeof(SnapshotHeader) ||
+       header.data_offset % alignof(uint64_t) != 0)
+    {
+        throw std::invalid_argument("Corrupt snapshot header: " + path);
+    }
+
+    const size_t row_bytes = header.words_per_row * sizeof(uint64_t);
+    const size_t plane_bytes = row_bytes * static_cast<size_t>(header.height);
+    if(file_size < header.data_offset || (file_size - header.data_offset) / header.planes < plane_bytes)
+    {
+        throw std::invalid_argument("Truncated snapshot: " + path);
+    }
+
+    /*
+     * The rule is changed on an emptied grid, so there's nothing to convert, and goes before
+     * the resize, so that the grid has the planes for its states. The planes are copied over
+     * whatever the resize left in the grid, so that the copy is the only write.
+     */
+    grid.resize_grid(1, 1);
+    grid.set_rule(rule);
+    grid.resize_grid(header.width, header.height, false);
+    grid.set_wrap_grid(header.wrap != 0);
+
+    for(uint32_t plane = 0; plane < header.planes; plane++)
+    {
+        const uint64_t *words = reinterpret_cast<const uint64_t*>(bytes + header.data_offset + plane_bytes * plane);
+        grid.set_plane_bits(static_cast<int>(plane), words);
+    }
+
+    grid.set_generation(header.generation);
+}
@@ -0,0 +1,107 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "lifegrid.h"
+
+#include <cstdint>
+#include <string>
+
+/*!
+ * \brief The header at the start of a snapshot file
+ * \details The header is followed by the cell bits at data_offset: every bit plane
+ *          of the states in turn, and in a plane every row as words_per_row 64-bit
+ *          words. Bit N of a word is the cell 64*word+N of the row. The numbers are
+ *          in the byte order of the machine, which is checked through byte_order_mark.
+ */
+struct SnapshotHeader
+{
+    /*!
+     * \brief Always "GOLSNAP\0"
+     */
+    char magic[8];
+
+    /*!
+     * \brief snapshot_byte_order_mark as written by the machine that saved the file
+     */
+    uint32_t byte_order_mark;
+
+    /*!
+     * \brief The format version, snapshot_version
+     */
+    uint32_t version;
+
+    int32_t width;
+    int32_t height;
+
+    /*!
+     * \brief The generation count of the grid
+     */
+    uint64_t generation;
+
+    /*!
+     * \brief The birth mask of the rule, as in LifeRule
+     */
+    uint16_t birth;
+
+    /*!
+     * \brief The survival mask of the rule, as in LifeRule
+     */
+    uint16_t survival;
+
+    /*!
+     * \brief The state count of the rule
+     */
+    uint16_t states;
+
+    /*!
+     * \brief 1 if the grid wraps around itself
+     */
+    uint16_t wrap;
+
+    /*!
+     * \brief The 64-bit words in a row, (width+63)/64
+     */
+    uint32_t words_per_row;
+
+    /*!
+     * \brief The bit planes following the header
+     */
+    uint32_t planes;
+
+    /*!
+     * \brief Where the cell bits start, from the start of the file
+     */
+    uint64_t data_offset;
+};
+
+/*!
+ * \brief The current version of the snapshot format
+ */
+constexpr uint32_t snapshot_version = 1;
+
+/*!
+ * \brief Reads differently if the file comes from a machine of the other byte order
+ */
+constexpr uint32_t snapshot_byte_order_mark = 0x01020304;
+
+/*!
+ * \brief Saves the grid, its rule, generation and wrapping into a snapshot file
+ * \details The file is sized up front and written through a memory mapping.
+ *          Throws std::runtime_error if the file can't be written.
+ * \param path The file to write
+ * \param grid The grid to save
+ */
+void save_snapshot(const std::string &path, const LifeGrid &grid);
+
+/*!
+ * \brief Restores the grid from a snapshot file
+ * \details The file is memory mapped and its rows copied straight into the grid, with
+ *          nothing to parse but the header. The grid keeps its engine. Throws
+ *          std::runtime_error if the file can't be read, and std::invalid_argument
+ *          if it isn't a valid snapshot.
+ * \param path The file to read
+ * \param grid The grid to restore into
+ */
+void load_snapshot(const std::string &path, LifeGrid &grid);
+
+#endif // SNAPSHOT_H
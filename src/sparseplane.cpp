@@ -0,0 +1,264 @@
+#include "sparseplane.h"
+#include "lifegrid.h"
+#include "wordkernel.h"
+
+#include <utility>
+
+/*
+ * Division rounding towards negative infinity, so that -1 lands in the chunk -1
+ */
+static inline int64_t floor_div(int64_t value, int64_t divisor)
+{
+    const int64_t quotient = value / divisor;
+    return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+}
+
+SparsePlane::SparsePlane() :
+    generation{0}
+{
+}
+
+void SparsePlane::clear()
+{
+    chunks.clear();
+    chunks_next_generation.clear();
+    generation = 0;
+}
+
+/*
+ * The chunk coordinates are kept in 32 bits each, which allows
+ * the plane to span over 2^37 cells in both directions.
+ */
+uint64_t SparsePlane::chunk_key(int64_t chunk_x, int64_t chunk_y)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(chunk_x)) << 32) |
+            static_cast<uint64_t>(static_cast<uint32_t>(chunk_y));
+}
+
+void SparsePlane::key_to_chunk(uint64_t key, int64_t &chunk_x, int64_t &chunk_y)
+{
+    chunk_x = static_cast<int32_t>(static_cast<uint32_t>(key >> 32));
+    chunk_y = static_cast<int32_t>(static_cast<uint32_t>(key));
+}
+
+const SparsePlane::Chunk *SparsePlane::find_chunk(int64_t chunk_x, int64_t chunk_y) const
+{
+    const auto found = chunks.find(chunk_key(chunk_x, chunk_y));
+    return found == chunks.end() ? nullptr : &found->second;
+}
+
+void SparsePlane::set_cell(int64_t x, int64_t y, CELL state)
+{
+    const int64_t chunk_x = floor_div(x, chunk_size);
+    const int64_t chunk_y = floor_div(y, chunk_size);
+    const int local_x = static_cast<int>(x - chunk_x * chunk_size);
+    const int local_y = static_cast<int>(y - chunk_y * chunk_size);
+    const uint64_t key = chunk_key(chunk_x, chunk_y);
+
+    if(state == ALIVE)
+    {
+        chunks[key][static_cast<size_t>(local_y)] |= uint64_t{1} << local_x;
+        return;
+    }
+
+    const auto found = chunks.find(key);
+    if(found != chunks.end())
+    {
+        found->second[static_cast<size_t>(local_y)] &= ~(uint64_t{1} << local_x);
+    }
+}
+
+CELL SparsePlane::get_cell(int64_t x, int64_t y) const
+{
+    const int64_t chunk_x = floor_div(x, chunk_size);
+    const int64_t chunk_y = floor_div(y, chunk_size);
+    const Chunk *chunk = find_chunk(chunk_x, chunk_y);
+    if(!chunk)
+    {
+        return DEAD;
+    }
+
+    const int local_x = static_cast<int>(x - chunk_x * chunk_size);
+    const int local_y = static_cast<int>(y - chunk_y * chunk_size);
+    return ((*chunk)[static_cast<size_t>(local_y)] >> local_x) & 1 ? ALIVE : DEAD;
+}
+
+bool SparsePlane::step_chunk(int64_t chunk_x, int64_t chunk_y, Chunk &next) const
+{
+    static const Chunk empty_chunk{};
+
+    // The chunk and its 8 neighbours. Missing ones are all dead.
+    const Chunk *around[3][3];
+    for(int dy = 0; dy < 3; dy++)
+    {
+        for(int dx = 0; dx < 3; dx++)
+        {
+            const Chunk *chunk = find_chunk(chunk_x + dx - 1, chunk_y + dy - 1);
+            around[dy][dx] = chunk ? chunk : &empty_chunk;
+        }
+    }
+
+    /*
+     * Builds the west, centre and east words for the row y of the chunk.
+     * The rows -1 and chunk_size come from the chunks above and below.
+     */
+    const auto load_row = [&](int y, uint64_t &west, uint64_t &centre, uint64_t &east)
+    {
+        const int band = y < 0 ? 0 : (y >= chunk_size ? 2 : 1);
+        const size_t row = static_cast<size_t>((y + chunk_size) % chunk_size);
+
+        centre = (*around[band][1])[row];
+        west   = (centre << 1) | ((*around[band][0])[row] >> 63);
+        east   = (centre >> 1) | ((*around[band][2])[row] << 63);
+    };
+
+    uint64_t any_alive = 0;
+    for(int y = 0; y < chunk_size; y++)
+    {
+        uint64_t nw, n, ne;
+        uint64_t w,  c, e;
+        uint64_t sw, s, se;
+        load_row(y - 1, nw, n, ne);
+        load_row(y,     w,  c, e);
+        load_row(y + 1, sw, s, se);
+
+        next[static_cast<size_t>(y)] = compute_words(nw, n, ne, w, c, e, sw, s, se);
+        any_alive |= next[static_cast<size_t>(y)];
+    }
+    return any_alive != 0;
+}
+
+void SparsePlane::next_generation()
+{
+    chunks_next_generation.clear();
+
+    for(const auto &entry : chunks)
+    {
+        const Chunk &chunk = entry.second;
+        int64_t chunk_x, chunk_y;
+        key_to_chunk(entry.first, chunk_x, chunk_y);
+
+        /*
+         * Live cells on a border can give birth in the neighbouring chunk,
+         * so that one needs to be stepped too, even if it doesn't exist yet.
+         */
+        uint64_t left_column = 0;
+        uint64_t right_column = 0;
+        for(uint64_t row : chunk)
+        {
+            left_column  |= row & 1;
+            right_column |= row >> 63;
+        }
+        const bool top    = chunk.front() != 0;
+        const bool bottom = chunk.back()  != 0;
+        const bool left   = left_column  != 0;
+        const bool right  = right_column != 0;
+
+        const bool needed[3][3] = {
+            {(chunk.front() & 1) != 0, top,    (chunk.front() >> 63) != 0},
+            {left,                     true,   right},
+            {(chunk.back() & 1) != 0,  bottom, (chunk.back() >> 63) != 0}
+        };
+
+        for(int dy = 0; dy < 3; dy++)
+        {
+            for(int dx = 0; dx < 3; dx++)
+            {
+                if(!needed[dy][dx])
+                {
+                    continue;
+                }
+
+                const int64_t x = chunk_x + dx - 1;
+                const int64_t y = chunk_y + dy - 1;
+                const auto stepped = chunks_next_generation.emplace(chunk_key(x, y), Chunk{});
+                if(!stepped.second)
+                {
+                    continue;
+                }
+
+                /*
+                 * The chunks that died out are dropped right away. Another neighbour
+                 * may step an empty one again, which only costs the step.
+                 */
+                if(!step_chunk(x, y, stepped.first->second))
+                {
+                    chunks_next_generation.erase(stepped.first);
+                }
+            }
+        }
+    }
+
+    std::swap(chunks, chunks_next_generation);
+    generation++;
+}
+
+uint64_t SparsePlane::get_generation() const
+{
+    return generation;
+}
+
+uint64_t SparsePlane::get_population() const
+{
+    uint64_t population = 0;
+    for(const auto &entry : chunks)
+    {
+        for(uint64_t row : entry.second)
+        {
+            population += static_cast<uint64_t>(__builtin_popcountll(row));
+        }
+    }
+    return population;
+}
+
+size_t SparsePlane::get_chunk_count() const
+{
+    return chunks.size();
+}
+
+void SparsePlane::for_each_live_cell(const std::function<void(int64_t, int64_t)> &callback) const
+{
+    for(const auto &entry : chunks)
+    {
+        int64_t chunk_x, chunk_y;
+        key_to_chunk(entry.first, chunk_x, chunk_y);
+
+        for(int y = 0; y < chunk_size; y++)
+        {
+            uint64_t row = entry.second[static_cast<size_t>(y)];
+            while(row)
+            {
+                const int x = __builtin_ctzll(row);
+                callback(chunk_x * chunk_size + x, chunk_y * chunk_size + y);
+                row &= row - 1;
+            }
+        }
+    }
+}
+
+void SparsePlane::load_grid(const LifeGrid &grid)
+{
+    clear();
+    for(int y = 0; y < grid.get_grid_height(); y++)
+    {
+        for(int x = 0; x < grid.get_grid_width(); x++)
+        {
+            if(grid.get_cell(x, y) == ALIVE)
+            {
+                set_cell(x, y, ALIVE);
+            }
+        }
+    }
+}
+
+void SparsePlane::store_grid(LifeGrid &grid) const
+{
+    grid.clear_grid();
+    for_each_live_cell([&](int64_t x, int64_t y)
+    {
+        if(x >= 0 && x < grid.get_grid_width() && y >= 0 && y < grid.get_grid_height())
+        {
+            grid.set_cell(static_cast<int>(x), static_cast<int>(y), ALIVE);
+        }
+    });
+}
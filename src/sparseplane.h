@@ -0,0 +1,133 @@
+#ifndef SPARSEPLANE_H
+#define SPARSEPLANE_H
+
+#include "cellkernel.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+class LifeGrid;
+
+/*!
+ * \brief An unbounded plane, stored as a hash map of 64x64 chunks
+ * \details Only the chunks with live cells are stored, so the memory grows with
+ *          the population instead of the bounding box. A chunk is created when
+ *          the cells next to its border come alive, and dropped when it empties.
+ */
+class SparsePlane
+{
+  public:
+    SparsePlane();
+
+    /*!
+     * \brief Kills all cells and resets the generation counter
+     */
+    void clear();
+
+    /*!
+     * \brief Sets the cell value accordingly
+     * \param x The column
+     * \param y The row
+     * \param state The wanted state of the cell
+     */
+    void set_cell(int64_t x, int64_t y, CELL state);
+
+    /*!
+     * \brief Fetch the state of a certain cell
+     * \param x The column
+     * \param y The row
+     * \return The state of the cell
+     */
+    CELL get_cell(int64_t x, int64_t y) const;
+
+    /*!
+     * \brief Updates the whole plane into the next generation
+     */
+    void next_generation();
+
+    /*!
+     * \brief Grab the generation counter
+     * \return The generations stepped since the last clear()
+     */
+    uint64_t get_generation() const;
+
+    /*!
+     * \brief Grab the population
+     * \return The amount of live cells
+     */
+    uint64_t get_population() const;
+
+    /*!
+     * \brief Grab the chunk count
+     * \return The amount of chunks allocated
+     */
+    size_t get_chunk_count() const;
+
+    /*!
+     * \brief Calls the callback for every live cell
+     * \param callback Called with the x and y of a live cell
+     */
+    void for_each_live_cell(const std::function<void(int64_t, int64_t)> &callback) const;
+
+    /*!
+     * \brief Replaces the plane with the contents of the grid
+     * \details The top-left corner of the grid is placed at (0, 0)
+     * \param grid The grid to copy
+     */
+    void load_grid(const LifeGrid &grid);
+
+    /*!
+     * \brief Copies the plane into the grid
+     * \details The top-left corner of the grid shows the cell (0, 0).
+     *          The cells outside of the grid are left out.
+     * \param grid The grid to overwrite
+     */
+    void store_grid(LifeGrid &grid) const;
+
+    /*!
+     * \brief The width and the height of a chunk
+     */
+    static constexpr int chunk_size = 64;
+
+  private:
+    /*!
+     * \brief 64x64 cells, bit x of row y being the cell at (x, y) within the chunk
+     */
+    typedef std::array<uint64_t, chunk_size> Chunk;
+
+    /*!
+     * \brief Packs the chunk coordinates into a hash map key
+     */
+    static uint64_t chunk_key(int64_t chunk_x, int64_t chunk_y);
+
+    /*!
+     * \brief Unpacks the chunk coordinates from a key
+     */
+    static void key_to_chunk(uint64_t key, int64_t &chunk_x, int64_t &chunk_y);
+
+    /*!
+     * \brief Grab a chunk if it exists
+     * \return The chunk or nullptr
+     */
+    const Chunk *find_chunk(int64_t chunk_x, int64_t chunk_y) const;
+
+    /*!
+     * \brief Computes the next generation of the chunk
+     * \return True if the chunk has any live cells left
+     */
+    bool step_chunk(int64_t chunk_x, int64_t chunk_y, Chunk &next) const;
+
+    std::unordered_map<uint64_t, Chunk> chunks;
+
+    /*!
+     * \brief The next generation, swapped with chunks after a step
+     */
+    std::unordered_map<uint64_t, Chunk> chunks_next_generation;
+
+    uint64_t generation;
+};
+
+#endif // SPARSEPLANE_H
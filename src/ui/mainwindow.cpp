@@ -1,10 +1,13 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "resizedialog.h"
+#include "../patternio.h"
 
+#include <QFileDialog>
 #include <QLayout>
 #include <QGraphicsView>
 #include <QGraphicsScene>
+#include <QMessageBox>
 
 #include <iostream>
 
@@ -31,6 +34,19 @@ MainWindow::MainWindow(QWidget *parent) :
     life_grid_scene = std::make_unique<LifeGridScene>(this);
     graphics_view->setScene(life_grid_scene.get());
 
+    // The simulation stops by itself once it repeats, the button follows it from the GUI thread
+    life_grid_scene->set_cycle_found_callback([this](int period)
+    {
+        QMetaObject::invokeMethod(this, [this, period]()
+        {
+            ui->actionRun->setChecked(false);
+            const QString message = period == 1 ?
+                QString("Settled into a still life at generation %1").arg(life_grid_scene->get_generation()) :
+                QString("Settled into a period %1 oscillator at generation %2").arg(period).arg(life_grid_scene->get_generation());
+            ui->statusBar->showMessage(message);
+        }, Qt::QueuedConnection);
+    });
+
 
     // Create the speed selector with the initial value and connect it back
 
@@ -42,7 +58,8 @@ MainWindow::MainWindow(QWidget *parent) :
 
     // And then the selector itself
     speed_selector = std::make_unique<QSpinBox>();
-    speed_selector->setRange(1, 100);
+    speed_selector->setRange(0, 100);
+    speed_selector->setSpecialValueText("Uncapped");
     speed_selector->setValue(1);
     speed_selector->connect(speed_selector.get(), static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [=](int i) {
         this->on_speed_changed(i);
@@ -50,6 +67,14 @@ MainWindow::MainWindow(QWidget *parent) :
 
     ui->mainToolBar->addWidget(speed_selector.get());
 
+    // The statistics are refreshed a few times a second, however fast the simulation runs
+    statistics_label = std::make_unique<QLabel>(ui->statusBar);
+    ui->statusBar->addPermanentWidget(statistics_label.get());
+    statistics_timer = std::make_unique<QTimer>(this);
+    connect(statistics_timer.get(), &QTimer::timeout, this, &MainWindow::update_statistics);
+    statistics_timer->start(250);
+    update_statistics();
+
     // Finally, ensure painting is toggled on by default
     for(auto action : ui->mainToolBar->actions())
     {
@@ -76,6 +101,88 @@ void MainWindow::on_actionExit_triggered()
     this->close();
 }
 
+void MainWindow::on_actionOpen_triggered()
+{
+    const QString path = QFileDialog::getOpenFileName(
+        this,
+        "Open pattern",
+        QString(),
+        "Patterns (*.rle *.lif *.life *.cells);;All files (*)"
+    );
+    if(path.isEmpty())
+    {
+        return;
+    }
+
+    // The grid can't change under the update thread, and the recording can't change size
+    ui->actionRun->setChecked(false);
+    ui->actionRecord->setChecked(false);
+
+    try
+    {
+        PatternInfo info;
+        life_grid_scene->change_grid([this, &path, &info]()
+        {
+            info = load_pattern(path.toStdString(), *life_grid_scene, true);
+        });
+        if(!info.name.empty())
+        {
+            ui->statusBar->showMessage(QString::fromStdString(info.name), 5000);
+        }
+    }
+    catch(const std::exception &error)
+    {
+        QMessageBox::warning(this, "Open pattern", QString::fromStdString(error.what()));
+    }
+}
+
+void MainWindow::on_actionSave_triggered()
+{
+    const QString path = QFileDialog::getSaveFileName(
+        this,
+        "Save pattern",
+        QString(),
+        "RLE (*.rle);;Life 1.06 (*.lif);;Plaintext (*.cells)"
+    );
+    if(path.isEmpty())
+    {
+        return;
+    }
+
+    ui->actionRun->setChecked(false);
+
+    try
+    {
+        save_pattern(path.toStdString(), *life_grid_scene);
+    }
+    catch(const std::exception &error)
+    {
+        QMessageBox::warning(this, "Save pattern", QString::fromStdString(error.what()));
+    }
+}
+
+void MainWindow::update_statistics()
+{
+    // The figures of the displayed generation, the grid itself may be a step ahead in another thread
+    const GridFrame &frame = life_grid_scene->get_displayed_frame();
+    QString text = QString("Generation %1   Population %2   Births %3   Deaths %4")
+        .arg(frame.get_generation())
+        .arg(frame.get_population())
+        .arg(frame.get_births())
+        .arg(frame.get_deaths());
+
+    int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    if(frame.get_bounding_box(min_x, min_y, max_x, max_y))
+    {
+        text += QString("   Bounds %1x%2 at (%3, %4)")
+            .arg(max_x - min_x + 1)
+            .arg(max_y - min_y + 1)
+            .arg(min_x)
+            .arg(min_y);
+    }
+    statistics_label->setText(text);
+}
+
 void MainWindow::on_speed_changed(int i)
 {
     life_grid_scene->set_speed(i);
@@ -83,8 +190,10 @@ void MainWindow::on_speed_changed(int i)
 
 void MainWindow::on_actionStep_triggered()
 {
-    life_grid_scene->next_generation();
-    life_grid_scene->update();
+    life_grid_scene->change_grid([this]()
+    {
+        life_grid_scene->step_generation();
+    });
 }
 
 void MainWindow::on_actionRun_toggled(bool arg1)
@@ -94,13 +203,52 @@ void MainWindow::on_actionRun_toggled(bool arg1)
 
 void MainWindow::on_actionWrap_Grid_toggled(bool arg1)
 {
-    life_grid_scene->set_wrap_grid(arg1);
+    life_grid_scene->change_grid([this, arg1]()
+    {
+        life_grid_scene->set_wrap_grid(arg1);
+    });
+}
+
+void MainWindow::on_actionRecord_toggled(bool arg1)
+{
+    if(!arg1)
+    {
+        life_grid_scene->stop_recording();
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(
+        this,
+        "Record generations",
+        QString(),
+        "Recordings (*.rec)"
+    );
+    if(path.isEmpty())
+    {
+        ui->actionRecord->setChecked(false);
+        return;
+    }
+
+    // The first frame is recorded from this thread, so the grid can't be stepped meanwhile
+    ui->actionRun->setChecked(false);
+
+    try
+    {
+        life_grid_scene->start_recording(path.toStdString());
+    }
+    catch(const std::exception &error)
+    {
+        QMessageBox::warning(this, "Record generations", QString::fromStdString(error.what()));
+        ui->actionRecord->setChecked(false);
+    }
 }
 
 void MainWindow::on_actionClear_triggered()
 {
-    life_grid_scene->clear_grid();
-    life_grid_scene->update();
+    life_grid_scene->change_grid([this]()
+    {
+        life_grid_scene->clear_grid();
+    });
 }
 
 void MainWindow::on_actionTogglePaint_toggled(bool arg1)
@@ -110,10 +258,11 @@ void MainWindow::on_actionTogglePaint_toggled(bool arg1)
 
 void MainWindow::on_actionResize_triggered()
 {
+    const GridFrame &frame = life_grid_scene->get_displayed_frame();
     resize_dialog = std::make_unique<ResizeDialog>(
         this,
-        life_grid_scene->get_grid_width(),
-        life_grid_scene->get_grid_height()
+        frame.get_grid_width(),
+        frame.get_grid_height()
     );
 
     QObject::connect(resize_dialog.get(), &QDialog::accepted, this, &MainWindow::on_resize_dialog_accepted);
@@ -123,9 +272,11 @@ void MainWindow::on_actionResize_triggered()
 
 void MainWindow::on_resize_dialog_accepted()
 {
-    life_grid_scene->resize_grid(
-        resize_dialog->new_width,
-        resize_dialog->new_height
-    );
-    life_grid_scene->update();
+    ui->actionRecord->setChecked(false);
+    const int new_width = resize_dialog->new_width;
+    const int new_height = resize_dialog->new_height;
+    life_grid_scene->change_grid([this, new_width, new_height]()
+    {
+        life_grid_scene->resize_grid(new_width, new_height);
+    });
 }
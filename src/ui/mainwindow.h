@@ -9,6 +9,7 @@
 #include <QMainWindow>
 #include <QSpinBox>
 #include <QLabel>
+#include <QTimer>
 
 #include <memory>
 
@@ -37,6 +38,17 @@ private slots:
      */
     void on_actionExit_triggered();
 
+    /*!
+     * \brief Signaled when the user wants to load a pattern file
+     * \details Stops the simulation and replaces the grid with the pattern, resized to fit it
+     */
+    void on_actionOpen_triggered();
+
+    /*!
+     * \brief Signaled when the user wants to save the grid into a pattern file
+     */
+    void on_actionSave_triggered();
+
     /*!
      * \brief Signaled when the user wants to step a generation forwards manually
      */
@@ -55,6 +67,13 @@ private slots:
      */
     void on_actionWrap_Grid_toggled(bool arg1);
 
+    /*!
+     * \brief Signaled when the record button is toggled
+     * \details If pressed, asks for a file and records every generation into it
+     * \param arg1 True if the button pressed
+     */
+    void on_actionRecord_toggled(bool arg1);
+
     /*!
      * \brief Signaled when the clear button is triggered
      * \details Clears the entire grid
@@ -89,8 +108,16 @@ private:
     std::unique_ptr<QSpinBox> speed_selector;
     std::unique_ptr<LifeGridScene> life_grid_scene;
     std::unique_ptr<ResizeDialog> resize_dialog;
+    std::unique_ptr<QLabel> statistics_label;
+    std::unique_ptr<QTimer> statistics_timer;
 
     void on_speed_changed(int i);
+
+    /*!
+     * \brief Shows the generation, population, births, deaths and bounding box in the status bar
+     * \details Called a few times a second, the figures are kept up to date by the grid itself
+     */
+    void update_statistics();
 };
 
 #endif // MAINWINDOW_H
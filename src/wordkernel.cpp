@@ -0,0 +1,14 @@
+#include "wordkernel.h"
+
+WordKernel::WordKernel( std::array<uint64_t,9> initial_words ) : words(initial_words)
+{
+}
+
+uint64_t WordKernel::compute_state() const
+{
+    return compute_words(
+        words[0], words[1], words[2],
+        words[3], words[4], words[5],
+        words[6], words[7], words[8]
+    );
+}
@@ -0,0 +1,190 @@
+#ifndef WORDKERNEL_H
+#define WORDKERNEL_H
+
+#include <array>
+#include <cstdint>
+
+/*!
+ * \brief Forces inlining, used by the helpers shared with the SIMD row kernels
+ * \details The vector versions have to end up inside the function with the matching
+ *          target instruction set, even in unoptimized builds.
+ */
+#if defined(__GNUC__)
+#define WORD_KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define WORD_KERNEL_INLINE inline
+#endif
+
+/*!
+ *  \brief 3x3 matrix of 64 bit words. The bit-parallel sibling of CellKernel.
+ *  \details Every bit lane holds a complete 3x3 neighbourhood, so one kernel
+ *           computes the next state of 64 horizontally adjacent cells at once.
+ *           Uses the same layout as CellKernel:
+ * <pre>
+ * 0 1 2    NW N NE
+ * 3 4 5 ->  W C  E
+ * 6 7 8    SW S SE
+ * </pre>
+ *           The centre word holds the cells themselves, the other words hold
+ *           the same rows shifted so that the neighbour lines up with the cell.
+ */
+struct WordKernel
+{
+    std::array<uint64_t,9> words;
+
+    /*!
+     * \brief Construct kernel with a std array
+     * \param initial_words The nine neighbourhood words, in the order shown above.
+     */
+    WordKernel(std::array<uint64_t,9> initial_words);
+
+    /*!
+     * \brief Computes the new state for all 64 cells of the kernel.
+     * \details Counts the neighbours with a bit-sliced adder tree, so that
+     *          every bit lane ends up with its own neighbour count.
+     * \return The new cell states, bit N being the state of cell N.
+     */
+    uint64_t compute_state() const;
+};
+
+/*!
+ * \brief Counts the set bits of every 64-bit lane
+ * \details Gets by with the plain bitwise operators, so it stays inline without the
+ *          popcnt instruction in the target. WORD can be uint64_t or a vector of them.
+ * \return The count of every lane
+ */
+template<typename WORD>
+WORD_KERNEL_INLINE WORD count_word_bits(const WORD &word)
+{
+    WORD bits = word - ((word >> 1) & 0x5555555555555555);
+    bits = (bits & 0x3333333333333333) + ((bits >> 2) & 0x3333333333333333);
+    bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0f;
+    bits += bits >> 8;
+    bits += bits >> 16;
+    bits += bits >> 32;
+    return bits & 0x7f;
+}
+
+/*!
+ * \brief The bit-sliced Game of Life rule, shared by WordKernel and the SIMD row kernels.
+ * \details WORD can be any type with the bitwise operators, like uint64_t or a vector of them.
+ *          The arguments are the 3x3 neighbourhood in the WordKernel order.
+ * \return The new cell states
+ */
+template<typename WORD>
+WORD_KERNEL_INLINE WORD compute_words(
+    const WORD &nw, const WORD &n, const WORD &ne,
+    const WORD &w,  const WORD &c, const WORD &e,
+    const WORD &sw, const WORD &s, const WORD &se
+)
+{
+    /*
+     * Every bit lane is summed on its own with full adders, so a
+     * "bit" below actually means 64 independent bits.
+     *
+     * Top and bottom rows: three cells each, summed into a ones and a twos bit.
+     */
+    const WORD top_ones    = nw ^ n ^ ne;
+    const WORD top_twos    = (nw & n) | (ne & (nw ^ n));
+
+    const WORD bottom_ones = sw ^ s ^ se;
+    const WORD bottom_twos = (sw & s) | (se & (sw ^ s));
+
+    // The middle row has only the two neighbours, the cell itself isn't counted
+    const WORD middle_ones = w ^ e;
+    const WORD middle_twos = w & e;
+
+    // Sum up the ones, the carry goes to the twos
+    const WORD ones       = top_ones ^ bottom_ones ^ middle_ones;
+    const WORD ones_carry = (top_ones & bottom_ones) | (middle_ones & (top_ones ^ bottom_ones));
+
+    // Sum up the twos, the carries go to the fours
+    const WORD twos_partial = top_twos ^ bottom_twos ^ middle_twos;
+    const WORD fours_a      = (top_twos & bottom_twos) | (middle_twos & (top_twos ^ bottom_twos));
+    const WORD twos         = twos_partial ^ ones_carry;
+    const WORD fours_b      = twos_partial & ones_carry;
+
+    // Only the fours bit matters above this. 8 neighbours sets neither ones, twos nor fours.
+    const WORD fours = fours_a ^ fours_b;
+
+    /*
+     * Alive with 2 or 3 neighbours, or dead with 3 neighbours:
+     * the twos bit must be set, the fours bit clear, and either the
+     * ones bit or the cell itself must be set.
+     */
+    return twos & ~fours & (ones | c);
+}
+
+/*!
+ * \brief The bit-sliced version of any Life-like rule
+ * \details Works like compute_words(), but counts the neighbours all the way up to 8
+ *          and picks the counts in the masks. When the masks are compile time constants,
+ *          the compiler drops the counts the rule doesn't care about.
+ * \param birth Bit N set if N neighbours give birth, like in LifeRule
+ * \param survival Bit N set if a cell survives with N neighbours
+ * \return The new cell states
+ */
+template<typename WORD>
+WORD_KERNEL_INLINE WORD compute_words_rule(
+    uint16_t birth, uint16_t survival,
+    const WORD &nw, const WORD &n, const WORD &ne,
+    const WORD &w,  const WORD &c, const WORD &e,
+    const WORD &sw, const WORD &s, const WORD &se
+)
+{
+    // The same adder tree as in compute_words(), see there for the details
+    const WORD top_ones    = nw ^ n ^ ne;
+    const WORD top_twos    = (nw & n) | (ne & (nw ^ n));
+
+    const WORD bottom_ones = sw ^ s ^ se;
+    const WORD bottom_twos = (sw & s) | (se & (sw ^ s));
+
+    const WORD middle_ones = w ^ e;
+    const WORD middle_twos = w & e;
+
+    const WORD ones       = top_ones ^ bottom_ones ^ middle_ones;
+    const WORD ones_carry = (top_ones & bottom_ones) | (middle_ones & (top_ones ^ bottom_ones));
+
+    const WORD twos_partial = top_twos ^ bottom_twos ^ middle_twos;
+    const WORD fours_a      = (top_twos & bottom_twos) | (middle_twos & (top_twos ^ bottom_twos));
+    const WORD twos         = twos_partial ^ ones_carry;
+    const WORD fours_b      = twos_partial & ones_carry;
+
+    // With 8 neighbours both of the fours carries are set
+    const WORD fours  = fours_a ^ fours_b;
+    const WORD eights = fours_a & fours_b;
+
+    const WORD dead = ~c;
+    WORD result = c ^ c;
+    for(int count = 0; count <= 8; count++)
+    {
+        const bool gives_birth = (birth >> count) & 1;
+        const bool survives    = (survival >> count) & 1;
+        if(!gives_birth && !survives)
+        {
+            continue;
+        }
+
+        // The lanes with exactly `count` neighbours
+        const WORD has_count = ((count & 1) ? ones  : ~ones)
+                             & ((count & 2) ? twos  : ~twos)
+                             & ((count & 4) ? fours : ~fours)
+                             & ((count & 8) ? eights : ~eights);
+
+        if(gives_birth && survives)
+        {
+            result |= has_count;
+        }
+        else if(gives_birth)
+        {
+            result |= has_count & dead;
+        }
+        else
+        {
+            result |= has_count & c;
+        }
+    }
+    return result;
+}
+
+#endif // WORDKERNEL_H
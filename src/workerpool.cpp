@@ -0,0 +1,120 @@
+#include "workerpool.h"
+
+#include <stdexcept>
+
+WorkerPool::WorkerPool(int thread_count) :
+    run_id{0},
+    busy_workers{0},
+    is_stopping{false},
+    current_job{nullptr},
+    current_job_count{0},
+    next_job{0}
+{
+    if(thread_count < 1)
+    {
+        throw std::out_of_range("A worker pool needs at least one thread");
+    }
+
+    // The thread calling run() is one of the workers
+    for(int i = 1; i < thread_count; i++)
+    {
+        threads.emplace_back([this]()
+        {
+            worker_loop();
+        });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+    work_available.notify_all();
+
+    for(auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+int WorkerPool::get_thread_count() const
+{
+    return static_cast<int>(threads.size()) + 1;
+}
+
+void WorkerPool::work_on_jobs()
+{
+    for(;;)
+    {
+        const int job_index = next_job.fetch_add(1);
+        if(job_index >= current_job_count)
+        {
+            return;
+        }
+        (*current_job)(job_index);
+    }
+}
+
+void WorkerPool::worker_loop()
+{
+    unsigned long last_run_id = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [&]()
+            {
+                return is_stopping || run_id != last_run_id;
+            });
+
+            if(is_stopping)
+            {
+                return;
+            }
+            last_run_id = run_id;
+        }
+
+        work_on_jobs();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy_workers--;
+        }
+        work_done.notify_one();
+    }
+}
+
+void WorkerPool::run(int job_count, const std::function<void(int)> &job)
+{
+    if(threads.empty() || job_count <= 1)
+    {
+        for(int i = 0; i < job_count; i++)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current_job = &job;
+        current_job_count = job_count;
+        next_job = 0;
+        busy_workers = static_cast<int>(threads.size());
+        run_id++;
+    }
+    work_available.notify_all();
+
+    work_on_jobs();
+
+    // Wait until every worker has stopped touching the job
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [&]()
+    {
+        return busy_workers == 0;
+    });
+    current_job = nullptr;
+}
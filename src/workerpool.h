@@ -0,0 +1,86 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief A persistent set of threads for splitting work into independent jobs
+ * \details The threads are started once and sleep between the runs, so
+ *          running a job doesn't cost a thread creation.
+ */
+class WorkerPool
+{
+  public:
+    /*!
+     * \brief Starts the worker threads
+     * \param thread_count The total amount of threads running the jobs, including
+     *        the one calling run(). Must be 1 or more.
+     */
+    explicit WorkerPool(int thread_count);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /*!
+     * \brief Runs the job for every index in [0, job_count)
+     * \details The calling thread works on the jobs as well, and the
+     *          function returns only after all of them are done.
+     * \param job_count The amount of jobs
+     * \param job The job, called with the job index
+     */
+    void run(int job_count, const std::function<void(int)> &job);
+
+    /*!
+     * \brief Grab the thread count
+     * \return The amount of threads running the jobs, including the calling thread
+     */
+    int get_thread_count() const;
+
+  private:
+    /*!
+     * \brief The loop run by every worker thread
+     */
+    void worker_loop();
+
+    /*!
+     * \brief Picks jobs until all of them have been taken
+     */
+    void work_on_jobs();
+
+    std::vector<std::thread> threads;
+
+    /*!
+     * \brief Guards the fields below, along with the condition variables
+     */
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+
+    /*!
+     * \brief Bumped for every run(), tells the workers there's something new to do
+     */
+    unsigned long run_id;
+
+    /*!
+     * \brief Amount of workers still busy with the current run
+     */
+    int busy_workers;
+
+    bool is_stopping;
+
+    const std::function<void(int)> *current_job;
+    int current_job_count;
+
+    /*!
+     * \brief The next job index to take
+     */
+    std::atomic<int> next_job;
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,241 @@
+#include "../src/lifegrid.h"
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * The benchmarks for the grid engines
+ *
+ * Every engine steps a random soup for each board size, density and wrap
+ * mode. Each configuration runs in a child process of its own, so the peak
+ * RSS reported by the kernel belongs to that configuration alone.
+ * The results are written to the standard output as JSON, the progress to
+ * the standard error.
+ *
+ * Usage: run_bench [--max-size N] [--min-time SECONDS]
+ */
+
+struct BenchEngine
+{
+	const char *name;
+	GridEngine engine;
+	bool use_advance;
+};
+
+struct BenchConfig
+{
+	BenchEngine engine;
+	int size;
+	int percent_alive;
+	bool wrap;
+};
+
+struct BenchResult
+{
+	long long generations;
+	double seconds;
+	long peak_rss_kb;
+	bool ok;
+};
+
+
+/*
+ * Fills the grid with a reproducible random soup
+ */
+void fill_soup(LifeGrid &grid, unsigned seed, int percent_alive)
+{
+	for(int y = 0; y < grid.get_grid_height(); y++)
+	{
+		for(int x = 0; x < grid.get_grid_width(); x++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			const int roll = static_cast<int>((seed >> 16) % 100);
+			if(roll < percent_alive)
+			{
+				grid.set_cell(x, y, ALIVE);
+			}
+		}
+	}
+}
+
+/*
+ * Steps the soup until at least min_seconds have passed, doubling
+ * the generation count between the timed runs
+ */
+void run_config(const BenchConfig &config, double min_seconds, long long &generations, double &seconds)
+{
+	LifeGrid grid{3};
+	grid.set_engine(config.engine.engine);
+	grid.set_thread_count(1);
+	grid.set_wrap_grid(config.wrap);
+	grid.resize_grid(config.size, config.size);
+	fill_soup(grid, static_cast<unsigned>(config.size), config.percent_alive);
+
+	// Warm up the caches and let the tiles settle on the first step
+	grid.next_generation();
+
+	generations = 0;
+	seconds = 0.0;
+	long long batch = 1;
+	while(seconds < min_seconds)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if(config.engine.use_advance)
+		{
+			grid.advance(static_cast<int>(batch));
+		}
+		else
+		{
+			for(long long generation = 0; generation < batch; generation++)
+			{
+				grid.next_generation();
+			}
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		generations += batch;
+		seconds += elapsed.count();
+		batch *= 2;
+	}
+}
+
+/*
+ * Runs the configuration in a child process and collects its peak RSS
+ */
+BenchResult run_in_child(const BenchConfig &config, double min_seconds)
+{
+	BenchResult result{0, 0.0, 0, false};
+
+	int fds[2];
+	if(pipe(fds) != 0)
+	{
+		return result;
+	}
+
+	const pid_t pid = fork();
+	if(pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return result;
+	}
+
+	if(pid == 0)
+	{
+		close(fds[0]);
+		long long generations = 0;
+		double seconds = 0.0;
+		run_config(config, min_seconds, generations, seconds);
+		const ssize_t written = write(fds[1], &generations, sizeof(generations)) + write(fds[1], &seconds, sizeof(seconds));
+		_exit(written == static_cast<ssize_t>(sizeof(generations) + sizeof(seconds)) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	const bool read_ok = read(fds[0], &result.generations, sizeof(result.generations)) == static_cast<ssize_t>(sizeof(result.generations)) &&
+	                     read(fds[0], &result.seconds, sizeof(result.seconds)) == static_cast<ssize_t>(sizeof(result.seconds));
+	close(fds[0]);
+
+	int status = 0;
+	struct rusage usage{};
+	if(wait4(pid, &status, 0, &usage) == pid && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && read_ok)
+	{
+		result.peak_rss_kb = usage.ru_maxrss;
+		result.ok = true;
+	}
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	int max_size = 16384;
+	double min_seconds = 0.2;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const std::string argument{argv[i]};
+		if(argument == "--max-size" && i + 1 < argc)
+		{
+			max_size = std::atoi(argv[++i]);
+		}
+		else if(argument == "--min-time" && i + 1 < argc)
+		{
+			min_seconds = std::atof(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--max-size N] [--min-time SECONDS]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	const BenchEngine engines[] = {
+		{"kernel", KERNEL_ENGINE, false},
+		{"lookup", LOOKUP_ENGINE, false},
+		{"packed", PACKED_ENGINE, false},
+		{"packed_advance", PACKED_ENGINE, true},
+	};
+	const int sizes[] = {64, 256, 1024, 4096, 16384};
+	const int densities[] = {10, 35, 50};
+
+	std::vector<BenchConfig> configs;
+	for(const BenchEngine &engine : engines)
+	{
+		for(int size : sizes)
+		{
+			if(size > max_size)
+			{
+				continue;
+			}
+			for(int percent_alive : densities)
+			{
+				for(bool wrap : {false, true})
+				{
+					configs.push_back({engine, size, percent_alive, wrap});
+				}
+			}
+		}
+	}
+
+	int failures = 0;
+	bool first_result = true;
+	std::cout << "{\n  \"results\": [";
+	for(size_t i = 0; i < configs.size(); i++)
+	{
+		const BenchConfig &config = configs[i];
+		std::cerr << "[" << i + 1 << "/" << configs.size() << "] " << config.engine.name << " "
+		          << config.size << "x" << config.size << " " << config.percent_alive << "% "
+		          << (config.wrap ? "wrapped" : "bounded") << std::endl;
+
+		const BenchResult result = run_in_child(config, min_seconds);
+		if(!result.ok)
+		{
+			failures++;
+			continue;
+		}
+
+		const double cell_updates = static_cast<double>(config.size) * config.size * static_cast<double>(result.generations);
+		char line[512];
+		std::snprintf(line, sizeof(line),
+		              "%s\n    {\"engine\": \"%s\", \"width\": %d, \"height\": %d, \"density\": %.2f, \"wrap\": %s, "
+		              "\"generations\": %lld, \"seconds\": %.6f, \"cells_per_second\": %.0f, \"ns_per_cell\": %.4f, \"peak_rss_kb\": %ld}",
+		              first_result ? "" : ",",
+		              config.engine.name, config.size, config.size, config.percent_alive / 100.0,
+		              config.wrap ? "true" : "false",
+		              result.generations, result.seconds, cell_updates / result.seconds,
+		              result.seconds * 1e9 / cell_updates, result.peak_rss_kb);
+		std::cout << line << std::flush;
+		first_result = false;
+	}
+	std::cout << "\n  ],\n  \"failures\": " << failures << "\n}" << std::endl;
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,7 +1,25 @@
 #include "../src/lifegrid.h"
+#include "../src/lookupkernel.h"
+#include "../src/wordkernel.h"
+#include "../src/hashlife.h"
+#include "../src/sparseplane.h"
+#include "../src/largerthanlife.h"
+#include "../src/patternio.h"
+#include "../src/snapshot.h"
+#include "../src/recorder.h"
+#include "../src/densitypyramid.h"
+#include "../src/gridframe.h"
 
 #include <iostream>
+#include <sstream>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 using std::cout;
 using std::endl;
@@ -207,9 +225,2316 @@ int test_kernel_step_right()
 	return errors;
 }
 
+/*
+ * The tests for WordKernel::compute_state
+ */
+int test_word_kernel_compute_state()
+{
+	int errors = 0;
+
+	// Every bit lane must agree with CellKernel, so try all of the 512 neighbourhoods
+	int mismatches = 0;
+	for(int pattern = 0; pattern < 512; pattern++)
+	{
+		std::array<CELL,9> kernel_cells;
+		std::array<uint64_t,9> kernel_words;
+		for(int i = 0; i < 9; i++)
+		{
+			const bool alive = (pattern >> i) & 1;
+			kernel_cells[i] = alive ? ALIVE : DEAD;
+			kernel_words[i] = alive ? ~uint64_t{0} : 0;
+		}
+
+		const uint64_t expected = CellKernel{kernel_cells}.compute_state() == ALIVE ? ~uint64_t{0} : 0;
+		if(WordKernel{kernel_words}.compute_state() != expected)
+		{
+			mismatches++;
+		}
+	}
+	errors += TEST_VAL_REPORT(mismatches, 0);
+
+	return errors;
+}
+
+
+/*
+ * Fills the grid with a reproducible random soup
+ */
+void fill_soup(LifeGrid &grid, unsigned seed, int percent_alive)
+{
+	for(int y = 0; y < grid.get_grid_height(); y++)
+	{
+		for(int x = 0; x < grid.get_grid_width(); x++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			const int roll = static_cast<int>((seed >> 16) % 100);
+			grid.set_cell(x, y, roll < percent_alive ? ALIVE : DEAD);
+		}
+	}
+}
+
+/*
+ * Counts the cells that differ between the grids
+ */
+int count_differences(const LifeGrid &a, const LifeGrid &b)
+{
+	int differences = 0;
+	for(int y = 0; y < a.get_grid_height(); y++)
+	{
+		for(int x = 0; x < a.get_grid_width(); x++)
+		{
+			if(a.get_cell(x, y) != b.get_cell(x, y))
+			{
+				differences++;
+			}
+		}
+	}
+	return differences;
+}
+
+/*
+ * Steps a soup with both engines and counts the differences
+ */
+int compare_engines(GridEngine engine, int width, int height, bool wrap, int generations, LifeRule rule = conway_rule)
+{
+	LifeGrid reference{3};
+	reference.set_engine(KERNEL_ENGINE);
+	reference.set_rule(rule);
+	reference.resize_grid(width, height);
+	reference.set_wrap_grid(wrap);
+	fill_soup(reference, static_cast<unsigned>(width * 31 + height), 35);
+
+	LifeGrid tested{3};
+	tested.set_engine(engine);
+	tested.set_rule(rule);
+	tested.resize_grid(width, height);
+	tested.set_wrap_grid(wrap);
+	fill_soup(tested, static_cast<unsigned>(width * 31 + height), 35);
+
+	int differences = count_differences(reference, tested);
+	for(int generation = 0; generation < generations; generation++)
+	{
+		reference.next_generation();
+		tested.next_generation();
+		differences += count_differences(reference, tested);
+	}
+	return differences;
+}
+
+
+/*
+ * The tests for the PACKED_ENGINE
+ */
+int test_packed_engine()
+{
+	int errors = 0;
+
+	errors += TEST_VAL_REPORT(compare_engines(PACKED_ENGINE, 14, 14, false, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(PACKED_ENGINE, 14, 14, true, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(PACKED_ENGINE, 64, 10, true, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(PACKED_ENGINE, 130, 37, false, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(PACKED_ENGINE, 130, 37, true, 20), 0);
+
+	{
+		// The glider must survive switching the engine back and forth
+		LifeGrid grid{10};
+		grid.create_glider();
+		grid.set_engine(KERNEL_ENGINE);
+		grid.next_generation();
+		grid.set_engine(PACKED_ENGINE);
+		grid.next_generation();
+
+		errors += TEST_VAL_REPORT(grid.get_cell(3, 2), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cell(1, 3), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cell(2, 2), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(3, 4), ALIVE);
+	}
+
+	return errors;
+}
+
+/*
+ * The tests for the SIMD row kernels, compared with the scalar one
+ */
+int test_row_kernels()
+{
+	int errors = 0;
+
+	for(RowKernel kernel : {SSE2_ROW_KERNEL, AVX2_ROW_KERNEL, AVX512_ROW_KERNEL})
+	{
+		if(!is_row_kernel_supported(kernel))
+		{
+			cout << "SKIP  - row kernel " << static_cast<int>(kernel) << " isn't supported by this CPU" << endl;
+			continue;
+		}
+
+		// Widths with every remainder of inner words for the eight word wide kernel
+		int mismatches = 0;
+		int statistics_mismatches = 0;
+		for(int width : {3, 64, 65, 200, 640, 700, 1000})
+		{
+			LifeGrid reference{3};
+			reference.set_row_kernel(SCALAR_ROW_KERNEL);
+			reference.resize_grid(width, 12);
+			reference.set_wrap_grid(true);
+			fill_soup(reference, static_cast<unsigned>(width), 40);
+
+			LifeGrid tested{3};
+			tested.set_row_kernel(kernel);
+			tested.resize_grid(width, 12);
+			tested.set_wrap_grid(true);
+			fill_soup(tested, static_cast<unsigned>(width), 40);
+
+			for(int generation = 0; generation < 8; generation++)
+			{
+				reference.next_generation();
+				tested.next_generation();
+				mismatches += count_differences(reference, tested);
+
+				// The births and deaths are counted by the kernels too
+				statistics_mismatches += reference.get_population() != tested.get_population();
+				statistics_mismatches += reference.get_births() != tested.get_births();
+				statistics_mismatches += reference.get_deaths() != tested.get_deaths();
+			}
+		}
+		errors += TEST_VAL_REPORT(mismatches, 0);
+		errors += TEST_VAL_REPORT(statistics_mismatches, 0);
+	}
+
+	errors += TEST_VAL_REPORT(is_row_kernel_supported(best_row_kernel()), true);
+
+	return errors;
+}
+
+/*
+ * Steps a soup on a single thread and with the worker pool, and counts the differences
+ */
+int compare_thread_counts(GridEngine engine, int thread_count, int width, int height, bool wrap)
+{
+	LifeGrid reference{3};
+	reference.set_engine(engine);
+	reference.resize_grid(width, height);
+	reference.set_wrap_grid(wrap);
+	fill_soup(reference, static_cast<unsigned>(height), 30);
+
+	LifeGrid tested{3};
+	tested.set_engine(engine);
+	tested.set_thread_count(thread_count);
+	tested.resize_grid(width, height);
+	tested.set_wrap_grid(wrap);
+	fill_soup(tested, static_cast<unsigned>(height), 30);
+
+	int differences = 0;
+	for(int generation = 0; generation < 10; generation++)
+	{
+		reference.next_generation();
+		tested.next_generation();
+		differences += count_differences(reference, tested);
+	}
+	return differences;
+}
+
+/*
+ * The tests for stepping the grid on multiple threads
+ */
+int test_threaded_stepping()
+{
+	int errors = 0;
+
+	{
+		LifeGrid grid{5};
+		errors += TEST_VAL_REPORT(grid.get_thread_count(), 1);
+		grid.set_thread_count(3);
+		errors += TEST_VAL_REPORT(grid.get_thread_count(), 3);
+		grid.set_thread_count(1);
+		errors += TEST_VAL_REPORT(grid.get_thread_count(), 1);
+	}
+
+	errors += TEST_VAL_REPORT(compare_thread_counts(PACKED_ENGINE, 4, 200, 131, false), 0);
+	errors += TEST_VAL_REPORT(compare_thread_counts(PACKED_ENGINE, 4, 200, 131, true), 0);
+	errors += TEST_VAL_REPORT(compare_thread_counts(PACKED_ENGINE, 3, 70, 9, true), 0);
+	errors += TEST_VAL_REPORT(compare_thread_counts(KERNEL_ENGINE, 4, 40, 53, false), 0);
+	errors += TEST_VAL_REPORT(compare_thread_counts(KERNEL_ENGINE, 4, 40, 53, true), 0);
+
+	return errors;
+}
+
+/*
+ * The tests for HashLife
+ */
+int test_hashlife()
+{
+	int errors = 0;
+
+	{
+		HashLife life;
+		life.set_cell(-1000, 5, ALIVE);
+		life.set_cell(3, -7, ALIVE);
+		errors += TEST_VAL_REPORT(life.get_cell(-1000, 5), ALIVE);
+		errors += TEST_VAL_REPORT(life.get_cell(3, -7), ALIVE);
+		errors += TEST_VAL_REPORT(life.get_cell(3, -6), DEAD);
+		errors += TEST_VAL_REPORT(life.get_population(), uint64_t{2});
+	}
+
+	// A soup in the middle of a grid big enough that nothing reaches the borders
+	LifeGrid reference{3};
+	reference.resize_grid(256, 256);
+	for(int y = 112; y < 144; y++)
+	{
+		for(int x = 112; x < 144; x++)
+		{
+			reference.set_cell(x, y, (x * 7 + y * 13) % 5 < 2 ? ALIVE : DEAD);
+		}
+	}
+
+	HashLife single_steps;
+	single_steps.load_grid(reference);
+	HashLife big_steps;
+	big_steps.load_grid(reference);
+	HashLife mixed_steps;
+	mixed_steps.load_grid(reference);
+
+	for(int generation = 0; generation < 64; generation++)
+	{
+		reference.next_generation();
+		single_steps.advance(1);
+	}
+	big_steps.advance_pow2(6);
+
+	LifeGrid result{3};
+	result.resize_grid(256, 256);
+
+	single_steps.store_grid(result);
+	errors += TEST_VAL_REPORT(count_differences(reference, result), 0);
+	big_steps.store_grid(result);
+	errors += TEST_VAL_REPORT(count_differences(reference, result), 0);
+	errors += TEST_VAL_REPORT(big_steps.get_generation(), uint64_t{64});
+
+	// The results kept over the changes of the step size are still right
+	mixed_steps.advance(13);
+	mixed_steps.advance_pow2(3);
+	mixed_steps.advance(30);
+	mixed_steps.advance_pow2(1);
+	mixed_steps.advance(11);
+	mixed_steps.store_grid(result);
+	errors += TEST_VAL_REPORT(count_differences(reference, result), 0);
+	errors += TEST_VAL_REPORT(mixed_steps.get_generation(), uint64_t{64});
+
+	{
+		// A blinker is back in the same nodes every other generation, a single step must not reuse the results of bigger ones
+		HashLife life;
+		life.set_cell(-1, 0, ALIVE);
+		life.set_cell(0, 0, ALIVE);
+		life.set_cell(1, 0, ALIVE);
+		life.advance_pow2(3);
+		life.advance(1);
+		errors += TEST_VAL_REPORT(life.get_cell(0, -1), ALIVE);
+		errors += TEST_VAL_REPORT(life.get_cell(-1, 0), DEAD);
+		life.advance(8);
+		errors += TEST_VAL_REPORT(life.get_cell(0, 1), ALIVE);
+		errors += TEST_VAL_REPORT(life.get_cell(1, 0), DEAD);
+	}
+
+	{
+		// A glider travels a cell diagonally every 4 generations, even a trillion of them
+		HashLife life;
+		life.set_cell(1, 0, ALIVE);
+		life.set_cell(2, 1, ALIVE);
+		life.set_cell(0, 2, ALIVE);
+		life.set_cell(1, 2, ALIVE);
+		life.set_cell(2, 2, ALIVE);
+		life.advance_pow2(40);
+
+		const int64_t distance = int64_t{1} << 38;
+		errors += TEST_VAL_REPORT(life.get_population(), uint64_t{5});
+		errors += TEST_VAL_REPORT(life.get_cell(distance + 1, distance), ALIVE);
+		errors += TEST_VAL_REPORT(life.get_cell(distance + 2, distance + 2), ALIVE);
+	}
+
+	{
+		// Collecting garbage all the time must not change the results
+		HashLife limited;
+		limited.set_memory_limit(1);
+		limited.load_grid(reference);
+		limited.advance(100);
+		limited.collect_garbage(false);
+
+		HashLife unlimited;
+		unlimited.load_grid(reference);
+		unlimited.advance(100);
+
+		int mismatches = 0;
+		unlimited.for_each_live_cell([&](int64_t x, int64_t y)
+		{
+			mismatches += limited.get_cell(x, y) == ALIVE ? 0 : 1;
+		});
+		errors += TEST_VAL_REPORT(mismatches, 0);
+		errors += TEST_VAL_REPORT(limited.get_population(), unlimited.get_population());
+	}
+
+	return errors;
+}
+
+/*
+ * The tests for SparsePlane
+ */
+int test_sparse_plane()
+{
+	int errors = 0;
+
+	{
+		// A lone cell dies, and takes its chunk with it
+		SparsePlane plane;
+		plane.set_cell(-1, -1, ALIVE);
+		errors += TEST_VAL_REPORT(plane.get_cell(-1, -1), ALIVE);
+		errors += TEST_VAL_REPORT(plane.get_chunk_count(), size_t{1});
+		plane.next_generation();
+		errors += TEST_VAL_REPORT(plane.get_population(), uint64_t{0});
+		errors += TEST_VAL_REPORT(plane.get_chunk_count(), size_t{0});
+	}
+
+	{
+		// A blinker on the corner of four chunks keeps blinking
+		SparsePlane plane;
+		plane.set_cell(-1, 0, ALIVE);
+		plane.set_cell(0, 0, ALIVE);
+		plane.set_cell(1, 0, ALIVE);
+		plane.next_generation();
+		errors += TEST_VAL_REPORT(plane.get_cell(0, -1), ALIVE);
+		errors += TEST_VAL_REPORT(plane.get_cell(0, 1), ALIVE);
+		errors += TEST_VAL_REPORT(plane.get_cell(-1, 0), DEAD);
+		errors += TEST_VAL_REPORT(plane.get_population(), uint64_t{3});
+	}
+
+	{
+		// An escaping soup must match HashLife, cell for cell
+		HashLife hashlife;
+		SparsePlane plane;
+		for(int y = -20; y < 20; y++)
+		{
+			for(int x = -20; x < 20; x++)
+			{
+				const CELL state = (x * 7 + y * 13 + x * y) % 5 < 2 ? ALIVE : DEAD;
+				hashlife.set_cell(x, y, state);
+				plane.set_cell(x, y, state);
+			}
+		}
+
+		for(int generation = 0; generation < 300; generation++)
+		{
+			plane.next_generation();
+		}
+		hashlife.advance(300);
+
+		int mismatches = 0;
+		hashlife.for_each_live_cell([&](int64_t x, int64_t y)
+		{
+			mismatches += plane.get_cell(x, y) == ALIVE ? 0 : 1;
+		});
+		errors += TEST_VAL_REPORT(mismatches, 0);
+		errors += TEST_VAL_REPORT(plane.get_population(), hashlife.get_population());
+	}
+
+	return errors;
+}
+
+/*
+ * The tests for skipping the tiles which can't change
+ */
+int test_active_tiles()
+{
+	int errors = 0;
+
+	for(bool wrap : {false, true})
+	{
+		// Soups settle down into still lifes and blinkers, edited every now and then
+		LifeGrid reference{3};
+		reference.set_engine(KERNEL_ENGINE);
+		reference.resize_grid(300, 100);
+		reference.set_wrap_grid(wrap);
+		fill_soup(reference, 77, 30);
+
+		LifeGrid tested{3};
+		tested.resize_grid(300, 100);
+		tested.set_wrap_grid(wrap);
+		fill_soup(tested, 77, 30);
+
+		int differences = 0;
+		for(int generation = 0; generation < 120; generation++)
+		{
+			if(generation % 40 == 39)
+			{
+				for(int i = 0; i < 5; i++)
+				{
+					const int x = (generation * 37 + i * 61) % 300;
+					const int y = (generation * 11 + i * 29) % 100;
+					reference.set_cell(x, y, ALIVE);
+					tested.set_cell(x, y, ALIVE);
+				}
+			}
+
+			reference.next_generation();
+			tested.next_generation();
+			differences += count_differences(reference, tested);
+		}
+		errors += TEST_VAL_REPORT(differences, 0);
+	}
+
+	{
+		// A lone block never changes, so after the first step nothing is stepped
+		LifeGrid grid{3};
+		grid.resize_grid(512, 512);
+		grid.set_cell(100, 100, ALIVE);
+		grid.set_cell(101, 100, ALIVE);
+		grid.set_cell(100, 101, ALIVE);
+		grid.set_cell(101, 101, ALIVE);
+		grid.next_generation();
+		errors += TEST_VAL_REPORT(grid.get_changed_tile_count(), size_t{0});
+
+		grid.set_cell(300, 300, ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_changed_tile_count(), size_t{1});
+		grid.next_generation();
+		errors += TEST_VAL_REPORT(grid.get_cell(300, 300), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(100, 100), ALIVE);
+
+		// The wrapped border sees new neighbours, so everything is stepped again
+		grid.set_wrap_grid(true);
+		errors += TEST_VAL_REPORT(grid.get_changed_tile_count() > 0, true);
+	}
+
+	return errors;
+}
+
+/*
+ * Counts the cells which differ from the glider of create_glider(), moved by the offset
+ */
+int count_glider_differences(const LifeGrid &grid, int offset_x, int offset_y)
+{
+	const int width = grid.get_grid_width();
+	const int height = grid.get_grid_height();
+	const int glider[5][2] = {{2, 1}, {3, 2}, {1, 3}, {2, 3}, {3, 3}};
+
+	int differences = 0;
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			CELL expected = DEAD;
+			for(const auto &cell : glider)
+			{
+				if((cell[0] + offset_x) % width == x && (cell[1] + offset_y) % height == y)
+				{
+					expected = ALIVE;
+				}
+			}
+
+			if(grid.get_cell(x, y) != expected)
+			{
+				differences++;
+			}
+		}
+	}
+	return differences;
+}
+
+/*
+ * The tests for the ghost border around the grid
+ */
+int test_ghost_border()
+{
+	int errors = 0;
+
+	for(GridEngine engine : {KERNEL_ENGINE, PACKED_ENGINE})
+	{
+		// The glider moves a cell diagonally every four generations, through the corner and back
+		for(int width : {10, 63, 64, 65})
+		{
+			LifeGrid grid{3};
+			grid.set_engine(engine);
+			grid.resize_grid(width, 12);
+			grid.set_wrap_grid(true);
+			grid.create_glider();
+
+			int mismatches = 0;
+			for(int moves = 1; moves <= 24; moves++)
+			{
+				for(int generation = 0; generation < 4; generation++)
+				{
+					grid.next_generation();
+				}
+				mismatches += count_glider_differences(grid, moves, moves);
+			}
+			errors += TEST_VAL_REPORT(mismatches, 0);
+		}
+
+		// A blinker on the left edge, the cells past it are either dead or on the right edge
+		for(bool wrap : {false, true})
+		{
+			LifeGrid grid{3};
+			grid.set_engine(engine);
+			grid.resize_grid(65, 6);
+			grid.set_wrap_grid(wrap);
+			grid.set_cell(0, 1, ALIVE);
+			grid.set_cell(0, 2, ALIVE);
+			grid.set_cell(0, 3, ALIVE);
+			grid.next_generation();
+
+			errors += TEST_VAL_REPORT(grid.get_cell(0, 2), ALIVE);
+			errors += TEST_VAL_REPORT(grid.get_cell(1, 2), ALIVE);
+			errors += TEST_VAL_REPORT(grid.get_cell(64, 2), wrap ? ALIVE : DEAD);
+			errors += TEST_VAL_REPORT(grid.get_cell(0, 1), DEAD);
+			errors += TEST_VAL_REPORT(grid.get_cell(0, 3), DEAD);
+		}
+	}
+
+	return errors;
+}
+
+/*
+ * The tests for reusing the grid buffers over clearing, resizing and stepping
+ */
+int test_buffer_reuse()
+{
+	int errors = 0;
+
+	for(GridEngine engine : {KERNEL_ENGINE, PACKED_ENGINE})
+	{
+		LifeGrid grid{3};
+		grid.set_engine(engine);
+		grid.resize_grid(100, 40);
+		fill_soup(grid, 7, 50);
+		grid.next_generation();
+
+		// Shrinking keeps the old buffers, none of the old cells may show up
+		grid.resize_grid(20, 10);
+		LifeGrid empty{3};
+		empty.resize_grid(20, 10);
+		errors += TEST_VAL_REPORT(count_differences(grid, empty), 0);
+
+		// The glider must not run into anything left in the back buffer either
+		grid.create_glider();
+		for(int generation = 0; generation < 8; generation++)
+		{
+			grid.next_generation();
+		}
+		errors += TEST_VAL_REPORT(count_glider_differences(grid, 2, 2), 0);
+
+		grid.clear_grid();
+		errors += TEST_VAL_REPORT(count_differences(grid, empty), 0);
+
+		grid.resize_grid(130, 37);
+		grid.set_wrap_grid(true);
+		fill_soup(grid, 130 * 31 + 37, 35);
+		LifeGrid reference{3};
+		reference.set_engine(KERNEL_ENGINE);
+		reference.resize_grid(130, 37);
+		reference.set_wrap_grid(true);
+		fill_soup(reference, 130 * 31 + 37, 35);
+
+		int differences = 0;
+		for(int generation = 0; generation < 10; generation++)
+		{
+			grid.next_generation();
+			reference.next_generation();
+			differences += count_differences(grid, reference);
+		}
+		errors += TEST_VAL_REPORT(differences, 0);
+	}
+
+	return errors;
+}
+
+/*
+ * Advances a soup with advance() and with next_generation(), and counts the differences
+ */
+int compare_advance(GridEngine engine, int thread_count, int width, int height, bool wrap, int generations)
+{
+	LifeGrid reference{3};
+	reference.set_engine(engine);
+	reference.resize_grid(width, height);
+	reference.set_wrap_grid(wrap);
+	fill_soup(reference, static_cast<unsigned>(width + height), 35);
+
+	LifeGrid tested{3};
+	tested.set_engine(engine);
+	tested.set_thread_count(thread_count);
+	tested.resize_grid(width, height);
+	tested.set_wrap_grid(wrap);
+	fill_soup(tested, static_cast<unsigned>(width + height), 35);
+
+	for(int generation = 0; generation < generations; generation++)
+	{
+		reference.next_generation();
+	}
+	tested.advance(generations);
+	int differences = count_differences(reference, tested);
+
+	// The active tiles must pick up where the blocked generations left off
+	reference.next_generation();
+	tested.next_generation();
+	differences += count_differences(reference, tested);
+
+	return differences;
+}
+
+/*
+ * The tests for advancing many generations at once
+ */
+int test_advance()
+{
+	int errors = 0;
+
+	for(bool wrap : {false, true})
+	{
+		errors += TEST_VAL_REPORT(compare_advance(KERNEL_ENGINE, 1, 30, 20, wrap, 5), 0);
+		errors += TEST_VAL_REPORT(compare_advance(PACKED_ENGINE, 1, 130, 37, wrap, 1), 0);
+		errors += TEST_VAL_REPORT(compare_advance(PACKED_ENGINE, 1, 130, 37, wrap, 21), 0);
+
+		// Fewer rows than the extra rows around a band, so the same rows show up many times
+		errors += TEST_VAL_REPORT(compare_advance(PACKED_ENGINE, 1, 70, 5, wrap, 8), 0);
+
+		// Wide enough to be split into several bands, on one and many threads
+		errors += TEST_VAL_REPORT(compare_advance(PACKED_ENGINE, 1, 4000, 600, wrap, 19), 0);
+		errors += TEST_VAL_REPORT(compare_advance(PACKED_ENGINE, 4, 4000, 600, wrap, 19), 0);
+	}
+
+	return errors;
+}
+
+/*
+ * The tests for the lookup tables and LOOKUP_ENGINE
+ */
+int test_lookup_engine()
+{
+	int errors = 0;
+
+	// Every 3x3 neighbourhood
+	int cell_mismatches = 0;
+	for(unsigned index = 0; index < 512; index++)
+	{
+		CellKernel kernel{DEAD};
+		for(int cell = 0; cell < 9; cell++)
+		{
+			kernel.cells[cell] = (index >> cell) & 1 ? ALIVE : DEAD;
+		}
+
+		if(cell_state_table[index] != kernel.compute_state())
+		{
+			cell_mismatches++;
+		}
+	}
+	errors += TEST_VAL_REPORT(cell_mismatches, 0);
+
+	// Every 4x4 block, the centre cells one at a time
+	int block_mismatches = 0;
+	for(unsigned index = 0; index < 65536; index++)
+	{
+		for(int x = 0; x < 2; x++)
+		{
+			for(int y = 0; y < 2; y++)
+			{
+				CellKernel kernel{DEAD};
+				for(int cell = 0; cell < 9; cell++)
+				{
+					const int block_x = x + cell % 3;
+					const int block_y = y + cell / 3;
+					kernel.cells[cell] = (index >> (4 * block_x + block_y)) & 1 ? ALIVE : DEAD;
+				}
+
+				const CELL expected = kernel.compute_state();
+				const CELL result = (block_state_table[index] >> (2 * x + y)) & 1 ? ALIVE : DEAD;
+				if(result != expected)
+				{
+					block_mismatches++;
+				}
+			}
+		}
+	}
+	errors += TEST_VAL_REPORT(block_mismatches, 0);
+
+	// Odd and even sizes, the odd ones have a row and a column left over from the blocks
+	errors += TEST_VAL_REPORT(compare_engines(LOOKUP_ENGINE, 14, 14, false, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(LOOKUP_ENGINE, 14, 14, true, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(LOOKUP_ENGINE, 3, 3, true, 5), 0);
+	errors += TEST_VAL_REPORT(compare_engines(LOOKUP_ENGINE, 65, 37, false, 20), 0);
+	errors += TEST_VAL_REPORT(compare_engines(LOOKUP_ENGINE, 65, 37, true, 20), 0);
+	errors += TEST_VAL_REPORT(compare_thread_counts(LOOKUP_ENGINE, 4, 101, 203, true), 0);
+
+	return errors;
+}
+
+/*
+ * Checks if parsing the rulestring throws std::invalid_argument
+ */
+bool is_invalid_rulestring(const std::string &rulestring)
+{
+	try
+	{
+		LifeRule rule{rulestring};
+	}
+	catch(const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+/*
+ * The tests for the Life-like rules
+ */
+int test_life_rules()
+{
+	int errors = 0;
+
+	errors += TEST_VAL_REPORT(LifeRule{"B3/S23"} == conway_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"b3s23"} == conway_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"S23/B3"} == conway_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"23/3"} == conway_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"B36/S23"} == highlife_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"B2/S"} == seeds_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"/2"} == seeds_rule, true);
+	errors += TEST_VAL_REPORT(day_and_night_rule.to_string(), std::string{"B3678/S34678"});
+	errors += TEST_VAL_REPORT(LifeRule{"B0/S8"}.to_string(), std::string{"B0/S8"});
+
+	errors += TEST_VAL_REPORT(is_invalid_rulestring(""), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B3"), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B9/S23"), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B3/S23/B4"), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B3x/S23"), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("23-3"), true);
+
+	{
+		// Seeds: the live cells always die, the pair gives birth above and below it
+		LifeGrid grid{10};
+		grid.set_rule("B2/S");
+		grid.set_cell(4, 5, ALIVE);
+		grid.set_cell(5, 5, ALIVE);
+		grid.next_generation();
+
+		errors += TEST_VAL_REPORT(grid.get_cell(4, 5), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(5, 5), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(4, 4), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cell(5, 6), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_rule() == seeds_rule, true);
+	}
+
+	// The rules with kernels of their own, and a few that read the masks at run time
+	const LifeRule rules[] = {
+		highlife_rule,
+		day_and_night_rule,
+		seeds_rule,
+		life_without_death_rule,
+		LifeRule{"B35678/S5678"},
+		LifeRule{"B0123478/S01234678"},
+		LifeRule{"B1/S1"},
+	};
+
+	for(const LifeRule &rule : rules)
+	{
+		int differences = 0;
+		for(GridEngine engine : {PACKED_ENGINE, LOOKUP_ENGINE})
+		{
+			differences += compare_engines(engine, 14, 14, false, 12, rule);
+			differences += compare_engines(engine, 130, 37, true, 12, rule);
+			differences += compare_engines(engine, 65, 11, false, 12, rule);
+		}
+		errors += TEST_VAL_REPORT(differences, 0);
+	}
+
+	{
+		// Changing the rule has to wake up the still tiles
+		LifeGrid reference{3};
+		reference.set_engine(KERNEL_ENGINE);
+		reference.resize_grid(300, 100);
+		fill_soup(reference, 3, 30);
+
+		LifeGrid tested{3};
+		tested.resize_grid(300, 100);
+		fill_soup(tested, 3, 30);
+
+		for(int generation = 0; generation < 200; generation++)
+		{
+			reference.next_generation();
+			tested.next_generation();
+		}
+		reference.set_rule(day_and_night_rule);
+		tested.set_rule(day_and_night_rule);
+		for(int generation = 0; generation < 5; generation++)
+		{
+			reference.next_generation();
+			tested.next_generation();
+		}
+		errors += TEST_VAL_REPORT(count_differences(reference, tested), 0);
+	}
+
+	return errors;
+}
+
+/*
+ * Changes the rule of a grid holding every state, down to fewer states and back up, and counts the cells
+ * that didn't keep their state or die. Followed by a few generations against the reference engine.
+ */
+int count_rule_change_errors(GridEngine engine)
+{
+	LifeGrid grid{3}, reference{3};
+	grid.set_engine(engine);
+	reference.set_engine(KERNEL_ENGINE);
+	std::vector<CELL> expected;
+	for(LifeGrid *target : {&grid, &reference})
+	{
+		target->set_rule(LifeRule{"B2/S/C7"});
+		target->resize_grid(130, 37);
+		target->set_wrap_grid(true);
+
+		expected.clear();
+		unsigned seed = 5;
+		for(int y = 0; y < 37; y++)
+		{
+			for(int x = 0; x < 130; x++)
+			{
+				seed = seed * 1103515245u + 12345u;
+				expected.push_back(static_cast<CELL>((seed >> 16) % 7));
+				target->set_cell(x, y, expected.back());
+			}
+		}
+	}
+
+	int errors = 0;
+	for(const LifeRule &rule : {LifeRule{"B2/S/C5"}, star_wars_rule, conway_rule, LifeRule{"B2/S/C256"}})
+	{
+		grid.set_rule(rule);
+		uint64_t population = 0;
+		for(int y = 0; y < 37; y++)
+		{
+			for(int x = 0; x < 130; x++)
+			{
+				CELL &state = expected[static_cast<size_t>(y * 130 + x)];
+				state = state < rule.states ? state : DEAD;
+				errors += grid.get_cell(x, y) != state;
+				population += state == ALIVE;
+			}
+		}
+		errors += grid.get_population() != population;
+	}
+
+	// The kept cells step like the reference, which changed the rule in one go
+	reference.set_rule(conway_rule);
+	reference.set_rule(LifeRule{"B2/S/C256"});
+	for(int generation = 0; generation < 5; generation++)
+	{
+		grid.next_generation();
+		reference.next_generation();
+	}
+	return errors + count_differences(grid, reference);
+}
+
+/*
+ * The tests for the multi-state Generations rules
+ */
+int test_generations_rules()
+{
+	int errors = 0;
+
+	errors += TEST_VAL_REPORT(LifeRule{"B2/S/C3"} == brians_brain_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"/2/3"} == brians_brain_rule, true);
+	errors += TEST_VAL_REPORT(LifeRule{"345/2/4"} == star_wars_rule, true);
+	errors += TEST_VAL_REPORT(star_wars_rule.to_string(), std::string{"B2/S345/C4"});
+	errors += TEST_VAL_REPORT(LifeRule{"B3/S23/C2"} == conway_rule, true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B2/S/C1"), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B2/S/C300"), true);
+	errors += TEST_VAL_REPORT(is_invalid_rulestring("B2/S/C"), true);
+
+	errors += TEST_VAL_REPORT(conway_rule.get_state_bits(), 1);
+	errors += TEST_VAL_REPORT(brians_brain_rule.get_state_bits(), 2);
+	errors += TEST_VAL_REPORT(star_wars_rule.get_state_bits(), 2);
+	errors += TEST_VAL_REPORT(LifeRule{"B2/S/C5"}.get_state_bits(), 3);
+	errors += TEST_VAL_REPORT(LifeRule{"B2/S/C256"}.get_state_bits(), 8);
+
+	for(GridEngine engine : {KERNEL_ENGINE, PACKED_ENGINE, LOOKUP_ENGINE})
+	{
+		// Brian's Brain: the pair starts dying, and gives birth above and below it
+		LifeGrid grid{10};
+		grid.set_engine(engine);
+		grid.set_rule(brians_brain_rule);
+		grid.set_cell(4, 5, ALIVE);
+		grid.set_cell(5, 5, ALIVE);
+		grid.next_generation();
+
+		errors += TEST_VAL_REPORT(static_cast<int>(grid.get_cell(4, 5)), 2);
+		errors += TEST_VAL_REPORT(static_cast<int>(grid.get_cell(5, 5)), 2);
+		errors += TEST_VAL_REPORT(grid.get_cell(4, 4), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cell(5, 6), ALIVE);
+
+		grid.next_generation();
+		errors += TEST_VAL_REPORT(grid.get_cell(4, 5), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(5, 5), DEAD);
+
+		// Dropping to two states kills the dying cells
+		grid.set_rule(conway_rule);
+		int dying = 0;
+		for(int y = 0; y < 10; y++)
+		{
+			for(int x = 0; x < 10; x++)
+			{
+				dying += grid.get_cell(x, y) > ALIVE ? 1 : 0;
+			}
+		}
+		errors += TEST_VAL_REPORT(dying, 0);
+	}
+
+	const LifeRule rules[] = {
+		brians_brain_rule,
+		star_wars_rule,
+		LifeRule{"B3/S23/C5"},
+		LifeRule{"B2/S/C7"},
+	};
+
+	for(const LifeRule &rule : rules)
+	{
+		int differences = 0;
+		for(GridEngine engine : {PACKED_ENGINE, LOOKUP_ENGINE})
+		{
+			differences += compare_engines(engine, 14, 14, false, 12, rule);
+			differences += compare_engines(engine, 130, 37, true, 12, rule);
+			differences += compare_engines(engine, 65, 11, false, 12, rule);
+		}
+		errors += TEST_VAL_REPORT(differences, 0);
+	}
+
+	for(GridEngine engine : {KERNEL_ENGINE, PACKED_ENGINE, LOOKUP_ENGINE})
+	{
+		errors += TEST_VAL_REPORT(count_rule_change_errors(engine), 0);
+	}
+
+	{
+		// The packed planes survive switching the engine back and forth
+		LifeGrid grid{3};
+		grid.set_rule(star_wars_rule);
+		grid.resize_grid(70, 20);
+		grid.set_cell(1, 1, static_cast<CELL>(3));
+		grid.set_cell(65, 2, static_cast<CELL>(2));
+		grid.set_cell(66, 2, ALIVE);
+		grid.set_engine(KERNEL_ENGINE);
+		grid.set_engine(PACKED_ENGINE);
+
+		errors += TEST_VAL_REPORT(static_cast<int>(grid.get_cell(1, 1)), 3);
+		errors += TEST_VAL_REPORT(static_cast<int>(grid.get_cell(65, 2)), 2);
+		errors += TEST_VAL_REPORT(grid.get_cell(66, 2), ALIVE);
+	}
+
+	return errors;
+}
+
+/*
+ * Checks if the Larger than Life rulestring is rejected
+ */
+bool is_invalid_ltl_rulestring(const std::string &rulestring)
+{
+	try
+	{
+		LtLRule rule{rulestring};
+	}
+	catch(const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Steps a Larger than Life grid and a naive reference summing the whole
+ * neighbourhood for each cell, and counts the differences
+ */
+int compare_larger_than_life(const LtLRule &rule, int width, int height, bool wrap, int generations)
+{
+	LifeGrid soup{3};
+	soup.resize_grid(width, height);
+	fill_soup(soup, static_cast<unsigned>(width * 17 + height), 40);
+
+	LargerThanLife tested;
+	tested.set_rule(rule);
+	tested.set_wrap_grid(wrap);
+	tested.load_grid(soup);
+
+	std::vector<CELL> reference(static_cast<size_t>(width * height));
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			reference[static_cast<size_t>(y * width + x)] = tested.get_cell(x, y);
+		}
+	}
+
+	int differences = 0;
+	for(int generation = 0; generation < generations; generation++)
+	{
+		std::vector<CELL> next(reference.size());
+		for(int y = 0; y < height; y++)
+		{
+			for(int x = 0; x < width; x++)
+			{
+				int count = 0;
+				for(int dy = -rule.radius; dy <= rule.radius; dy++)
+				{
+					for(int dx = -rule.radius; dx <= rule.radius; dx++)
+					{
+						if(dx == 0 && dy == 0 && !rule.counts_middle)
+						{
+							continue;
+						}
+						int nx = x + dx;
+						int ny = y + dy;
+						if(wrap)
+						{
+							nx = ((nx % width) + width) % width;
+							ny = ((ny % height) + height) % height;
+						}
+						else if(nx < 0 || nx >= width || ny < 0 || ny >= height)
+						{
+							continue;
+						}
+						count += reference[static_cast<size_t>(ny * width + nx)] == ALIVE ? 1 : 0;
+					}
+				}
+
+				const CELL state = reference[static_cast<size_t>(y * width + x)];
+				CELL next_state;
+				if(state == DEAD)
+				{
+					next_state = count >= rule.birth_min && count <= rule.birth_max ? ALIVE : DEAD;
+				}
+				else if(state == ALIVE && count >= rule.survival_min && count <= rule.survival_max)
+				{
+					next_state = ALIVE;
+				}
+				else
+				{
+					next_state = state + 1 < rule.states ? static_cast<CELL>(state + 1) : DEAD;
+				}
+				next[static_cast<size_t>(y * width + x)] = next_state;
+			}
+		}
+		reference.swap(next);
+		tested.next_generation();
+
+		for(int y = 0; y < height; y++)
+		{
+			for(int x = 0; x < width; x++)
+			{
+				differences += tested.get_cell(x, y) != reference[static_cast<size_t>(y * width + x)] ? 1 : 0;
+			}
+		}
+	}
+	return differences;
+}
+
+/*
+ * The tests for the Larger than Life engine
+ */
+int test_larger_than_life()
+{
+	int errors = 0;
+
+	errors += TEST_VAL_REPORT(LtLRule{"R5,C0,M1,S34..58,B34..45,NM"} == bosco_rule, true);
+	errors += TEST_VAL_REPORT(LtLRule{"r5,c2,m1,s34..58,b34..45"} == bosco_rule, true);
+	errors += TEST_VAL_REPORT(bosco_rule.to_string(), std::string{"R5,C0,M1,S34..58,B34..45,NM"});
+	errors += TEST_VAL_REPORT(LtLRule{"R2,C4,M0,S3..8,B4..6,NM"}.to_string(), std::string{"R2,C4,M0,S3..8,B4..6,NM"});
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring(""), true);
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring("R0,C0,M1,S1..2,B1..2,NM"), true);
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring("R501,C0,M1,S1..2,B1..2,NM"), true);
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring("R5,C0,M1,S34..58,NM"), true);
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring("R5,C0,M1,S34,B34..45,NM"), true);
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring("R5,C0,M1,S34..58,B34..45,NN"), true);
+	errors += TEST_VAL_REPORT(is_invalid_ltl_rulestring("R5,C300,M1,S34..58,B34..45,NM"), true);
+
+	// Radius 1 without the middle cell is Conway's Life
+	for(bool wrap : {false, true})
+	{
+		LifeGrid reference{3};
+		reference.set_engine(KERNEL_ENGINE);
+		reference.resize_grid(40, 27);
+		reference.set_wrap_grid(wrap);
+		fill_soup(reference, 1234, 35);
+
+		LargerThanLife tested;
+		tested.set_rule(LtLRule{"R1,C0,M0,S2..3,B3..3,NM"});
+		tested.set_wrap_grid(wrap);
+		tested.load_grid(reference);
+
+		LifeGrid result{3};
+		result.resize_grid(40, 27);
+		for(int generation = 0; generation < 20; generation++)
+		{
+			reference.next_generation();
+			tested.next_generation();
+		}
+		tested.store_grid(result);
+		errors += TEST_VAL_REPORT(count_differences(reference, result), 0);
+	}
+
+	for(bool wrap : {false, true})
+	{
+		errors += TEST_VAL_REPORT(compare_larger_than_life(bosco_rule, 40, 33, wrap, 6), 0);
+		errors += TEST_VAL_REPORT(compare_larger_than_life(LtLRule{"R2,C4,M0,S3..8,B4..6,NM"}, 31, 22, wrap, 8), 0);
+		errors += TEST_VAL_REPORT(compare_larger_than_life(LtLRule{"R10,C0,M1,S100..200,B90..150,NM"}, 45, 41, wrap, 3), 0);
+	}
+
+	// The neighbourhood wraps around more than once when it is larger than the grid
+	errors += TEST_VAL_REPORT(compare_larger_than_life(LtLRule{"R10,C0,M1,S150..250,B120..200,NM"}, 15, 15, true, 3), 0);
+
+	return errors;
+}
+
+/*
+ * Reads the pattern from the string into the grid
+ */
+PatternInfo read_pattern_string(const std::string &text, PatternFormat format, LifeGrid &grid, int x=0, int y=0)
+{
+	std::istringstream stream{text};
+	return read_pattern(stream, format, grid, x, y);
+}
+
+/*
+ * Checks if the pattern is rejected
+ */
+bool is_invalid_pattern(const std::string &text, PatternFormat format)
+{
+	LifeGrid grid{10};
+	try
+	{
+		read_pattern_string(text, format, grid);
+	}
+	catch(const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Writes a soup in the format and reads it back, counting the differences
+ */
+int compare_pattern_round_trip(PatternFormat format, GridEngine engine, const LifeRule &rule)
+{
+	LifeGrid written{3};
+	written.set_engine(engine);
+	written.set_rule(rule);
+	written.resize_grid(130, 37);
+	fill_soup(written, 77, 35);
+	for(int step = 0; step < 3; step++)
+	{
+		written.next_generation();
+	}
+
+	std::ostringstream stream;
+	write_pattern(stream, format, written);
+
+	LifeGrid read{3};
+	read.set_engine(engine);
+	read.resize_grid(130, 37);
+	read_pattern_string(stream.str(), format, read);
+
+	return count_differences(written, read);
+}
+
+/*
+ * The tests for the pattern readers and writers
+ */
+int test_pattern_io()
+{
+	int errors = 0;
+
+	errors += TEST_VAL_REPORT(pattern_format_from_path("glider.rle"), RLE_FORMAT);
+	errors += TEST_VAL_REPORT(pattern_format_from_path("dir.x/Glider.RLE"), RLE_FORMAT);
+	errors += TEST_VAL_REPORT(pattern_format_from_path("glider.lif"), LIFE_106_FORMAT);
+	errors += TEST_VAL_REPORT(pattern_format_from_path("glider.cells"), PLAINTEXT_FORMAT);
+
+	for(GridEngine engine : {KERNEL_ENGINE, PACKED_ENGINE})
+	{
+		// The same glider in all the formats
+		const std::pair<std::string, PatternFormat> gliders[] = {
+			{"#N Glider\n#C A comment\nx = 3, y = 3, rule = B3/S23\nbo$2bo$3o!\n", RLE_FORMAT},
+			{"#Life 1.06\n1 0\n2 1\n0 2\n1 2\n2 2\n", LIFE_106_FORMAT},
+			{"!Name: Glider\n!\n.O\n..O\r\nOOO", PLAINTEXT_FORMAT},
+		};
+
+		for(const auto &glider : gliders)
+		{
+			LifeGrid grid{10};
+			grid.set_engine(engine);
+			read_pattern_string(glider.first, glider.second, grid, 2, 3);
+			errors += TEST_VAL_REPORT(count_glider_differences(grid, 1, 2), 0);
+
+			std::istringstream stream{glider.first};
+			const PatternInfo info = measure_pattern(stream, glider.second);
+			errors += TEST_VAL_REPORT(info.width, 3);
+			errors += TEST_VAL_REPORT(info.height, 3);
+		}
+
+		// Runs crossing the word boundaries of the packed rows
+		LifeGrid grid{3};
+		grid.set_engine(engine);
+		grid.resize_grid(200, 3);
+		read_pattern_string("x = 200, y = 2\n5b150o$60bo3b2o!", RLE_FORMAT, grid);
+		int population = 0;
+		for(int y = 0; y < 3; y++)
+		{
+			for(int x = 0; x < 200; x++)
+			{
+				population += grid.get_cell(x, y) == ALIVE ? 1 : 0;
+			}
+		}
+		errors += TEST_VAL_REPORT(population, 153);
+		errors += TEST_VAL_REPORT(grid.get_cell(4, 0), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(5, 0), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cell(154, 0), ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cell(155, 0), DEAD);
+		errors += TEST_VAL_REPORT(grid.get_cell(64, 1), ALIVE);
+
+		// The cells outside the grid are dropped
+		LifeGrid small{5};
+		small.set_engine(engine);
+		read_pattern_string("x = 10, y = 1\n10o!", RLE_FORMAT, small, -3, 4);
+		errors += TEST_VAL_REPORT(small.get_cell(0, 4), ALIVE);
+		errors += TEST_VAL_REPORT(small.get_cell(4, 4), ALIVE);
+		errors += TEST_VAL_REPORT(small.get_cell(0, 3), DEAD);
+
+		for(PatternFormat format : {RLE_FORMAT, LIFE_106_FORMAT, PLAINTEXT_FORMAT})
+		{
+			errors += TEST_VAL_REPORT(compare_pattern_round_trip(format, engine, conway_rule), 0);
+		}
+		errors += TEST_VAL_REPORT(compare_pattern_round_trip(RLE_FORMAT, engine, star_wars_rule), 0);
+	}
+
+	{
+		// The rule comes from the header
+		LifeGrid grid{10};
+		read_pattern_string("x = 2, y = 1, rule = B2/S345/C4\nAC!", RLE_FORMAT, grid);
+		errors += TEST_VAL_REPORT(grid.get_rule() == star_wars_rule, true);
+		errors += TEST_VAL_REPORT(grid.get_cell(0, 0), ALIVE);
+		errors += TEST_VAL_REPORT(static_cast<int>(grid.get_cell(1, 0)), 3);
+	}
+
+	{
+		// Life 1.06 allows negative coordinates
+		std::istringstream stream{"#Life 1.06\n-5 -2\n3 4\n"};
+		const PatternInfo info = measure_pattern(stream, LIFE_106_FORMAT);
+		errors += TEST_VAL_REPORT(info.min_x, -5);
+		errors += TEST_VAL_REPORT(info.min_y, -2);
+		errors += TEST_VAL_REPORT(info.width, 9);
+		errors += TEST_VAL_REPORT(info.height, 7);
+	}
+
+	{
+		// The RLE lines are wrapped at 70 characters
+		LifeGrid grid{3};
+		grid.resize_grid(300, 2);
+		for(int x = 0; x < 300; x += 2)
+		{
+			grid.set_cell(x, 0, ALIVE);
+		}
+		std::ostringstream stream;
+		write_pattern(stream, RLE_FORMAT, grid);
+
+		std::istringstream lines{stream.str()};
+		std::string line;
+		size_t longest = 0;
+		while(std::getline(lines, line))
+		{
+			longest = std::max(longest, line.size());
+		}
+		errors += TEST_VAL_REPORT(longest <= 70, true);
+	}
+
+	errors += TEST_VAL_REPORT(is_invalid_pattern("bo$2bo$3o!", RLE_FORMAT), true);
+	errors += TEST_VAL_REPORT(is_invalid_pattern("x = 3, y = 3\nbo$2bz$3o!", RLE_FORMAT), true);
+	errors += TEST_VAL_REPORT(is_invalid_pattern("x = 3, y = 3\nbo$2bC!", RLE_FORMAT), true);
+	errors += TEST_VAL_REPORT(is_invalid_pattern("#Life 1.06\n1 x\n", LIFE_106_FORMAT), true);
+	errors += TEST_VAL_REPORT(is_invalid_pattern(".O.\n.X.\n", PLAINTEXT_FORMAT), true);
+
+	return errors;
+}
+
+/*
+ * Checks if loading the snapshot is rejected
+ */
+bool is_invalid_snapshot(const std::string &path)
+{
+	LifeGrid grid{10};
+	try
+	{
+		load_snapshot(path, grid);
+	}
+	catch(const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+/*
+ * The tests for saving and restoring the snapshots
+ */
+int test_snapshot()
+{
+	int errors = 0;
+	const std::string path{"test_snapshot.snap"};
+
+	const LifeRule rules[] = {conway_rule, star_wars_rule, LifeRule{"B2/S/C7"}};
+	for(const LifeRule &rule : rules)
+	{
+		for(GridEngine saved_engine : {KERNEL_ENGINE, PACKED_ENGINE})
+		{
+			for(GridEngine loaded_engine : {KERNEL_ENGINE, PACKED_ENGINE})
+			{
+				LifeGrid saved{3};
+				saved.set_engine(saved_engine);
+				saved.set_rule(rule);
+				saved.resize_grid(130, 37);
+				saved.set_wrap_grid(true);
+				fill_soup(saved, 99, 35);
+				saved.advance(5);
+				save_snapshot(path, saved);
+
+				// Whatever the grid held before is replaced, rule and all
+				LifeGrid loaded{3};
+				loaded.set_engine(loaded_engine);
+				loaded.set_rule(rule == conway_rule ? star_wars_rule : conway_rule);
+				loaded.resize_grid(200, 50);
+				fill_soup(loaded, 7, 50);
+				load_snapshot(path, loaded);
+
+				errors += TEST_VAL_REPORT(loaded.get_grid_width(), 130);
+				errors += TEST_VAL_REPORT(loaded.get_grid_height(), 37);
+				errors += TEST_VAL_REPORT(loaded.get_wrap_grid(), true);
+				errors += TEST_VAL_REPORT(loaded.get_generation(), uint64_t{5});
+				errors += TEST_VAL_REPORT(loaded.get_rule() == rule, true);
+				errors += TEST_VAL_REPORT(count_differences(saved, loaded), 0);
+				errors += TEST_VAL_REPORT(loaded.get_population(), saved.get_population());
+
+				// The restored grid goes on like the saved one
+				saved.advance(7);
+				loaded.advance(7);
+				errors += TEST_VAL_REPORT(count_differences(saved, loaded), 0);
+				errors += TEST_VAL_REPORT(loaded.get_generation(), uint64_t{12});
+			}
+		}
+	}
+
+	{
+		std::ofstream file{path, std::ios::binary | std::ios::trunc};
+		file << "Not a snapshot, but long enough to hold a header. Not a snapshot at all.";
+	}
+	errors += TEST_VAL_REPORT(is_invalid_snapshot(path), true);
+
+	{
+		// Cut off in the middle of the rows
+		LifeGrid grid{100};
+		save_snapshot(path, grid);
+		std::ifstream in{path, std::ios::binary};
+		const std::string contents{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+		in.close();
+		std::ofstream out{path, std::ios::binary | std::ios::trunc};
+		out << contents.substr(0, contents.size() / 2);
+	}
+	errors += TEST_VAL_REPORT(is_invalid_snapshot(path), true);
+
+	std::remove(path.c_str());
+	return errors;
+}
+
+/*
+ * Copies the cells of the grid
+ */
+std::vector<CELL> copy_cells(const LifeGrid &grid)
+{
+	std::vector<CELL> cells;
+	for(int y = 0; y < grid.get_grid_height(); y++)
+	{
+		for(int x = 0; x < grid.get_grid_width(); x++)
+		{
+			cells.push_back(grid.get_cell(x, y));
+		}
+	}
+	return cells;
+}
+
+/*
+ * Records a soup, then plays it back in order and by seeking, counting the differences
+ */
+int compare_recording(GridEngine engine, const LifeRule &rule, const std::string &path)
+{
+	LifeGrid grid{3};
+	grid.set_engine(engine);
+	grid.set_rule(rule);
+	grid.resize_grid(130, 37);
+	grid.set_wrap_grid(true);
+	fill_soup(grid, 5, 35);
+
+	std::vector<std::vector<CELL>> frames;
+	{
+		Recorder recorder{path, grid, 10, 25};
+		for(int frame = 0; frame < 25; frame++)
+		{
+			recorder.record(grid);
+			frames.push_back(copy_cells(grid));
+			grid.next_generation();
+		}
+	}
+
+	int differences = 0;
+	RecordingPlayer player{path};
+	differences += player.get_frame_count() == 25 ? 0 : 1;
+
+	LifeGrid played{3};
+	played.set_engine(engine);
+	for(const auto &frame : frames)
+	{
+		differences += player.read_frame(played) ? 0 : 1;
+		differences += copy_cells(played) != frame ? 1 : 0;
+	}
+	differences += player.read_frame(played) ? 1 : 0;
+	differences += played.get_wrap_grid() ? 0 : 1;
+	differences += played.get_rule() == rule ? 0 : 1;
+
+	for(uint64_t frame : {17, 3, 24, 0, 9, 10, 11})
+	{
+		player.seek(frame);
+		player.read_frame(played);
+		differences += copy_cells(played) != frames[frame] ? 1 : 0;
+		differences += played.get_generation() == frame ? 0 : 1;
+	}
+	return differences;
+}
+
+/*
+ * The tests for recording and playing back the generations
+ */
+int test_recorder()
+{
+	int errors = 0;
+	const std::string path{"test_recording.rec"};
+
+	errors += TEST_VAL_REPORT(compare_recording(PACKED_ENGINE, conway_rule, path), 0);
+	errors += TEST_VAL_REPORT(compare_recording(KERNEL_ENGINE, conway_rule, path), 0);
+	errors += TEST_VAL_REPORT(compare_recording(PACKED_ENGINE, star_wars_rule, path), 0);
+
+	{
+		// A recording cut short still plays up to the last whole frame
+		std::ifstream in{path, std::ios::binary};
+		const std::string contents{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+		in.close();
+		std::ofstream out{path, std::ios::binary | std::ios::trunc};
+		out << contents.substr(0, contents.size() - sizeof(RecordingTrailer) - 3 * sizeof(uint64_t) - 12);
+		out.close();
+
+		RecordingPlayer player{path};
+		errors += TEST_VAL_REPORT(player.get_frame_count(), uint64_t{24});
+		player.seek(23);
+		LifeGrid grid{3};
+		errors += TEST_VAL_REPORT(player.read_frame(grid), true);
+		errors += TEST_VAL_REPORT(player.read_frame(grid), false);
+	}
+
+	{
+		// A writer falling behind gets the generations merged, but the frames it writes are right
+		LifeGrid grid{3};
+		grid.resize_grid(1000, 1000);
+		for(int blinker = 0; blinker < 10; blinker++)
+		{
+			grid.set_cell(blinker * 97 + 5, blinker * 89 + 5, ALIVE);
+			grid.set_cell(blinker * 97 + 6, blinker * 89 + 5, ALIVE);
+			grid.set_cell(blinker * 97 + 7, blinker * 89 + 5, ALIVE);
+		}
+
+		// The blinkers have a period of two
+		std::vector<std::vector<CELL>> phases;
+		for(int phase = 0; phase < 2; phase++)
+		{
+			phases.push_back(copy_cells(grid));
+			grid.next_generation();
+		}
+		{
+			Recorder recorder{path, grid, 7, 1};
+			std::vector<unsigned char> changed;
+			for(int frame = 0; frame < 1000; frame++)
+			{
+				recorder.record(grid);
+				grid.next_generation();
+
+				// The view collecting the changes too doesn't take them from the recorder
+				grid.collect_changed_tiles(changed);
+			}
+		}
+
+		RecordingPlayer player{path};
+		LifeGrid played{3};
+		int differences = 0;
+		uint64_t last_generation = 0;
+		for(uint64_t frame = 0; frame < player.get_frame_count(); frame++)
+		{
+			player.read_frame(played);
+			differences += frame > 0 && played.get_generation() <= last_generation ? 1 : 0;
+			differences += copy_cells(played) != phases[played.get_generation() % 2] ? 1 : 0;
+			last_generation = played.get_generation();
+		}
+		errors += TEST_VAL_REPORT(differences, 0);
+		errors += TEST_VAL_REPORT(last_generation, uint64_t{1001});
+	}
+
+	{
+		// The unchanged frames of a still life cost a few bytes each
+		LifeGrid grid{3};
+		grid.resize_grid(1000, 1000);
+		grid.set_cell(10, 10, ALIVE);
+		grid.set_cell(11, 10, ALIVE);
+		grid.set_cell(10, 11, ALIVE);
+		grid.set_cell(11, 11, ALIVE);
+		{
+			Recorder recorder{path, grid, 1000};
+			for(int frame = 0; frame < 100; frame++)
+			{
+				recorder.record(grid);
+				grid.next_generation();
+			}
+		}
+		std::ifstream in{path, std::ios::binary | std::ios::ate};
+		errors += TEST_VAL_REPORT(static_cast<long>(in.tellg()) < 4000, true);
+
+		// The size can't change during the recording
+		Recorder recorder{path, grid};
+		grid.resize_grid(20, 20);
+		bool threw = false;
+		try
+		{
+			recorder.record(grid);
+		}
+		catch(const std::invalid_argument &)
+		{
+			threw = true;
+		}
+		errors += TEST_VAL_REPORT(threw, true);
+	}
+
+	std::remove(path.c_str());
+	return errors;
+}
+
+int find_cycle_period(LifeGrid &grid, int max_generations)
+{
+	for(int generation = 0; generation < max_generations && grid.get_cycle_period() == 0; generation++)
+	{
+		grid.next_generation();
+	}
+	return grid.get_cycle_period();
+}
+
+void add_pulsar(LifeGrid &grid, int x, int y)
+{
+	for(int a : {2, 3, 4, 8, 9, 10})
+	{
+		for(int b : {0, 5, 7, 12})
+		{
+			grid.set_cell(x + a, y + b, ALIVE);
+			grid.set_cell(x + b, y + a, ALIVE);
+		}
+	}
+}
+
+int compare_cycle_skipping(GridEngine engine, int width, int height, bool wrap, int generations)
+{
+	LifeGrid detected{3}, stepped{3};
+	for(LifeGrid *grid : {&detected, &stepped})
+	{
+		grid->set_engine(engine);
+		grid->resize_grid(width, height);
+		grid->set_wrap_grid(wrap);
+		fill_soup(*grid, 11, 35);
+	}
+	detected.set_cycle_detection(64);
+
+	detected.advance(generations);
+	for(int generation = 0; generation < generations; generation++)
+	{
+		stepped.next_generation();
+	}
+
+	if(detected.get_generation() != stepped.get_generation())
+	{
+		return -1;
+	}
+	return count_differences(detected, stepped);
+}
+
+int test_cycle_detection()
+{
+	int errors = 0;
+
+	for(GridEngine engine : {PACKED_ENGINE, KERNEL_ENGINE, LOOKUP_ENGINE})
+	{
+		LifeGrid grid{3};
+		grid.set_engine(engine);
+		grid.resize_grid(70, 40);
+		grid.set_cycle_detection(100);
+
+		// An empty grid is a still life
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 10), 1);
+
+		grid.clear_grid();
+		grid.set_cell(68, 10, ALIVE);
+		grid.set_cell(69, 10, ALIVE);
+		grid.set_cell(68, 11, ALIVE);
+		grid.set_cell(69, 11, ALIVE);
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 10), 1);
+
+		// A blinker next to the block
+		grid.set_cell(5, 5, ALIVE);
+		grid.set_cell(5, 6, ALIVE);
+		grid.set_cell(5, 7, ALIVE);
+		errors += TEST_VAL_REPORT(grid.get_cycle_period(), 0);
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 10), 2);
+
+		// The blinker and the pulsar line up every 6 generations
+		add_pulsar(grid, 20, 20);
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 10), 6);
+
+		grid.clear_grid();
+		add_pulsar(grid, 20, 20);
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 10), 3);
+
+		// The pulsar's period is longer than looked for
+		grid.set_cycle_detection(2);
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 10), 0);
+
+		// A glider on a wrapped grid comes back to where it started
+		grid.clear_grid();
+		grid.resize_grid(70, 70);
+		grid.set_wrap_grid(true);
+		grid.set_cycle_detection(300);
+		grid.set_cell(1, 0, ALIVE);
+		grid.set_cell(2, 1, ALIVE);
+		grid.set_cell(0, 2, ALIVE);
+		grid.set_cell(1, 2, ALIVE);
+		grid.set_cell(2, 2, ALIVE);
+		errors += TEST_VAL_REPORT(find_cycle_period(grid, 300), 280);
+	}
+
+	// advance() steps the packed grid in blocks, and finds the period from the generations between them
+	{
+		LifeGrid grid{3};
+		grid.resize_grid(70, 40);
+		grid.set_cycle_detection(100);
+		grid.set_cell(5, 5, ALIVE);
+		grid.set_cell(5, 6, ALIVE);
+		grid.set_cell(5, 7, ALIVE);
+		add_pulsar(grid, 20, 20);
+		grid.advance(100);
+		errors += TEST_VAL_REPORT(grid.get_cycle_period(), 6);
+		errors += TEST_VAL_REPORT(grid.get_generation(), uint64_t{100});
+
+		grid.clear_grid();
+		grid.resize_grid(70, 70);
+		grid.set_wrap_grid(true);
+		grid.set_cycle_detection(300);
+		grid.set_cell(1, 0, ALIVE);
+		grid.set_cell(2, 1, ALIVE);
+		grid.set_cell(0, 2, ALIVE);
+		grid.set_cell(1, 2, ALIVE);
+		grid.set_cell(2, 2, ALIVE);
+		grid.advance(1000);
+		errors += TEST_VAL_REPORT(grid.get_cycle_period(), 280);
+
+		// The pulsar's period is longer than looked for, the blocks go on after the check
+		grid.clear_grid();
+		grid.set_cycle_detection(2);
+		add_pulsar(grid, 20, 20);
+		grid.advance(100);
+		errors += TEST_VAL_REPORT(grid.get_cycle_period(), 0);
+	}
+
+	for(bool wrap : {false, true})
+	{
+		// The soups settle well before the end, so most generations are skipped
+		errors += TEST_VAL_REPORT(compare_cycle_skipping(PACKED_ENGINE, 130, 37, wrap, 5000), 0);
+		errors += TEST_VAL_REPORT(compare_cycle_skipping(KERNEL_ENGINE, 30, 20, wrap, 1001), 0);
+
+		// Too big to settle, so nothing is skipped
+		errors += TEST_VAL_REPORT(compare_cycle_skipping(PACKED_ENGINE, 500, 300, wrap, 50), 0);
+	}
+
+	return errors;
+}
+
+int count_statistics_errors(const LifeGrid &grid, const std::vector<CELL> &before)
+{
+	const std::vector<CELL> after = copy_cells(grid);
+	const int width = grid.get_grid_width();
+	const int height = grid.get_grid_height();
+
+	uint64_t population = 0;
+	uint64_t births = 0;
+	uint64_t deaths = 0;
+	int min_x = width, min_y = height, max_x = -1, max_y = -1;
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			const size_t index = static_cast<size_t>(y * width + x);
+			population += after[index] == ALIVE;
+			if(!before.empty())
+			{
+				births += after[index] == ALIVE && before[index] != ALIVE;
+				deaths += after[index] != ALIVE && before[index] == ALIVE;
+			}
+			if(after[index] != DEAD)
+			{
+				min_x = std::min(min_x, x);
+				min_y = std::min(min_y, y);
+				max_x = std::max(max_x, x);
+				max_y = std::max(max_y, y);
+			}
+		}
+	}
+
+	int errors = grid.get_population() != population;
+	if(!before.empty())
+	{
+		errors += grid.get_births() != births;
+		errors += grid.get_deaths() != deaths;
+	}
+
+	int box_min_x = -1, box_min_y = -1, box_max_x = -1, box_max_y = -1;
+	const bool found = grid.get_bounding_box(box_min_x, box_min_y, box_max_x, box_max_y);
+	errors += found != (max_x >= 0);
+	if(found)
+	{
+		errors += box_min_x != min_x || box_min_y != min_y || box_max_x != max_x || box_max_y != max_y;
+	}
+	return errors;
+}
+
+void setup_statistics_grid(LifeGrid &grid, GridEngine engine, const LifeRule &rule, int width, int height, bool wrap)
+{
+	grid.set_engine(engine);
+	grid.set_rule(rule);
+	grid.resize_grid(width, height);
+	grid.set_wrap_grid(wrap);
+
+	// A soup in the middle, so that the edges of the bounding box move around
+	for(int y = height / 3; y < height * 2 / 3; y++)
+	{
+		for(int x = width / 3; x < width * 2 / 3; x++)
+		{
+			const unsigned hash = static_cast<unsigned>(x) * 73856093u ^ static_cast<unsigned>(y) * 19349663u;
+			grid.set_cell(x, y, hash % 3 == 0 ? ALIVE : DEAD);
+		}
+	}
+}
+
+int compare_statistics(GridEngine engine, const LifeRule &rule, int width, int height, bool wrap, int generations)
+{
+	LifeGrid grid{3};
+	setup_statistics_grid(grid, engine, rule, width, height, wrap);
+
+	int errors = count_statistics_errors(grid, {});
+	for(int generation = 0; generation < generations; generation++)
+	{
+		const std::vector<CELL> before = copy_cells(grid);
+		grid.next_generation();
+		errors += count_statistics_errors(grid, before);
+	}
+
+	// The edits count towards the population, but not the births and deaths
+	grid.set_cell(1, 1, ALIVE);
+	grid.set_cell_run(0, height - 1, width, ALIVE);
+	grid.set_cell(width / 2, height / 2, DEAD);
+	errors += count_statistics_errors(grid, {});
+
+	// The tiles may be counted only when asked for, the edits in between have to find them right
+	for(int generation = 0; generation < 5; generation++)
+	{
+		grid.next_generation();
+	}
+	grid.set_cell(2, 2, ALIVE);
+	grid.set_cell(width / 2 + 1, height / 2, DEAD);
+	errors += count_statistics_errors(grid, {});
+
+	// advance() steps in blocks, but the births and deaths are still of the last generation
+	LifeGrid advanced{3}, stepped{3};
+	setup_statistics_grid(advanced, engine, rule, width, height, wrap);
+	setup_statistics_grid(stepped, engine, rule, width, height, wrap);
+	advanced.advance(generations);
+	for(int generation = 1; generation < generations; generation++)
+	{
+		stepped.next_generation();
+	}
+	errors += count_statistics_errors(advanced, copy_cells(stepped));
+
+	// The byte engines step by the tile counts, which have to be right after leaving the packed steps
+	LifeGrid switched{3}, packed{3};
+	setup_statistics_grid(switched, PACKED_ENGINE, rule, width, height, wrap);
+	setup_statistics_grid(packed, PACKED_ENGINE, rule, width, height, wrap);
+	for(int generation = 0; generation < 3; generation++)
+	{
+		switched.next_generation();
+		packed.next_generation();
+	}
+	switched.set_engine(engine == PACKED_ENGINE ? KERNEL_ENGINE : engine);
+	switched.next_generation();
+	packed.next_generation();
+	errors += count_differences(switched, packed);
+
+	return errors;
+}
+
+int test_statistics()
+{
+	int errors = 0;
+
+	for(bool wrap : {false, true})
+	{
+		for(GridEngine engine : {PACKED_ENGINE, KERNEL_ENGINE, LOOKUP_ENGINE})
+		{
+			errors += TEST_VAL_REPORT(compare_statistics(engine, conway_rule, 130, 97, wrap, 40), 0);
+			errors += TEST_VAL_REPORT(compare_statistics(engine, star_wars_rule, 70, 45, wrap, 30), 0);
+		}
+		errors += TEST_VAL_REPORT(compare_statistics(PACKED_ENGINE, conway_rule, 600, 300, wrap, 25), 0);
+	}
+
+	{
+		// An empty grid has no bounding box
+		LifeGrid grid{40};
+		int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+		errors += TEST_VAL_REPORT(grid.get_bounding_box(min_x, min_y, max_x, max_y), false);
+		errors += TEST_VAL_REPORT(grid.get_population(), uint64_t{0});
+
+		// The statistics follow the cells through the engine and rule changes, and set_row_bits()
+		grid.create_glider();
+		errors += TEST_VAL_REPORT(grid.get_population(), uint64_t{5});
+		grid.set_engine(KERNEL_ENGINE);
+		errors += TEST_VAL_REPORT(count_statistics_errors(grid, {}), 0);
+		grid.set_rule(star_wars_rule);
+		errors += TEST_VAL_REPORT(count_statistics_errors(grid, {}), 0);
+		grid.set_engine(PACKED_ENGINE);
+		const std::vector<uint64_t> row{~uint64_t{0}};
+		grid.set_row_bits(20, 0, row.data());
+		errors += TEST_VAL_REPORT(count_statistics_errors(grid, {}), 0);
+		errors += TEST_VAL_REPORT(grid.get_population(), uint64_t{45});
+
+		grid.clear_grid();
+		errors += TEST_VAL_REPORT(grid.get_population(), uint64_t{0});
+		errors += TEST_VAL_REPORT(grid.get_births(), uint64_t{0});
+	}
+
+	for(bool wrap : {false, true})
+	{
+		// The byte engines step only the rows around the cells when not wrapping. Gliders on an
+		// empty grid leave rows behind, which have to be cleared in the buffer swapped in.
+		for(GridEngine engine : {KERNEL_ENGINE, LOOKUP_ENGINE, PACKED_ENGINE})
+		{
+			LifeGrid reference{3}, tested{3};
+			reference.set_engine(PACKED_ENGINE);
+			tested.set_engine(engine);
+			int differences = 0;
+			for(LifeGrid *grid : {&reference, &tested})
+			{
+				grid->resize_grid(90, 200);
+				grid->set_wrap_grid(wrap);
+				for(int offset : {10, 100, 150})
+				{
+					grid->set_cell(offset + 1, offset + 0, ALIVE);
+					grid->set_cell(offset + 2, offset + 1, ALIVE);
+					grid->set_cell(offset + 0, offset + 2, ALIVE);
+					grid->set_cell(offset + 1, offset + 2, ALIVE);
+					grid->set_cell(offset + 2, offset + 2, ALIVE);
+				}
+			}
+			for(int generation = 0; generation < 300; generation++)
+			{
+				reference.next_generation();
+				tested.next_generation();
+				differences += count_differences(reference, tested);
+			}
+			errors += TEST_VAL_REPORT(differences, 0);
+		}
+	}
+
+	return errors;
+}
+
+int count_row_bits_errors(GridEngine engine, const LifeRule &rule, int width, int height)
+{
+	LifeGrid grid{3};
+	grid.set_engine(engine);
+	grid.set_rule(rule);
+	grid.resize_grid(width, height);
+	grid.set_wrap_grid(true);
+	fill_soup(grid, 3, 40);
+	for(int generation = 0; generation < 3; generation++)
+	{
+		grid.next_generation();
+	}
+
+	int errors = 0;
+	const int words_per_row = (width + 63) / 64;
+	std::vector<uint64_t> row(static_cast<size_t>(words_per_row));
+	std::vector<uint64_t> part(static_cast<size_t>(words_per_row));
+	for(int y = 0; y < height; y++)
+	{
+		for(int plane = 0; plane < rule.get_state_bits(); plane++)
+		{
+			grid.get_row_bits(y, plane, row.data());
+			for(int x = 0; x < words_per_row * 64; x++)
+			{
+				const uint64_t expected = x < width ? (grid.get_cell(x, y) >> plane) & 1 : 0;
+				errors += ((row[static_cast<size_t>(x / 64)] >> (x % 64)) & 1) != expected;
+			}
+
+			// The parts of the row are copied the same as the whole row
+			grid.get_row_bits(y, plane, 1, words_per_row, part.data());
+			errors += !std::equal(row.begin() + 1, row.end(), part.begin());
+			grid.get_row_bits(y, plane, 0, 1, part.data());
+			errors += part[0] != row[0];
+		}
+	}
+	return errors;
+}
+
+int test_row_bits()
+{
+	int errors = 0;
+
+	for(GridEngine engine : {PACKED_ENGINE, KERNEL_ENGINE})
+	{
+		errors += TEST_VAL_REPORT(count_row_bits_errors(engine, conway_rule, 200, 9), 0);
+		errors += TEST_VAL_REPORT(count_row_bits_errors(engine, star_wars_rule, 130, 11), 0);
+		errors += TEST_VAL_REPORT(count_row_bits_errors(engine, conway_rule, 64, 5), 0);
+	}
+
+	return errors;
+}
+
+int count_pyramid_errors(const LifeGrid &grid, const DensityPyramid &pyramid)
+{
+	// The levels counted from scratch, a block past the edges being empty
+	std::vector<uint64_t> level;
+	int width = grid.get_grid_width();
+	int height = grid.get_grid_height();
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			level.push_back(grid.get_cell(x, y) == ALIVE);
+		}
+	}
+
+	int errors = 0;
+	std::vector<uint8_t> shades;
+	for(int level_number = 1; ; level_number++)
+	{
+		const int below_width = width;
+		const int below_height = height;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		std::vector<uint64_t> above(static_cast<size_t>(width * height));
+		for(int y = 0; y < height; y++)
+		{
+			for(int x = 0; x < width; x++)
+			{
+				for(int block = 0; block < 4; block++)
+				{
+					const int block_x = 2 * x + block % 2;
+					const int block_y = 2 * y + block / 2;
+					if(block_x < below_width && block_y < below_height)
+					{
+						above[static_cast<size_t>(y * width + x)] += level[static_cast<size_t>(block_y * below_width + block_x)];
+					}
+				}
+			}
+		}
+		level = above;
+
+		if(level_number > pyramid.get_level_count())
+		{
+			return errors + 1;
+		}
+		errors += pyramid.get_level_width(level_number) != width;
+		errors += pyramid.get_level_height(level_number) != height;
+
+		// A block with any live cell stays visible however far it's zoomed out
+		const uint64_t block_cells = uint64_t{1} << (2 * level_number);
+		shades.resize(static_cast<size_t>(width));
+		for(int y = 0; y < height && errors == 0; y++)
+		{
+			pyramid.get_level_shades(level_number, y, 0, width, shades.data());
+			for(int x = 0; x < width; x++)
+			{
+				const uint64_t count = level[static_cast<size_t>(y * width + x)];
+				errors += pyramid.get_block_count(level_number, x, y) != count;
+				if(count == 0)
+				{
+					errors += shades[static_cast<size_t>(x)] != 0;
+				}
+				else
+				{
+					errors += shades[static_cast<size_t>(x)] < DensityPyramid::minimum_shade;
+					errors += count == block_cells && shades[static_cast<size_t>(x)] != 255;
+				}
+			}
+		}
+		if(width == 1 && height == 1)
+		{
+			return errors + (pyramid.get_level_count() != level_number);
+		}
+	}
+}
+
+void update_pyramid(LifeGrid &grid, GridFrame &frame, DensityPyramid &pyramid)
+{
+	std::vector<unsigned char> changed;
+	grid.collect_changed_tiles(changed);
+	frame.capture(grid, changed, frame.get_sequence() + 1);
+	pyramid.update(frame, frame.get_changed_tiles());
+}
+
+int compare_density_pyramid(GridEngine engine, const LifeRule &rule, int width, int height, int generations)
+{
+	LifeGrid grid{3};
+	grid.set_engine(engine);
+	grid.set_rule(rule);
+	grid.resize_grid(width, height);
+	fill_soup(grid, 5, 30);
+
+	DensityPyramid pyramid;
+	GridFrame frame;
+	update_pyramid(grid, frame, pyramid);
+	int errors = count_pyramid_errors(grid, pyramid);
+
+	// Only the changed tiles are counted again, through the steps and the edits in between
+	for(int generation = 0; generation < generations; generation++)
+	{
+		if(generation % 7 == 3)
+		{
+			grid.advance(5);
+		}
+		else
+		{
+			grid.next_generation();
+		}
+		if(generation % 4 == 1)
+		{
+			grid.set_cell((generation * 37) % width, (generation * 11) % height, ALIVE);
+		}
+
+		update_pyramid(grid, frame, pyramid);
+		errors += count_pyramid_errors(grid, pyramid);
+	}
+	return errors;
+}
+
+int test_density_pyramid()
+{
+	int errors = 0;
+
+	for(GridEngine engine : {PACKED_ENGINE, KERNEL_ENGINE, LOOKUP_ENGINE})
+	{
+		errors += TEST_VAL_REPORT(compare_density_pyramid(engine, conway_rule, 300, 70, 30), 0);
+		errors += TEST_VAL_REPORT(compare_density_pyramid(engine, star_wars_rule, 77, 41, 20), 0);
+	}
+
+	{
+		// A glider alone on a large grid changes a single tile at a time
+		LifeGrid grid{3};
+		grid.resize_grid(1000, 200);
+		DensityPyramid pyramid;
+		GridFrame frame;
+		grid.create_glider();
+		update_pyramid(grid, frame, pyramid);
+		grid.next_generation();
+		update_pyramid(grid, frame, pyramid);
+		const std::vector<unsigned char> &changed = frame.get_changed_tiles();
+		errors += TEST_VAL_REPORT(static_cast<int>(std::count(changed.begin(), changed.end(), 1)), 1);
+		errors += TEST_VAL_REPORT(count_pyramid_errors(grid, pyramid), 0);
+
+		// Nothing is handed over twice, and a resize starts over
+		update_pyramid(grid, frame, pyramid);
+		errors += TEST_VAL_REPORT(static_cast<int>(std::count(changed.begin(), changed.end(), 1)), 0);
+		grid.resize_grid(33, 17);
+		grid.create_glider();
+		update_pyramid(grid, frame, pyramid);
+		errors += TEST_VAL_REPORT(count_pyramid_errors(grid, pyramid), 0);
+		errors += TEST_VAL_REPORT(pyramid.get_level_count(), 6);
+	}
+
+	return errors;
+}
+
+int count_frame_errors(const LifeGrid &grid, const GridFrame &frame)
+{
+	int errors = 0;
+	errors += frame.get_grid_width() != grid.get_grid_width();
+	errors += frame.get_grid_height() != grid.get_grid_height();
+	errors += frame.get_generation() != grid.get_generation();
+	errors += frame.get_population() != grid.get_population();
+	errors += frame.get_states() != grid.get_rule().states;
+	for(int y = 0; y < grid.get_grid_height(); y++)
+	{
+		for(int x = 0; x < grid.get_grid_width(); x++)
+		{
+			errors += frame.get_cell(x, y) != grid.get_cell(x, y);
+		}
+	}
+
+	int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+	int frame_min_x = 0, frame_min_y = 0, frame_max_x = 0, frame_max_y = 0;
+	const bool has_box = grid.get_bounding_box(min_x, min_y, max_x, max_y);
+	errors += frame.get_bounding_box(frame_min_x, frame_min_y, frame_max_x, frame_max_y) != has_box;
+	errors += frame_min_x != min_x || frame_min_y != min_y || frame_max_x != max_x || frame_max_y != max_y;
+	return errors;
+}
+
+int test_grid_frame()
+{
+	int errors = 0;
+
+	for(GridEngine engine : {PACKED_ENGINE, KERNEL_ENGINE})
+	{
+		// The frame copies the cells within the bounding box, and the rest are dead
+		LifeGrid grid{3};
+		grid.set_engine(engine);
+		grid.set_rule(star_wars_rule);
+		grid.resize_grid(150, 40);
+		fill_soup(grid, 9, 30);
+		grid.next_generation();
+		grid.set_cell(149, 39, ALIVE);
+
+		GridFrame frame;
+		std::vector<unsigned char> changed;
+		grid.collect_changed_tiles(changed);
+		frame.capture(grid, changed, 1);
+		errors += TEST_VAL_REPORT(count_frame_errors(grid, frame), 0);
+
+		grid.clear_grid();
+		grid.set_cell(70, 20, ALIVE);
+		grid.collect_changed_tiles(changed);
+		frame.capture(grid, changed, 2);
+		errors += TEST_VAL_REPORT(count_frame_errors(grid, frame), 0);
+		errors += TEST_VAL_REPORT(frame.get_sequence(), uint64_t{2});
+
+		// Only the previous bounding box is cleared, unless the size or the states changed
+		grid.set_cell(3, 2, ALIVE);
+		grid.collect_changed_tiles(changed);
+		frame.capture(grid, changed, 3);
+		errors += TEST_VAL_REPORT(count_frame_errors(grid, frame), 0);
+		grid.resize_grid(90, 60);
+		grid.set_cell(89, 59, ALIVE);
+		grid.collect_changed_tiles(changed);
+		frame.capture(grid, changed, 4);
+		errors += TEST_VAL_REPORT(count_frame_errors(grid, frame), 0);
+		grid.set_rule(conway_rule);
+		fill_soup(grid, 2, 30);
+		grid.collect_changed_tiles(changed);
+		frame.capture(grid, changed, 5);
+		errors += TEST_VAL_REPORT(count_frame_errors(grid, frame), 0);
+	}
+
+	{
+		// The reader gets the latest published frame, and nothing twice
+		FrameExchange exchange;
+		LifeGrid grid{20};
+		std::vector<unsigned char> changed;
+		errors += TEST_VAL_REPORT(exchange.acquire(), false);
+		errors += TEST_VAL_REPORT(exchange.is_published_frame_taken(), true);
+		for(uint64_t sequence = 1; sequence <= 2; sequence++)
+		{
+			exchange.get_back_frame().capture(grid, changed, sequence);
+			exchange.publish();
+		}
+		errors += TEST_VAL_REPORT(exchange.is_published_frame_taken(), false);
+		errors += TEST_VAL_REPORT(exchange.acquire(), true);
+		errors += TEST_VAL_REPORT(exchange.get_front_frame().get_sequence(), uint64_t{2});
+		errors += TEST_VAL_REPORT(exchange.acquire(), false);
+		errors += TEST_VAL_REPORT(exchange.is_published_frame_taken(), true);
+	}
+
+	{
+		// A frame is never written while it's read: the population of every frame matches its cells
+		FrameExchange exchange;
+		LifeGrid grid{3};
+		grid.resize_grid(200, 100);
+		fill_soup(grid, 4, 35);
+		std::atomic<bool> done{false};
+
+		std::thread writer([&]()
+		{
+			std::vector<unsigned char> changed;
+			for(uint64_t sequence = 1; sequence <= 300; sequence++)
+			{
+				grid.next_generation();
+				grid.collect_changed_tiles(changed);
+				exchange.get_back_frame().capture(grid, changed, sequence);
+				exchange.publish();
+			}
+			done = true;
+		});
+
+		int torn_frames = 0;
+		int unordered_frames = 0;
+		uint64_t last_sequence = 0;
+		while(!done || !exchange.is_published_frame_taken())
+		{
+			if(!exchange.acquire())
+			{
+				continue;
+			}
+			const GridFrame &frame = exchange.get_front_frame();
+			uint64_t population = 0;
+			for(int y = 0; y < frame.get_grid_height(); y++)
+			{
+				for(int x = 0; x < frame.get_grid_width(); x++)
+				{
+					population += frame.get_cell(x, y) == ALIVE;
+				}
+			}
+			torn_frames += population != frame.get_population();
+			unordered_frames += frame.get_sequence() <= last_sequence;
+			last_sequence = frame.get_sequence();
+		}
+		writer.join();
+
+		errors += TEST_VAL_REPORT(torn_frames, 0);
+		errors += TEST_VAL_REPORT(unordered_frames, 0);
+		errors += TEST_VAL_REPORT(last_sequence, uint64_t{300});
+	}
+
+	return errors;
+}
+
 int main()
 {
 	UNIT_TEST_REPORT(test_kernel_compute_state);
 	UNIT_TEST_REPORT(test_kernel_step_right);
+	UNIT_TEST_REPORT(test_word_kernel_compute_state);
+	UNIT_TEST_REPORT(test_packed_engine);
+	UNIT_TEST_REPORT(test_row_kernels);
+	UNIT_TEST_REPORT(test_threaded_stepping);
+	UNIT_TEST_REPORT(test_hashlife);
+	UNIT_TEST_REPORT(test_sparse_plane);
+	UNIT_TEST_REPORT(test_active_tiles);
+	UNIT_TEST_REPORT(test_ghost_border);
+	UNIT_TEST_REPORT(test_buffer_reuse);
+	UNIT_TEST_REPORT(test_advance);
+	UNIT_TEST_REPORT(test_lookup_engine);
+	UNIT_TEST_REPORT(test_life_rules);
+	UNIT_TEST_REPORT(test_generations_rules);
+	UNIT_TEST_REPORT(test_larger_than_life);
+	UNIT_TEST_REPORT(test_pattern_io);
+	UNIT_TEST_REPORT(test_snapshot);
+	UNIT_TEST_REPORT(test_recorder);
+	UNIT_TEST_REPORT(test_cycle_detection);
+	UNIT_TEST_REPORT(test_statistics);
+	UNIT_TEST_REPORT(test_row_bits);
+	UNIT_TEST_REPORT(test_density_pyramid);
+	UNIT_TEST_REPORT(test_grid_frame);
 }
 